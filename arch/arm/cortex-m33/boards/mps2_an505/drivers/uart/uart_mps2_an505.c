@@ -0,0 +1,284 @@
+/*
+ * @file uart_mps2_an505.c
+ * @brief CMSDK APB UART driver for the MPS2+ AN505 board, as emulated
+ *      by QEMU's mps2-an505 machine
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* =================== INCLUDES =============================== */
+#include <stdint.h>
+#include "uart.h"
+#include "system.h"
+#include "os.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/* CMSDK APB UART0 registers, see Arm Application Note AN505 and the
+ * Cortex-M System Design Kit Technical Reference Manual. The kernel runs
+ * in the secure state, so the secure alias of the peripheral is used
+ */
+#define CMSDK_UART0_BASE_ADDR (uint32_t)0x50200000
+static volatile uint32_t * const UART0_DATA_REG     = (uint32_t*)(CMSDK_UART0_BASE_ADDR + 0x000);   /* Data Register */
+static volatile uint32_t * const UART0_STATE_REG    = (uint32_t*)(CMSDK_UART0_BASE_ADDR + 0x004);   /* State Register */
+static volatile uint32_t * const UART0_CTRL_REG     = (uint32_t*)(CMSDK_UART0_BASE_ADDR + 0x008);   /* Control Register */
+static volatile uint32_t * const UART0_BAUDDIV_REG  = (uint32_t*)(CMSDK_UART0_BASE_ADDR + 0x010);   /* Baud rate Divider Register */
+
+/* UART STATE register flags */
+#define UART_STATE_TXFULL   (uint32_t)(1 << 0)      /* TX buffer full */
+#define UART_STATE_RXFULL   (uint32_t)(1 << 1)      /* RX buffer full */
+
+/* UART CTRL register control bits */
+#define UART_CTRL_TXEN      (uint32_t)(1 << 0)      /* Transmit Enable bit */
+#define UART_CTRL_RXEN      (uint32_t)(1 << 1)      /* Receive Enable bit */
+
+/* The APB UART is clocked from the core clock on AN505 */
+#ifndef SYSTEM_CLOCK_HZ
+#define SYSTEM_CLOCK_HZ     20000000UL
+#endif
+#define UART_BAUDRATE       115200UL
+
+/* ========================= FUNCTION DECLARATIONS ========================= */
+
+int CMSDK_UART_init(void);
+int CMSDK_UART_printc(const char *c);
+int CMSDK_UART_printstr(const char *msg);
+int CMSDK_UART_flush(void);
+int CMSDK_UART_write(const char *buf, uint32_t len, Uart_Write_Callback cb);
+int CMSDK_UART_read(char *buf, uint32_t len, int ms);
+int CMSDK_UART_readline(char *buf, uint32_t len, int ms);
+int CMSDK_UART_rx_notify(Uart_Rx_Callback cb);
+
+/* ========================= STATIC DATA ========================= */
+
+
+static const UartDriver drv = {
+    &CMSDK_UART_init,
+    &CMSDK_UART_printc,
+    &CMSDK_UART_printstr,
+    &CMSDK_UART_flush,
+    &CMSDK_UART_write,
+    &CMSDK_UART_read,
+    &CMSDK_UART_readline,
+    &CMSDK_UART_rx_notify
+};
+const UartDriver *Uart_Driver = &drv;
+
+/** @brief Event never signalled, waited on with a timeout to poll the receiver once per tick */
+static os_event_t rx_poll;
+
+/** @brief Last byte read, for telling apart CRLF from two line ends */
+static char rx_prev;
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/**
+ * @brief Initialize the UART0 peripheral
+ * @note  No clock or pinmux configuration is needed on this board
+ *
+ * @return 0 on success
+ */
+int CMSDK_UART_init(void)
+{
+    /* Set baudrate. The divider must be at least 16, or nothing is transmitted */
+    *UART0_BAUDDIV_REG = SYSTEM_CLOCK_HZ / UART_BAUDRATE;
+
+    /* Enable the transmitter and the receiver */
+    *UART0_CTRL_REG = UART_CTRL_TXEN | UART_CTRL_RXEN;
+
+    return 0;
+}
+
+/**
+ * @brief Prints one character to UART0 output
+ *
+ * @return 0 on success, -1 on error
+ */
+int CMSDK_UART_printc(const char *c)
+{
+    /* Null-check parameters */
+    if(!c) {
+        return -1;
+    }
+
+    /* Busy-loop while the TX buffer is full */
+    while(*UART0_STATE_REG & UART_STATE_TXFULL) { ; }
+
+    /* Move byte to UART Data Register */
+    *UART0_DATA_REG = *c;
+
+    return 0;
+}
+
+/**
+ * @brief Prints a null-terminated string to UART0 output
+ *
+ * @return 0 on success
+ */
+int CMSDK_UART_printstr(const char *msg)
+{
+    /* Loop until null character is reached */
+    while(*msg != '\0') {
+
+        /* Busy-loop while the TX buffer is full */
+        while(*UART0_STATE_REG & UART_STATE_TXFULL) { ; }
+
+        /* Move byte to UART Data Register */
+        *UART0_DATA_REG = (*msg++);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Flush UART0 output. Characters are written directly to the
+ *      peripheral, so only its buffer needs to be emptied
+ *
+ * @return 0 on success
+ */
+int CMSDK_UART_flush(void)
+{
+    /* Busy-loop while the TX buffer is full */
+    while(*UART0_STATE_REG & UART_STATE_TXFULL) { ; }
+
+    return 0;
+}
+
+/**
+ * @brief Writes a buffer to UART0 output. The board has no DMA for the UART,
+ *      so the write is done before returning, and the callback is called right away
+ *
+ * @return 0 on success, -1 on error
+ */
+int CMSDK_UART_write(const char *buf, uint32_t len, Uart_Write_Callback cb)
+{
+    uint32_t i;
+
+    /* Null-check parameters */
+    if(!buf || !len) {
+        return -1;
+    }
+
+    for(i = 0; i < len; i++) {
+
+        /* Busy-loop while the TX buffer is full */
+        while(*UART0_STATE_REG & UART_STATE_TXFULL) { ; }
+
+        /* Move byte to UART Data Register */
+        *UART0_DATA_REG = buf[i];
+    }
+
+    if(cb) {
+        cb(buf, len, UART_OK);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Wait until a byte has been received, or the timeout passes. The
+ *      receiver is polled once per tick. Returns right away if the scheduler
+ *      is not running
+ * @param[in] ms    timeout in milliseconds, or OS_WAIT_FOREVER
+ *
+ * @return 1 if a byte was received, 0 otherwise
+ */
+static int cmsdk_uart_rx_wait(int ms)
+{
+    uint64_t deadline = TICK_get() + (uint64_t)ms;
+
+    while(!(*UART0_STATE_REG & UART_STATE_RXFULL)) {
+        if((ms >= 0) && (TICK_get() >= deadline)) {
+            return 0;
+        }
+        if(event_wait(&rx_poll, 1) == OS_ERROR) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Reads received bytes from UART0. Waits until at least one byte is
+ *      received, or the timeout passes
+ *
+ * @return number of bytes read, 0 on timeout, -1 on error
+ */
+int CMSDK_UART_read(char *buf, uint32_t len, int ms)
+{
+    uint32_t n = 0;
+
+    /* Null-check parameters */
+    if(!buf || !len) {
+        return -1;
+    }
+
+    if(!cmsdk_uart_rx_wait(ms)) {
+        return 0;
+    }
+
+    /* Reading the data register clears RXFULL */
+    while((n < len) && (*UART0_STATE_REG & UART_STATE_RXFULL)) {
+        buf[n++] = (char)*UART0_DATA_REG;
+    }
+
+    return (int)n;
+}
+
+/**
+ * @brief Reads a line from UART0. CR, LF, and CRLF end a line. The line end
+ *      is not stored, and the line is null-terminated. A line too long for
+ *      the buffer is truncated. The timeout applies to each byte
+ *
+ * @return length of the line, -1 on timeout or error
+ */
+int CMSDK_UART_readline(char *buf, uint32_t len, int ms)
+{
+    uint32_t n = 0;
+    char prev;
+    char c;
+
+    /* Null-check parameters */
+    if(!buf || !len) {
+        return -1;
+    }
+
+    while(1) {
+        if(!cmsdk_uart_rx_wait(ms)) {
+            return -1;
+        }
+        c = (char)*UART0_DATA_REG;
+        prev = rx_prev;
+        rx_prev = c;
+
+        if((c == '\r') || ((c == '\n') && (prev != '\r'))) {
+            break;
+        }
+
+        /* LF of a CRLF, the line ended at the CR */
+        if(c == '\n') {
+            continue;
+        }
+        if(n < (len - 1)) {
+            buf[n++] = c;
+        }
+    }
+    buf[n] = '\0';
+
+    return (int)n;
+}
+
+/**
+ * @brief Receive callbacks are not supported, the receiver is polled without
+ *      an interrupt
+ * @param[in] cb    unused
+ *
+ * @return -1
+ */
+int CMSDK_UART_rx_notify(Uart_Rx_Callback cb)
+{
+    (void)cb;
+
+    return -1;
+}
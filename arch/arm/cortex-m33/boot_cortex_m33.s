@@ -37,6 +37,9 @@
         start address) MUST be 1, since the Cortex-M33 processor only supports the Thumb
         instruction set. A Thumb function/branch address is indicated with LSB of 1 */
 
+    .global  __Vectors              /* Exported for the linker script to size the copy in RAM, */
+    .global  __Vectors_End          /*  and for the system driver to restore entries from */
+__Vectors:
     .long    __StackTop             /* Initial Top of Stack */
     .long    Reset_Handler          /* Reset Handler */
     .long    NMI_Handler            /* -14 NMI Handler */
@@ -55,9 +58,22 @@
     .long    SysTick_Handler        /*  -1 SysTick Handler */
 
     /* Rest of the interrupts go here. Refer to the RM0456 Chapter 22.3 for 
-        full set of maskable interrupts. U5 series processors support 140 + 16 interrupts */
-
-    .space      (140 * 4)           /* Allocate space for the rest of the interrupts */
+        full set of maskable interrupts. U5 series processors support 140 + 16 interrupts.
+        Interrupts without a handler of their own are spare, and can be pended by software
+        to run the run-to-completion tasks of libs/sst */
+
+    .rept       29                  /* Interrupts 0 - 28 are spare */
+    .long    Spare_IRQHandler
+    .endr
+    .long    GPDMA1_Channel0_IRQHandler /*  29 GPDMA1 Channel 0 global interrupt */
+    .rept       31                  /* Interrupts 30 - 60 are spare */
+    .long    Spare_IRQHandler
+    .endr
+    .long    USART1_IRQHandler      /*  61 USART1 global interrupt */
+    .rept       78                  /* The rest of the interrupts, 62 - 139, are spare */
+    .long    Spare_IRQHandler
+    .endr
+__Vectors_End:
 
 
 /* ============== TEXT SECTION ==============  */
@@ -110,7 +126,7 @@ zero_bss_begin:
     ldr     r1, [r0, #0]            /* Load value from address in r0 (.bss address in RAM) into r1 */
     ldr     r2, [r0, #4]            /* Load number of words to zero from mem. location r0 + 4 into r2 */
     lsls    r2, r2, #2              /* Multiply by four, setting flags, to get byte count and detect when size = 0 */
-    beq     jump_to_main            /* Skip the next section if Z = 1 (.bss size was zero - nothing to do) */
+    beq     copy_vectors_begin      /* Skip the next section if Z = 1 (.bss size was zero - nothing to do) */
 
     movs    r4, #0                  /* Load constant '0' to r4 to be used when zeroing */
 
@@ -120,6 +136,26 @@ zero_bss_loop:
     strge   r4, [r1, r2]            /* Store contents of r4 (a zero) into memory address r1 + r2 (.bss start + r2) */
     bge     zero_bss_loop           /* Jump to beginning of the section to loop over all of .bss */
 
+/* Copy the vector table from FLASH to RAM, and point VTOR to the copy, so that drivers can
+    attach interrupt handlers at run time. The copy is aligned for VTOR by the linker script */
+copy_vectors_begin:
+    ldr     r0, =__Vectors          /* Load the address of the vector table in FLASH (src) into r0 */
+    ldr     r1, =__ram_vectors_start    /* Load the address of the copy in RAM (dest) into r1 */
+    ldr     r2, =__Vectors_End      /* Load the end of the vector table into r2 */
+    subs    r2, r2, r0              /* Subtract the start to get the number of bytes to copy */
+
+copy_vectors_loop:
+    subs    r2, #4                  /* Index of the next word, from the last one, set flags */
+    ittt    ge                      /* Conditional block of 3, ran while the index is not negative */
+    ldrge   r3, [r0, r2]            /* Load nth entry of the vector table into r3 */
+    strge   r3, [r1, r2]            /* Store it into the copy */
+    bge     copy_vectors_loop       /* Loop over all entries */
+
+    ldr     r0, =0xE000ED08         /* Load the address of VTOR (Vector Table Offset Register) into r0 */
+    str     r1, [r0]                /* Point VTOR to the copy in RAM */
+    dsb                             /* Make sure the write completes before any interrupt is taken */
+    isb
+
 /* Perform the jump to C code, targeting label "main". This is the application entry point */
 jump_to_main:
 
@@ -176,3 +212,6 @@ Default_Handler:
     Set_Default_Handler  DebugMon_Handler
     Set_Default_Handler  PendSV_Handler
     Set_Default_Handler  SysTick_Handler
+    Set_Default_Handler  GPDMA1_Channel0_IRQHandler
+    Set_Default_Handler  USART1_IRQHandler
+    Set_Default_Handler  Spare_IRQHandler
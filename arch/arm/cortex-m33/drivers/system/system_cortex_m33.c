@@ -7,11 +7,17 @@
 
 /* =================== INCLUDES =============================== */
 #include <stdint.h>
+#include <stddef.h>
 #include "system.h"
 #include "os.h"
 
 /* ========================= CONSTANTS ========================= */
 
+/** @brief Core clock frequency, SysTick is clocked from it. Override to adjust for the board */
+#ifndef SYSTEM_CLOCK_HZ
+#define SYSTEM_CLOCK_HZ     4000000UL
+#endif
+
 // https://developer.arm.com/documentation/100235/0100/The-Cortex-M33-Peripherals/System-timer--SysTick
 #define SCS_BASE            (0xE000E000UL)
 
@@ -24,57 +30,240 @@
 #define SYSTICK_PRIO        (0xC0UL << 24)
 #define PENDSV_PRIO         (0xD0UL << 16)
 
+/**
+ * @brief Highest interrupt priority allowed to call kernel functions. Critical
+ *      sections set BASEPRI to this, masking only interrupts of this or lower
+ *      priority (numerically higher or equal). Interrupts of higher priority
+ *      are never delayed by the kernel, and must not call it. Only the upper
+ *      bits of a priority are implemented; four on STM32U5, three on AN505.
+ *      Override to adjust, without a type suffix, as it is used in assembly
+ */
+#ifndef MAX_SYSCALL_PRIO
+#define MAX_SYSCALL_PRIO    0x80
+#endif
+
+#if (MAX_SYSCALL_PRIO == 0) || (MAX_SYSCALL_PRIO > 0xFF)
+#error "MAX_SYSCALL_PRIO must be within 0x01 - 0xFF, BASEPRI of 0 masks nothing"
+#endif
+
+#if ((SYSTICK_PRIO >> 24) < MAX_SYSCALL_PRIO) || ((PENDSV_PRIO >> 16) < MAX_SYSCALL_PRIO)
+#error "SysTick and PendSV call the kernel, their priority must not exceed MAX_SYSCALL_PRIO"
+#endif
+
+/** @brief Expand a macro into a string, for use in assembly */
+#define STRINGIFY(x)        #x
+#define XSTRINGIFY(x)       STRINGIFY(x)
+
 #define NVIC_ICSR           (volatile uint32_t*)(SCS_BASE + 0xD04UL)
+#define NVIC_SHPR2          (volatile uint32_t*)(SCS_BASE + 0xD1CUL)
 #define NVIC_SHPR3          (volatile uint32_t*)(SCS_BASE + 0xD20UL)
+#define SVCALL_PRIO_MASK    (0xFFUL << 24)
 #define PENDSV_SET          (0x1UL << 28)
+#define ICSR_PENDSTSET      (0x1UL << 26)   /* SysTick exception pending */
+#define SCB_VTOR            (volatile uint32_t*)(SCS_BASE + 0xD08UL)
+
+/** @brief CPUID through the Non-secure alias of the SCS. Reads the CPUID from
+ *      Secure state, and zero from Non-secure state or without TrustZone */
+#define SCB_CPUID_NS        (volatile uint32_t*)(SCS_BASE + 0x20000UL + 0xD00UL)
+
+// https://developer.arm.com/documentation/100235/0100/The-Cortex-M33-Peripherals/Nested-Vectored-Interrupt-Controller
+#define NVIC_ISER           ((volatile uint32_t*)(SCS_BASE + 0x100UL))
+#define NVIC_ICER           ((volatile uint32_t*)(SCS_BASE + 0x180UL))
+#define NVIC_ISPR           ((volatile uint32_t*)(SCS_BASE + 0x200UL))
+#define NVIC_IPR            ((volatile uint8_t*)(SCS_BASE + 0x400UL))
+
+/** @brief Number of interrupts in the vector table, see boot_cortex_m33.s */
+#define NVIC_IRQ_COUNT      140UL
+
+/** @brief Exceptions before the interrupts in the vector table */
+#define NVIC_IRQ_OFFSET     16UL
+
+// https://developer.arm.com/documentation/100230/0004/debug/data-watchpoint-and-trace-unit
+#define DEMCR               (volatile uint32_t*)(SCS_BASE + 0xDFCUL)
+#define DEMCR_TRCENA        (0x1UL << 24)
+#define DWT_BASE            (0xE0001000UL)
+#define DWT_CTRL            (volatile uint32_t*)(DWT_BASE + 0x0UL)
+#define DWT_CYCCNT          (volatile uint32_t*)(DWT_BASE + 0x4UL)
+#define DWT_CTRL_CYCCNTENA  (0x1UL << 0)
+
+// https://developer.arm.com/documentation/100235/0100/The-Cortex-M33-Peripherals/Security-attribution-and-memory-protection/Memory-Protection-Unit
+#define MPU_CTRL            (volatile uint32_t*)(SCS_BASE + 0xD94UL)
+#define MPU_RNR             (volatile uint32_t*)(SCS_BASE + 0xD98UL)
+#define MPU_RBAR            (volatile uint32_t*)(SCS_BASE + 0xD9CUL)
+#define MPU_RLAR            (volatile uint32_t*)(SCS_BASE + 0xDA0UL)
+#define MPU_MAIR0           (volatile uint32_t*)(SCS_BASE + 0xDC0UL)
+#define SHCSR               (volatile uint32_t*)(SCS_BASE + 0xD24UL)
+#define SHCSR_MEMFAULTENA   (0x1UL << 16)
+
+/** @brief MPU registers used in assembly, without a type suffix. MPU_CTRL is
+ *      followed by MPU_RNR, MPU_RBAR, MPU_RLAR, and three RBAR/RLAR alias pairs */
+#define MPU_CTRL_ADDR       0xE000ED94
+#define MPU_CTRL_ENABLE     0x5             /* ENABLE, and PRIVDEFENA for the default map outside regions */
+
+/** @brief MPU region of the code and constants, executable and readable by unprivileged tasks */
+#define MPU_CODE_REGION     0
+
+/** @brief First MPU region of the running task. The task regions are written
+ *      at once through the alias registers, so the first must be a multiple of
+ *      four, and a task has four regions; its stack guard, stack, and own regions */
+#define MPU_TASK_REGION     4
+
+#if OS_TASK_MPU_REGS != 8
+#error "The context switch writes four MPU regions per task, OS_TASK_REGIONS must be 2"
+#endif
+
+/** @brief Offsets of the TCB members loaded by the context switch */
+#define TCB_MPU_REGS        4
+#define TCB_UNPRIVILEGED    36
+
+_Static_assert(offsetof(task_t, mpu_regs) == TCB_MPU_REGS
+    && offsetof(task_t, unprivileged) == TCB_UNPRIVILEGED, "TCB layout of the context switch");
+
+/** @brief MPU region granularity; region start and end addresses are multiples of this */
+#define MPU_ALIGN           32UL
+
+/** @brief MPU region base address register flags */
+#define MPU_RBAR_XN         (0x1UL << 0)    /* never execute */
+#define MPU_RBAR_AP_RW      (0x1UL << 1)    /* read-write, any privilege */
+#define MPU_RBAR_AP_PRIV_RO (0x2UL << 1)    /* read-only, privileged only */
+#define MPU_RBAR_AP_RO      (0x3UL << 1)    /* read-only, any privilege */
+
+/** @brief MPU region limit address register flags. The attribute indexes refer to MPU_MAIR0 */
+#define MPU_RLAR_EN         (0x1UL << 0)
+#define MPU_RLAR_NORMAL     (0x0UL << 1)    /* attribute 0, normal memory */
+#define MPU_RLAR_DEVICE     (0x1UL << 1)    /* attribute 1, device memory */
+
+/** @brief Memory attributes; 0 normal write-back read/write-allocate, 1 device-nGnRnE */
+#define MPU_MAIR0_VALUE     0x000000FFUL
+
+/** @brief Coprocessor access control, CP10 and CP11 make up the FPU */
+#define CPACR               (volatile uint32_t*)(SCS_BASE + 0xD88UL)
+#define CPACR_FPU_FULL      (0xFUL << 20)
+
+#if defined(CONFIG_FPU) && !defined(__ARM_FP)
+#error "CONFIG_FPU needs the hardware floating point ABI, -mfloat-abi=hard"
+#endif
+
+/** @brief Nanoseconds per SysTick count, in 16.16 fixed point, to convert
+ *      without a division */
+#define TIME_NS_PER_COUNT   ((1000000000ULL << 16) / SYSTEM_CLOCK_HZ)
 
 /** @brief Debug value in stacks */
 #define SENTINEL 0xDEADBEEFUL
 
+/** @brief EXC_RETURN a task is first entered with; return to non-secure thread
+ *      mode using MSP, without an FPU context, with the default stacking rules.
+ *      Stored by @ref PendSV_Handler per task */
+#define EXC_RETURN_INITIAL  0xFFFFFFB8UL
+
+/** @brief EXC_RETURN bits of a secure stack frame (S, bit 6), and a secure
+ *      exception (ES, bit 0), set when the kernel runs in Secure state */
+#define EXC_RETURN_SECURE   0x41UL
+
 /* ========================= FUNCTION DECLARATIONS ========================= */
 
 int STM_TICK_init(int ms, Tick_Callback cb);
-int STM_PendSV_init(void);
+int STM_PendSV_init(PendSV_Callback cb);
 void STM_Task_Stack_init(task_t *task);
 static inline uint32_t STM_Count_Leading_Zeros(uint32_t value);
 uint64_t STM_TICK_get(void);
+uint64_t STM_time_get(void);
 void STM_busy_sleep(int ms);
 void STM_PendSV_trigger(void);
+void STM_wait_for_interrupt(void);
+void STM_sync_barriers(void);
+uint32_t STM_cycles_get(void);
+uint32_t STM_critical_enter(void);
+void STM_critical_exit(uint32_t state);
+uintptr_t STM_syscall(uint32_t num, uintptr_t a0, uintptr_t a1, uintptr_t a2);
+int STM_spare_irq_init(uint32_t irqn, uint32_t prio, Irq_Callback cb);
+void STM_spare_irq_pend(uint32_t irqn);
+int STM_irq_attach(uint32_t irqn, Irq_Handler handler, uint32_t prio);
+uint32_t STM_irq_active(void);
 
 /* ========================= STATIC DATA ========================= */
 
-/** @brief System driver vtable */
-static SystemDriver drv = {
+/** @brief System driver vtable. Constant, placed in flash with the code, as
+ *      unprivileged tasks read it to make system calls */
+static const SystemDriver drv = {
     &STM_TICK_init,
     &STM_PendSV_init,
     &STM_Task_Stack_init,
     &STM_Count_Leading_Zeros,
     &STM_TICK_get,
+    &STM_time_get,
     &STM_busy_sleep,
-    &STM_PendSV_trigger
+    &STM_PendSV_trigger,
+    &STM_wait_for_interrupt,
+    &STM_sync_barriers,
+    &STM_cycles_get,
+    &STM_critical_enter,
+    &STM_critical_exit,
+    &STM_syscall,
+    &STM_spare_irq_init,
+    &STM_spare_irq_pend,
+    &STM_irq_attach,
+    &STM_irq_active
 };
 
 /** @brief System driver pointer, matching extern in os driver abstraction */
-const SystemDriver *Sys_Driver = &drv;
+const SystemDriver * const Sys_Driver = &drv;
 
 /** @brief Static pointers for ISR callbacks */
 static Tick_Callback tick_cb;
 
-/** @brief System tick counter */
+/** @brief System tick counter. Updated by @ref SysTick_Handler low word first,
+ *      with the interrupts that may read it masked */
 static volatile uint64_t systicks;
 
-/** @brief Size of task_t, needed in fetching stack pointers in @ref PendSV_Handler */
-static const uint32_t __attribute__((unused)) task_struct_size = sizeof(task_t);
+/** @brief Tick interval in nanoseconds */
+static uint32_t tick_ns;
+
+/** @brief Callback of PendSV, run before the context switch when a task was
+ *      woken from an interrupt. Only read by @ref PendSV_Handler */
+static PendSV_Callback __attribute__(( used )) pendsv_cb;
+
+#ifdef CONFIG_SST
+/** @brief Callback of the spare interrupts, see @ref Spare_IRQHandler */
+static Irq_Callback spare_irq_cb;
+
+/** @brief Stack shared by the spare interrupts, placed with the task stacks
+ *      above the main stack limit, where the linker script reserves room for it */
+static uint8_t __attribute__(( section(".task_stacks"), aligned(32), used ))
+    spare_irq_stack[CONFIG_SST_STACK_SIZE];
+#endif /* CONFIG_SST */
+
+#ifdef OS_BENCH
+/** @brief Cycles spent in @ref PendSV_Handler during the latest context switch */
+volatile uint32_t pendsv_cycles;
+
+/** @brief Cycles of the latest context switch spent reprogramming the MPU */
+volatile uint32_t pendsv_mpu_cycles;
+#endif /* OS_BENCH */
 
 /** @brief Extern linkage to definition of task states */
 extern uint32_t task_state_list[];
 
+/** @brief Extern linkage to the running and next TCB, read by @ref PendSV_Handler */
+extern task_switch_t task_switch;
+
+/** @brief Vector table in flash, and its copy in RAM pointed to by VTOR, see boot_cortex_m33.s */
+extern const uint32_t __Vectors[];
+extern uint32_t __ram_vectors_start[];
+
 /** @brief Extern linkage to definition of tasks to run, @ref OS_TASKS_INIT */
 extern task_t __tasks[];
 
 /** @brief Extern linkage to definition of task stacks, @ref OS_TASKS_INIT */
 extern uint8_t task_stacks[];
 
+/** @brief Extern linkage to the kernel functions of system calls, read by @ref SVC_Handler */
+extern const os_syscall_t syscall_table[];
+
+/** @brief Extern linkage to the code and constants from linker script */
+extern uint8_t __text_start[];
+extern uint8_t __text_end[];
+
 /* ========================= FUNCTION DEFINITIONS ========================= */
 
 
@@ -93,17 +282,23 @@ void  __attribute__( ( naked ) ) SysTick_Handler(void)
     /* Save registers modified by this function (r0-r3 saved in hw) */
     asm("push {r4, r5, r6, lr}");
 
+    /* Mask the interrupts that may read the tick count, for them not to see
+        the low word carried into the high word before it is written */
+    asm("mrs r0, basepri");
+    asm("mov r1, #" XSTRINGIFY(MAX_SYSCALL_PRIO));
+    asm("msr basepri_max, r1");
+
     /* Load systicks to registers */
     asm("ldr r2, =systicks");
     asm("ldr r3, [r2, #0]");
     asm("ldr r4, [r2, #4]");
-    asm("mov r1, #1");
 
-    /* 64-bit add and store back*/
+    /* 64-bit add and store back, low word first */
     asm("adds r5, r3, #1");
     asm("adc  r6, r4, #0");
     asm("str  r5, [r2, #0]");
     asm("str  r6, [r2, #4]");
+    asm("msr basepri, r0");
 
     /* Call systick handler, null-checking the tick_cb pointer */
     asm("ldr r1, =tick_cb");
@@ -122,35 +317,32 @@ void  __attribute__( ( naked ) ) SysTick_Handler(void)
 /** 
  * @brief Perform a context switch.
  *      Stores the context of the currently running task into it's stack
- *      space, and restores the context of the task marked ready, resuming
- *      the execution in the new task's context once the interrupt running
- *      this function returns.
+ *      space, and restores the context of the task selected to run next,
+ *      resuming the execution in the new task's context once the interrupt
+ *      running this function returns.
  */
 void __attribute__((naked)) PendSV_Handler(void)
 {
 
 /* 
  * Steps to perform the context switch:
- *  1. Store the stack pointer of the running task, and the contents of
- *      the Link Register into general purpose registers
- *  2. Store the registers that are not automatically stored by exception
- *      entry in the currently running task's stack
- *  3. Get the task number of the currently running task by counting the
- *      leading zeros on the global task state list's RUNNING entry
- *  4. Set the value of the EJECTED entry to the previous value in RUNNING
- *      entry, and clear the RUNNING entry to mark the current task switched out
- *  5. Find the offset of the currently running task's stack pointer member in the
- *      task structures and store the stack pointer there
- *  6. Copy the value of the NEXT entry in task state list into the RUNNING list,
- *      and clear the NEXT entry to mark the next task to run as being actively run
- *  7. Get the number of the next task to run by counting the leading zeros on the
- *      RUNNING entry of the task state list
- *  8. Load the stack pointer from the task structure of the new running task into a 
- *      general purpose register
- *  9. Load the registers not automatically stored by exception entry from the new
- *      task's stack
- *  10. Restore the CPU stack pointer to the new task's stack, and return from interrupt
- *      with the stored Link Register value
+ *  1. If the WOKEN entry of the task state list is set, call the PendSV
+ *      callback of the kernel to wake the tasks signalled from interrupts.
+ *      Return right away if the NEXT entry is not set after it
+ *  2. Load the current task's TCB pointer, kept by the kernel in task_switch
+ *  3. Store the registers that are not automatically stored by exception
+ *      entry, and the EXC_RETURN value in the Link Register, in the currently
+ *      running task's stack, and the resulting stack pointer into its TCB
+ *  4. In a critical section (as SysTick may select another task meanwhile),
+ *      move the RUNNING entry of the task state list into the EJECTED entry,
+ *      and the NEXT entry into the RUNNING entry, clear the NEXT entry, and
+ *      make the next task's TCB the current one
+ *  5. Reprogram the task regions of the MPU with the values in the new
+ *      running task's TCB, if built with CONFIG_MPU, and set its privilege
+ *  6. Load the stack pointer from the TCB of the new running task, and the
+ *      registers and EXC_RETURN from its stack
+ *  7. Restore the CPU stack pointer to the new task's stack, and return from
+ *      interrupt with the new task's EXC_RETURN
  *
  * Saving and loading the context:
  * 
@@ -168,61 +360,224 @@ void __attribute__((naked)) PendSV_Handler(void)
  *      0x0  - R0               <SP during interrupt entry>
  *
  * As a first step in the context switch interrupt handler, the rest of the registers are also
- *  stored onto the stack:
- *      0x4  - R4
+ *  stored onto the stack, and the EXC_RETURN value, as each task returns with its own:
+ *      0x24 - EXC_RETURN
+ *      0x20 - R11
  *      ...  - R5 - R10
- *      0x20 - R11              <SP after storing the context>
+ *      0x0  - R4               <SP after storing the context>
+ *
+ * With the FPU in use, a task that has used it (EXC_RETURN bit 4 clear) also gets S16 - S31
+ *  stored below R4. The hardware stacks S0 - S15 and FPSCR in that case.
  * 
 */
 
-    /* Store stack pointer and link register into a general purpose register */
+    /* Wake the tasks signalled from interrupts, which may select a task to switch to. The
+        callback is a C function, preserving r4 - r11 of the running task */
+    asm("ldr r3, =task_state_list");    /* Load the task_state_list address into r3 */
+    asm("ldr r0, [r3, #20]");           /* Load the value of the WOKEN entry into r0 */
+    asm("cbz r0, 1f");                  /* Skip the callback if no task was woken */
+    asm("push {r3, lr}");               /* Keep EXC_RETURN, r3 keeps the stack 8-byte aligned */
+    asm("ldr r0, =pendsv_cb");          /* Load the callback, always set before the first task */
+    asm("ldr r0, [r0]");
+    asm("blx r0");
+    asm("pop {r3, lr}");
+    asm("1:");
+    asm("ldr r0, [r3, #0]");            /* Load the value of the NEXT entry into r0 */
+    asm("cbnz r0, 2f");                 /* Switch only if a task was selected */
+    asm("bx lr");                       /* Nothing to switch to, resume the running task */
+    asm("2:");
+
+#ifdef OS_BENCH
+    /* Sample the SysTick down counter on entry into r12, which is stacked by hardware */
+    asm("ldr r2, =0xE000E018");         /* Load the address of the SysTick current value register */
+    asm("ldr r12, [r2]");               /* Load the current value into r12 */
+#endif /* OS_BENCH */
+
+    /* Load the running task's TCB */
+    asm("ldr r2, =task_switch");        /* Load the address of the current and next TCB pointers into r2 */
+    asm("ldr r1, [r2, #0]");            /* Load the current TCB pointer into r1 */
+
+    /* Store registers R4-R11 and EXC_RETURN onto the stack of the currently running task */
     asm("mrs r0, msp");                 /* Move from special register MSP to general purpose register r0 */
-    asm("mov r1, lr");                  /* Move LR into r1 */
-
-    /* Store registers R4-R11 onto the stack of the currently running task. 
-        Store new SP address in R0 */
-    asm("stmdb r0!, {r4-r11}");         /* Store multiple, decrement before, write back the address */
-
-    /* Figure out current task number, move it from RUNNING to EJECTED and clear RUNNING */
+#if defined(__ARM_FP)
+    asm("tst lr, #0x10");               /* EXC_RETURN bit 4 is clear if the task has an FPU context */
+    asm("it eq");
+    asm("vstmdbeq r0!, {s16-s31}");     /* Store the FPU registers not stacked by hardware */
+#endif /* __ARM_FP */
+    asm("stmdb r0!, {r4-r11, lr}");     /* Store multiple, decrement before, write back the address */
+    asm("str r0, [r1]");                /* Store the stack pointer into the TCB, it's the first member */
+
+    /* Switch the task states and TCBs in a critical section. Only interrupts that may call
+        the kernel are masked. BASEPRI is always 0 here, as PendSV is itself masked by
+        critical sections */
+    asm("ldr r3, =task_state_list");    /* Load the task_state_list address into r3 */
     asm("mov r6, #0");                  /* Store the number 0 into r6 */
-    asm("ldr r2, =task_state_list");    /* Load the task_state_list address into r2 */
-    asm("ldr r5, [r2, #12]");           /* Load the value of the RUNNING entry into r5 with an offset to r2 */
-    asm("str r5, [r2, #16]");           /* Store value of the RUNNING entry into EJECTED entry */
-    asm("str r6, [r2, #12]");           /* Clear the value of the RUNNING entry by writing a zero into it */
-    asm("clz r5, r5");                  /* Count leading zeros of the entry to get the active task number */
-
-    /* Store the current stack pointer into the task structure of the running task */
-    asm("ldr r3, =__tasks");            /* Load the __tasks structure array starting address into r3 */
-    asm("ldr r4, =task_struct_size");   /* Load the address of the size of the task_t structure into r4 */
-    asm("ldr r4, [r4]");                /* Load the value of the size of the task_t structure into r4 */
-    asm("mul r5, r4");                  /* Multiply the task number by the size of the task_t structure into r5 */
-    asm("str r0, [r3, r5]");            /* Store the stack pointer of the currently running task into it's task_t
-                                            structure with the computed offset w.r.t the starting address of the
-                                            __tasks array. The stack pointer is the first element in the array. */
-
-    /* Figure out next task number with interrupts disabled (as SysTick may alter the NEXT entry) */
-    asm("cpsid i");                     /* Disable interrupts */
-    asm("ldr r5, [r2, #0]");            /* Load the value of the NEXT entry in the task state list */
-    asm("str r5, [r2, #12]");           /* Store the value of the NEXT entry into the RUNNING entry */
-    asm("str r6, [r2, #0]");            /* Clear the NEXT entry by writing a zero into it */
-    asm("cpsie i");                     /* Enable interrupts */
-    asm("clz r5, r5");                  /* Count the leading zeros of the NEXT/RUNNING entry to get the task number */
-
-    /* Load stack pointer of next ready task from struct */
-    asm("mul r5, r4");                  /* Multiply the new task number by the size of the task_t structure to... */
-    asm("ldr r0, [r3, r5]");            /* Get the offset of and load the new task's stack pointer into register r0 */
-
-    /* Load registers r4-r11 */
-    asm("ldmia r0!, {r4-r11}");         /* Load multiple, increment after, write back the address into r0 */
+    asm("mov r7, #" XSTRINGIFY(MAX_SYSCALL_PRIO));  /* Load the kernel's interrupt priority into r7 */
+    asm("msr basepri, r7");             /* Mask interrupts of that priority and lower */
+    asm("ldr r4, [r3, #12]");           /* Load the value of the RUNNING entry into r4 */
+    asm("ldr r5, [r3, #0]");            /* Load the value of the NEXT entry into r5 */
+    asm("strd r5, r4, [r3, #12]");      /* Store NEXT into RUNNING, and RUNNING into EJECTED, next to it */
+    asm("str r6, [r3, #0]");            /* Clear the NEXT entry by writing a zero into it */
+    asm("ldr r1, [r2, #4]");            /* Load the next TCB pointer into r1 */
+    asm("str r1, [r2, #0]");            /* Make it the current TCB */
+    asm("msr basepri, r6");             /* Unmask, r6 is still zero. r4-r7 are restored from the next task */
+
+#ifdef CONFIG_MPU
+#ifdef OS_BENCH
+    /* Sample the SysTick down counter into r0, which is free until the new stack pointer is loaded */
+    asm("ldr r2, =0xE000E018");         /* Load the address of the SysTick current value register */
+    asm("ldr r0, [r2]");                /* Load the current value into r0 */
+#endif /* OS_BENCH */
+
+    /* Reprogram the task regions of the MPU. The MPU is disabled meanwhile, as the regions of the
+        two tasks are mixed until all are written, and interrupts above the kernel's priority may
+        preempt this. Those run privileged, with the default memory map while the MPU is off */
+    asm("ldr r2, =" XSTRINGIFY(MPU_CTRL_ADDR));     /* Load the address of MPU_CTRL into r2 */
+    asm("dmb");                         /* Complete the memory accesses made under the old regions */
+    asm("str r6, [r2]");                /* Disable the MPU, r6 is still zero */
+    asm("mov r3, #" XSTRINGIFY(MPU_TASK_REGION));   /* Load the first task region number into r3 */
+    asm("str r3, [r2, #4]");            /* Select it in MPU_RNR, the alias registers follow it */
+    asm("add r3, r1, #" XSTRINGIFY(TCB_MPU_REGS));  /* Load the address of the MPU registers in the TCB */
+    asm("ldmia r3, {r4-r11}");          /* Load the RBAR and RLAR values of the four task regions */
+    asm("add r3, r2, #8");              /* Load the address of MPU_RBAR into r3 */
+    asm("stmia r3, {r4-r11}");          /* Write MPU_RBAR, MPU_RLAR, and the alias pairs at once */
+    asm("mov r3, #" XSTRINGIFY(MPU_CTRL_ENABLE));   /* Load the MPU control value into r3 */
+    asm("str r3, [r2]");                /* Enable the MPU again */
+    asm("dsb");                         /* Complete the writes, and apply the new regions from */
+    asm("isb");                         /*  the next instruction on */
+
+#ifdef OS_BENCH
+    /* Sample the SysTick down counter again, store the cycles spent on the MPU */
+    asm("ldr r2, =0xE000E018");         /* Load the address of the SysTick current value register */
+    asm("ldr r3, [r2]");                /* Load the current value into r3 */
+    asm("subs r3, r0, r3");             /* Counter counts down, elapsed cycles is start - end value */
+    asm("ldr r2, =pendsv_mpu_cycles");  /* Load the address of the result */
+    asm("str r3, [r2]");                /* Store the result */
+#endif /* OS_BENCH */
+#endif /* CONFIG_MPU */
+
+    /* Set the privilege of the new task, also without the MPU: unprivileged tasks then still cannot
+        mask interrupts or reach the system control space, only their memory is not isolated */
+    asm("ldr r3, [r1, #" XSTRINGIFY(TCB_UNPRIVILEGED) "]");    /* Load the privilege of the new task */
+    asm("mrs r2, control");             /* Set CONTROL.nPRIV to it, taking effect in thread mode, */
+    asm("bfi r2, r3, #0, #1");          /*  as the exception return synchronizes the context */
+    asm("msr control, r2");
+
+    /* Load the next task's context */
+    asm("ldr r0, [r1]");                /* Load the new task's stack pointer from its TCB into r0 */
+    asm("ldmia r0!, {r4-r11, lr}");     /* Load multiple, increment after, write back the address into r0 */
+#if defined(__ARM_FP)
+    asm("tst lr, #0x10");               /* Restore the FPU registers if the new task has an FPU context */
+    asm("it eq");
+    asm("vldmiaeq r0!, {s16-s31}");
+#endif /* __ARM_FP */
 
     /* Restore stack pointer */
     asm("msr msp, r0");                 /* Write the new task's stack pointer (after loading context) into 
                                             the CPU's stack register */
 
-    /* Return from interrupt (exc return stored in r1) */
-    asm("bx r1");                       /* Branch to the address stored in R1, the Link Register value when
-                                            this interrupt was entered. Execution will now continue in the
-                                            new task's context */
+#ifdef OS_BENCH
+    /* Sample the SysTick down counter again, store the elapsed cycles */
+    asm("ldr r2, =0xE000E018");         /* Load the address of the SysTick current value register */
+    asm("ldr r3, [r2]");                /* Load the current value into r3 */
+    asm("subs r3, r12, r3");            /* Counter counts down, elapsed cycles is entry - exit value */
+    asm("ldr r2, =pendsv_cycles");      /* Load the address of the result */
+    asm("str r3, [r2]");                /* Store the result. A SysTick reload in between yields garbage */
+#endif /* OS_BENCH */
+
+    /* Return from interrupt with the new task's EXC_RETURN */
+    asm("bx lr");                       /* Execution will now continue in the new task's context */
+}
+
+/**
+ * @brief System call entry, see @ref STM_syscall. Calls the kernel function of
+ *      the call number in the task's stacked r12 from syscall_table, with the
+ *      arguments in its stacked r0 - r2, and returns its result in the stacked
+ *      r0. The live registers are not used: with late arrival or tail-chaining,
+ *      they hold the values of another handler. A context switch requested by
+ *      the call is performed by PendSV, tail-chained as this returns; without
+ *      one, the task resumes right away
+ */
+void __attribute__((naked)) SVC_Handler(void)
+{
+    asm("tst lr, #0x4");                /* EXC_RETURN bit 2 is set if the frame is on the PSP */
+    asm("ite eq");
+    asm("mrseq r3, msp");               /* Load the address of the exception frame into r3 */
+    asm("mrsne r3, psp");
+    asm("push {r3, lr}");               /* Keep it, and EXC_RETURN, the stack stays 8-byte aligned */
+    asm("ldr r12, [r3, #16]");          /* Load the call number from the stacked r12 */
+    asm("cmp r12, #" XSTRINGIFY(OS_SYSCALL_COUNT));    /* Refuse unknown call numbers */
+    asm("bhs 1f");
+    asm("ldmia r3, {r0-r2}");           /* Load the arguments from the stacked r0 - r2 */
+    asm("ldr r3, =syscall_table");      /* Load the kernel function of the call into r12 */
+    asm("ldr r12, [r3, r12, lsl #2]");
+    asm("blx r12");                     /* Call it */
+    asm("b 2f");
+    asm("1:");
+    asm("mvn r0, #0");                  /* Return OS_ERROR for unknown call numbers */
+    asm("2:");
+    asm("pop {r3, lr}");
+    asm("str r0, [r3]");                /* Return the result in the stacked r0 */
+    asm("bx lr");                       /* Return from the exception */
+}
+
+#ifdef CONFIG_SST
+/**
+ * @brief Handler of the spare interrupts, calls the spare interrupt callback
+ *      with the number of the active interrupt. Interrupts are taken on the
+ *      stack of the running task, so this moves to the shared stack of the
+ *      spare interrupts first, unless already on it, i.e. preempting another
+ *      spare interrupt. Preempting a task costs its stack the exception frame
+ *      only. There is no context to save; the callback runs to completion and
+ *      returns to whatever it preempted
+ */
+void __attribute__((naked)) Spare_IRQHandler(void)
+{
+    /* An interrupt preempting this before the switch sees the task's stack pointer, and moves to
+        the top of the shared stack too, but is done with it before this moves there. One
+        preempting this right after the switch sees the top, which counts as on the shared stack */
+    asm("mov r3, sp");                  /* Keep the stack pointer of the preempted code in r3 */
+    asm("ldr r0, =spare_irq_stack");    /* Load the bottom of the shared stack into r0 */
+    asm("ldr r2, =" XSTRINGIFY(CONFIG_SST_STACK_SIZE));    /* Load its size into r2 */
+    asm("subs r1, r3, r0");             /* Offset of the stack pointer from the bottom */
+    asm("cmp r1, r2");                  /* Above the top, or below the bottom when wrapped around */
+    asm("itt hi");                      /*  means not on the shared stack yet */
+    asm("addhi r1, r0, r2");            /* Move to the top of the shared stack */
+    asm("movhi sp, r1");
+    asm("push {r3, lr}");               /* Keep the preempted stack pointer and EXC_RETURN */
+
+    /* Call the callback with the interrupt number */
+    asm("mrs r0, ipsr");                /* Load the active exception number into r0 */
+    asm("sub r0, r0, #" XSTRINGIFY(NVIC_IRQ_OFFSET));  /* Interrupts come after the system exceptions */
+    asm("ldr r1, =spare_irq_cb");       /* Load the callback, always set before the interrupt is enabled */
+    asm("ldr r1, [r1]");
+    asm("blx r1");
+
+    /* Return to the preempted stack */
+    asm("pop {r3, lr}");
+    asm("mov sp, r3");
+    asm("bx lr");
+}
+#endif /* CONFIG_SST */
+
+/**
+ * @brief Call a kernel function through @ref SVC_Handler. The arguments are
+ *      shifted into r0 - r2, and the call number into r12, which is stacked
+ *      by the exception entry and needs no saving
+ * @param[in] num   system call number
+ * @param[in] a0    first argument
+ * @param[in] a1    second argument
+ * @param[in] a2    third argument
+ * @return result of the call, OS_ERROR for an unknown number
+ */
+uintptr_t __attribute__((naked)) STM_syscall(uint32_t num, uintptr_t a0, uintptr_t a1, uintptr_t a2)
+{
+    asm("mov r12, r0");
+    asm("mov r0, r1");
+    asm("mov r1, r2");
+    asm("mov r2, r3");
+    asm("svc #0");                      /* The result is in r0 on return */
+    asm("bx lr");
 }
 
 /**
@@ -239,6 +594,224 @@ void STM_PendSV_trigger(void)
 }
 
 
+/**
+ * @brief Enable a spare interrupt, one that @ref Spare_IRQHandler handles in
+ *      the vector table, at a priority from MAX_SYSCALL_PRIO up to PendSV's
+ * @param[in] irqn  interrupt number
+ * @param[in] prio  interrupt priority, only the upper bits are implemented
+ * @param[in] cb    callback of all spare interrupts
+ * @return 0 on success, -1 if the interrupt is not spare, the priority is out
+ *      of range, or the driver is built without CONFIG_SST
+ */
+int STM_spare_irq_init(uint32_t irqn, uint32_t prio, Irq_Callback cb)
+{
+#ifdef CONFIG_SST
+    const uint32_t *vectors;
+
+    vectors = (const uint32_t *)*SCB_VTOR;
+    if(irqn >= NVIC_IRQ_COUNT || vectors[NVIC_IRQ_OFFSET + irqn] != (uint32_t)&Spare_IRQHandler
+        || prio < MAX_SYSCALL_PRIO || prio >= (PENDSV_PRIO >> 16)) {
+        return -1;
+    }
+
+    spare_irq_cb = cb;
+    NVIC_IPR[irqn] = (uint8_t)prio;
+    NVIC_ISER[irqn >> 5] = 0x1UL << (irqn & 0x1FUL);
+
+    asm("dsb");
+    asm("isb");
+
+    return 0;
+#else
+    (void)irqn;
+    (void)prio;
+    (void)cb;
+
+    return -1;
+#endif /* CONFIG_SST */
+}
+
+/**
+ * @brief Pend a spare interrupt. Taken before this returns, if its priority
+ *      is above the current execution priority
+ * @param[in] irqn  interrupt number
+ */
+void STM_spare_irq_pend(uint32_t irqn)
+{
+    NVIC_ISPR[irqn >> 5] = 0x1UL << (irqn & 0x1FUL);
+
+    asm("dsb");
+    asm("isb");
+}
+
+/**
+ * @brief Attach a handler to an interrupt in the vector table copied to RAM,
+ *      and enable it. The interrupt is disabled while the handler and its
+ *      priority are changed, so it is never taken half-way
+ * @param[in] irqn      interrupt number
+ * @param[in] handler   handler, or 0 to disable the interrupt and restore the
+ *      handler of the vector table in flash
+ * @param[in] prio      interrupt priority, only the upper bits are implemented
+ * @return 0 on success, -1 if the interrupt number is out of range, or VTOR
+ *      does not point to the copy in RAM
+ */
+int STM_irq_attach(uint32_t irqn, Irq_Handler handler, uint32_t prio)
+{
+    uint32_t *vectors;
+
+    vectors = (uint32_t *)*SCB_VTOR;
+    if(irqn >= NVIC_IRQ_COUNT || vectors != __ram_vectors_start || prio > 0xFFUL) {
+        return -1;
+    }
+
+    NVIC_ICER[irqn >> 5] = 0x1UL << (irqn & 0x1FUL);
+    asm("dsb");
+    asm("isb");
+
+    if(!handler) {
+        vectors[NVIC_IRQ_OFFSET + irqn] = __Vectors[NVIC_IRQ_OFFSET + irqn];
+        asm("dsb");
+        return 0;
+    }
+
+    vectors[NVIC_IRQ_OFFSET + irqn] = (uint32_t)handler;
+    NVIC_IPR[irqn] = (uint8_t)prio;
+
+    /* The new entry must be in memory before the interrupt can fetch it */
+    asm("dsb");
+    NVIC_ISER[irqn >> 5] = 0x1UL << (irqn & 0x1FUL);
+    asm("dsb");
+    asm("isb");
+
+    return 0;
+}
+
+/**
+ * @brief Check whether running in an exception handler, from the active
+ *      exception number in IPSR, which is 0 in thread mode
+ * @return nonzero in handler mode, 0 in thread mode
+ */
+uint32_t STM_irq_active(void)
+{
+    uint32_t ipsr;
+
+    asm volatile("mrs %0, ipsr" : "=r"(ipsr));
+    return ipsr;
+}
+
+/**
+ * @brief Sleep until the next interrupt
+ */
+void STM_wait_for_interrupt(void)
+{
+    asm("wfi");
+}
+
+/**
+ * @brief Data synchronization and instruction synchronization barriers
+ */
+void STM_sync_barriers(void)
+{
+    asm("dsb");
+    asm("isb");
+}
+
+
+/**
+ * @brief Enter a critical section by raising BASEPRI to @ref MAX_SYSCALL_PRIO.
+ *      BASEPRI_MAX only ever raises the mask, so nested sections keep the
+ *      outer one. Interrupts above MAX_SYSCALL_PRIO stay enabled. Writes to
+ *      BASEPRI are ignored in unprivileged mode, so this masks nothing when
+ *      called from an unprivileged task
+ * @return previous BASEPRI
+ */
+uint32_t STM_critical_enter(void)
+{
+    uint32_t prev;
+
+    __asm__ __volatile__ (
+        "mrs %0, basepri        \n"
+        "msr basepri_max, %1    \n"
+        "isb                    \n"
+        : "=&r" (prev)                          /* output operand */
+        : "r" (MAX_SYSCALL_PRIO)                /* input operand */
+        : "memory"                              /* no memory accesses move out of the section */
+    );
+
+    return prev;
+}
+
+/**
+ * @brief Exit a critical section, restoring BASEPRI
+ * @param[in] state     previous BASEPRI returned by @ref STM_critical_enter
+ */
+void STM_critical_exit(uint32_t state)
+{
+    __asm__ __volatile__ (
+        "msr basepri, %0        \n"
+        :
+        : "r" (state)
+        : "memory"
+    );
+}
+
+/**
+ * @brief Read the tick count and the SysTick counts elapsed in the current
+ *      tick as one sample. The sample is taken again if the SysTick handler
+ *      runs, or the counter reloads, in between. A reload not yet counted by
+ *      the handler, as the caller masks SysTick, is counted from the pending
+ *      SysTick exception
+ * @param[out] elapsed  counts elapsed since the latest tick
+ *
+ * @return tick count
+ */
+static uint64_t STM_systick_sample(uint32_t *elapsed)
+{
+    uint64_t ticks;
+    uint32_t first, current, pending;
+
+    do {
+        ticks = STM_TICK_get();
+        first = *SYSTICK_CVR;
+        pending = *NVIC_ICSR & ICSR_PENDSTSET;
+        current = *SYSTICK_CVR;
+    } while(current > first || ticks != STM_TICK_get());
+
+    /* The counter counts down from the reload value */
+    *elapsed = *SYSTICK_RVR - current;
+
+    return pending ? ticks + 1 : ticks;
+}
+
+/**
+ * @brief Getter for the free running cycle counter
+ * @n Reads the DWT cycle counter, enabling it on first use. Boards without
+ *      one, such as QEMU, define CYCLES_FROM_SYSTICK to derive the count from
+ *      the tick count and the SysTick current value instead
+ * @return cycle count, wrapping around at 32 bits
+ */
+uint32_t STM_cycles_get(void)
+{
+#ifdef CYCLES_FROM_SYSTICK
+    uint32_t ticks, elapsed;
+
+    ticks = (uint32_t)STM_systick_sample(&elapsed);
+
+    /* SysTick counts down from the reload value once per cycle */
+    return ticks * (*SYSTICK_RVR + 0x1UL) + elapsed;
+#else
+    /* Enable the trace unit and the cycle counter if not done already */
+    if(!(*DWT_CTRL & DWT_CTRL_CYCCNTENA)) {
+        *DEMCR |= DEMCR_TRCENA;
+        *DWT_CYCCNT = 0x0UL;
+        *DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+    }
+
+    return *DWT_CYCCNT;
+#endif /* CYCLES_FROM_SYSTICK */
+}
+
+
 /**
  * @brief SysTick initialization function
  * @n Loads the tick interval register, populates callback, 
@@ -249,8 +822,9 @@ int STM_TICK_init(int ms, Tick_Callback cb)
     uint32_t temp;
     /* Populate the SysTick Reload register value, i.e. tick interval. This is
         (system clock freq / 1000) * milliseconds - 1 */
-    temp = (0x3D0900UL / 0x3E8UL) * ms - 0x01UL;
+    temp = (SYSTEM_CLOCK_HZ / 1000UL) * ms - 0x01UL;
     *SYSTICK_RVR = temp;
+    tick_ns = (uint32_t)ms * 1000000UL;
 
     /* Set SysTick priority to lowest */
     temp = *NVIC_SHPR3;
@@ -270,20 +844,79 @@ int STM_TICK_init(int ms, Tick_Callback cb)
     return 0;
 }
 
+#ifdef CONFIG_MPU
+/**
+ * @brief Enable the MPU with the task regions of the running task, which are
+ *      switched by @ref PendSV_Handler from then on. Privileged code keeps the
+ *      default memory map outside the regions. Violations raise MemManage
+ */
+static void STM_MPU_init(void)
+{
+    task_t *task;
+    uint32_t i;
+
+    task = task_switch.current_tcb;
+
+    *MPU_CTRL = 0x0UL;
+    *MPU_MAIR0 = MPU_MAIR0_VALUE;
+
+    /* Code and constants, for unprivileged tasks */
+    *MPU_RNR = MPU_CODE_REGION;
+    *MPU_RBAR = ((uint32_t)__text_start & ~(MPU_ALIGN - 1)) | MPU_RBAR_AP_RO;
+    *MPU_RLAR = (((uint32_t)__text_end - 1) & ~(MPU_ALIGN - 1)) | MPU_RLAR_NORMAL | MPU_RLAR_EN;
+
+    for(i = 0; i < OS_TASK_MPU_REGS / 2; i++) {
+        *MPU_RNR = MPU_TASK_REGION + i;
+        *MPU_RBAR = task->mpu_regs[2 * i];
+        *MPU_RLAR = task->mpu_regs[2 * i + 1];
+    }
+
+    *SHCSR |= SHCSR_MEMFAULTENA;
+    *MPU_CTRL = MPU_CTRL_ENABLE;
+
+    asm("dsb");
+    asm("isb");
+}
+#endif /* CONFIG_MPU */
+
 /**
  * @brief PendSV initialization function
- * @n Sets the priority of PendSV interrupt
+ * @n Sets the priority of PendSV interrupt, and of SVCall entering the kernel
+ *      from tasks, and enables the MPU regions switched by PendSV if built with
+ *      CONFIG_MPU, and the FPU if built with CONFIG_FPU. Runs before the
+ *      first task
+ * @param[in] cb    callback run by @ref PendSV_Handler before the context switch
  */
-int STM_PendSV_init(void)
+int STM_PendSV_init(PendSV_Callback cb)
 {
     uint32_t temp;
 
+    pendsv_cb = cb;
+
     /* Set PendSV priority to lower than SysTick*/
     temp = *NVIC_SHPR3;
     temp &= ~(PENDSV_PRIO_MASK);
     temp |= PENDSV_PRIO;
     *NVIC_SHPR3 = temp;
 
+    /* System calls run kernel code, at the priority of the kernel's critical sections.
+        Higher priority interrupts are not delayed by them */
+    temp = *NVIC_SHPR2;
+    temp &= ~(SVCALL_PRIO_MASK);
+    temp |= ((uint32_t)MAX_SYSCALL_PRIO << 24);
+    *NVIC_SHPR2 = temp;
+
+#ifdef CONFIG_MPU
+    STM_MPU_init();
+#endif /* CONFIG_MPU */
+
+#ifdef CONFIG_FPU
+    /* Give full access to the FPU coprocessors, CP10 and CP11 */
+    *CPACR |= CPACR_FPU_FULL;
+    asm("dsb");
+    asm("isb");
+#endif /* CONFIG_FPU */
+
     return 0;
 }
 
@@ -294,7 +927,32 @@ int STM_PendSV_init(void)
  */
 uint64_t STM_TICK_get(void)
 {
-    return systicks;
+    volatile uint32_t *words;
+    uint32_t high, low;
+
+    /* Read the words one at a time, again if a tick carried into the high word meanwhile */
+    words = (volatile uint32_t *)&systicks;
+    do {
+        high = words[1];
+        low = words[0];
+    } while(high != words[1]);
+
+    return ((uint64_t)high << 32) | low;
+}
+
+/**
+ * @brief Getter for the time since the tick was started, at the resolution
+ *      of the SysTick counter. Lock-free, may be called from interrupts
+ * @return nanoseconds
+ */
+uint64_t STM_time_get(void)
+{
+    uint64_t ticks;
+    uint32_t elapsed;
+
+    ticks = STM_systick_sample(&elapsed);
+
+    return ticks * tick_ns + (((uint64_t)elapsed * TIME_NS_PER_COUNT) >> 16);
 }
 
 
@@ -312,6 +970,21 @@ void STM_busy_sleep(int ms)
 }
 
 
+/**
+ * @brief Encode a memory region into the MPU_RBAR and MPU_RLAR values of an
+ *      MPU region. The start is rounded down, and the end up, to @ref MPU_ALIGN
+ * @param regs      RBAR and RLAR values
+ * @param start     start address of the region
+ * @param end       end address of the region, exclusive
+ * @param rbar      MPU_RBAR_* flags
+ * @param rlar      MPU_RLAR_* flags
+ */
+static void STM_MPU_region(uint32_t *regs, uint32_t start, uint32_t end, uint32_t rbar, uint32_t rlar)
+{
+    regs[0] = (start & ~(MPU_ALIGN - 1)) | rbar;
+    regs[1] = ((end - 1) & ~(MPU_ALIGN - 1)) | rlar | MPU_RLAR_EN;
+}
+
 /** @brief Initialize task stack for the first time
  *      as if it was returning from PendSV/context switch 
  *      to bootstrap the operation. See @ref context_switch
@@ -320,11 +993,36 @@ void STM_busy_sleep(int ms)
  */
 void STM_Task_Stack_init(task_t *task)
 {
-    uint32_t i;
+    const os_region_t *region;
+    uint32_t i, base, top;
     uint32_t* sp;
 
     sp = task->sp;
 
+    /* The MPU regions of the task. The lowest bytes of the stack are a guard region,
+        read-only, catching stack overflows before they reach the stack below. Note that
+        the first task runs on the boot stack, not its own */
+    top = (uint32_t)(sp + 1);
+    base = top - task->stack_sz;
+    STM_MPU_region(&task->mpu_regs[0], base, base + MPU_ALIGN,
+        MPU_RBAR_AP_PRIV_RO | MPU_RBAR_XN, MPU_RLAR_NORMAL);
+    STM_MPU_region(&task->mpu_regs[2], base + MPU_ALIGN, top,
+        MPU_RBAR_AP_RW | MPU_RBAR_XN, MPU_RLAR_NORMAL);
+
+    for(i = 0; i < OS_TASK_REGIONS; i++) {
+        region = &task->regions[i];
+        if(!region->size) {
+            task->mpu_regs[4 + 2 * i] = 0x0UL;
+            task->mpu_regs[5 + 2 * i] = 0x0UL;
+            continue;
+        }
+
+        STM_MPU_region(&task->mpu_regs[4 + 2 * i], (uint32_t)region->start,
+            (uint32_t)region->start + region->size,
+            ((region->flags & OS_REGION_RO) ? MPU_RBAR_AP_RO : MPU_RBAR_AP_RW) | MPU_RBAR_XN,
+            (region->flags & OS_REGION_DEVICE) ? MPU_RLAR_DEVICE : MPU_RLAR_NORMAL);
+    }
+
     /* A few funny values for debug traces */
     *sp-- = (uint32_t)SENTINEL;
     *sp-- = (uint32_t)SENTINEL;
@@ -350,6 +1048,10 @@ void STM_Task_Stack_init(task_t *task)
     *sp-- = (uint32_t)task->arg2;
     *sp-- = (uint32_t)task->arg1;
 
+    /* EXC_RETURN, returned with by the context switch, as the task's LR. The task returns
+        to the security state the kernel runs in, which also takes PendSV */
+    *sp-- = (*SCB_CPUID_NS) ? (EXC_RETURN_INITIAL | EXC_RETURN_SECURE) : EXC_RETURN_INITIAL;
+
     /* Rest of the general purpose registers (R11 - R4), contents don't matter */
     for(i = 11; i >= 4; i--) {
         *sp-- = i;
@@ -8,25 +8,68 @@
 /* =================== INCLUDES =============================== */
 #include <stdint.h>
 #include "uart.h"
+#include "system.h"
+#include "os.h"
 
 /* ========================= CONSTANTS ========================= */
 
+/* Peripheral base addresses. Overridable, so that the driver can be run against register mocks on host */
+#ifndef USART1_REG_BASE_ADDR
+#define USART1_REG_BASE_ADDR (uintptr_t)0x40013800
+#endif
+#ifndef RCC_REG_BASE_ADDR
+#define RCC_REG_BASE_ADDR (uintptr_t)0x46020C00
+#endif
+#ifndef GPIOA_REG_BASE_ADDR
+#define GPIOA_REG_BASE_ADDR (uintptr_t)0x42020000
+#endif
+#ifndef GPDMA1_REG_BASE_ADDR
+#define GPDMA1_REG_BASE_ADDR (uintptr_t)0x40020000
+#endif
+#ifndef NVIC_REG_BASE_ADDR
+#define NVIC_REG_BASE_ADDR (uintptr_t)0xE000E100
+#endif
+
 /* STM32U545XX UART registers, see 
  * https://www.st.com/resource/en/reference_manual/rm0456-stm32u5-series-armbased-32bit-mcus-stmicroelectronics.pdf
  */
-static volatile uint32_t * const UART0_CR1_REG      = (uint32_t*)0x40013800;    /* Control Register 1 */
-static volatile uint32_t * const UART0_BRR_REG      = (uint32_t*)0x4001380C;    /* Baud Rate Register */
-static volatile uint32_t * const UART0_TDR_REG      = (uint32_t*)0x40013828;    /* TX Data Register */
-static volatile uint32_t * const UART0_ISR_REG      = (uint32_t*)0x4001381C;    /* Interrupt Status Register */
+static volatile uint32_t * const UART0_CR1_REG      = (uint32_t*)(USART1_REG_BASE_ADDR + 0x00); /* Control Register 1 */
+static volatile uint32_t * const UART0_CR3_REG      = (uint32_t*)(USART1_REG_BASE_ADDR + 0x08); /* Control Register 3 */
+static volatile uint32_t * const UART0_BRR_REG      = (uint32_t*)(USART1_REG_BASE_ADDR + 0x0C); /* Baud Rate Register */
+static volatile uint32_t * const UART0_TDR_REG      = (uint32_t*)(USART1_REG_BASE_ADDR + 0x28); /* TX Data Register */
+static volatile uint32_t * const UART0_ISR_REG      = (uint32_t*)(USART1_REG_BASE_ADDR + 0x1C); /* Interrupt Status Register */
+static volatile uint32_t * const UART0_ICR_REG      = (uint32_t*)(USART1_REG_BASE_ADDR + 0x20); /* Interrupt flag Clear Register */
+static volatile uint32_t * const UART0_RDR_REG      = (uint32_t*)(USART1_REG_BASE_ADDR + 0x24); /* RX Data Register */
+
+/* NVIC registers for the USART1 and GPDMA1 channel 0 interrupts */
+#define USART1_IRQN         61                                                      /* USART1 interrupt number */
+#define GPDMA1_CH0_IRQN     29                                                      /* GPDMA1 channel 0 interrupt number */
+static volatile uint32_t * const NVIC_ISER0_REG     = (uint32_t*)(NVIC_REG_BASE_ADDR + 0x000);  /* Interrupt Set Enable Register 0 (IRQ 0-31) */
+static volatile uint32_t * const NVIC_ISER1_REG     = (uint32_t*)(NVIC_REG_BASE_ADDR + 0x004);  /* Interrupt Set Enable Register 1 (IRQ 32-63) */
+static volatile uint32_t * const NVIC_ICER0_REG     = (uint32_t*)(NVIC_REG_BASE_ADDR + 0x080);  /* Interrupt Clear Enable Register 0 (IRQ 0-31) */
+static volatile uint32_t * const NVIC_ICER1_REG     = (uint32_t*)(NVIC_REG_BASE_ADDR + 0x084);  /* Interrupt Clear Enable Register 1 (IRQ 32-63) */
+static volatile uint32_t * const NVIC_ISPR1_REG     = (uint32_t*)(NVIC_REG_BASE_ADDR + 0x104);  /* Interrupt Set Pending Register 1 (IRQ 32-63) */
+static volatile uint8_t * const NVIC_IPR_USART1_REG = (uint8_t*)(NVIC_REG_BASE_ADDR + 0x300 + USART1_IRQN);        /* Priority of USART1 */
+static volatile uint8_t * const NVIC_IPR_GPDMA1_CH0_REG = (uint8_t*)(NVIC_REG_BASE_ADDR + 0x300 + GPDMA1_CH0_IRQN); /* Priority of GPDMA1 ch. 0 */
+
+/* STM32U545XX GPDMA1 channel 0 registers */
+static volatile uint32_t * const DMA_CH0_FCR_REG    = (uint32_t*)(GPDMA1_REG_BASE_ADDR + 0x05C);    /* Flag Clear Register */
+static volatile uint32_t * const DMA_CH0_SR_REG     = (uint32_t*)(GPDMA1_REG_BASE_ADDR + 0x060);    /* Status Register */
+static volatile uint32_t * const DMA_CH0_CR_REG     = (uint32_t*)(GPDMA1_REG_BASE_ADDR + 0x064);    /* Control Register */
+static volatile uint32_t * const DMA_CH0_TR1_REG    = (uint32_t*)(GPDMA1_REG_BASE_ADDR + 0x090);    /* Transfer Register 1 */
+static volatile uint32_t * const DMA_CH0_TR2_REG    = (uint32_t*)(GPDMA1_REG_BASE_ADDR + 0x094);    /* Transfer Register 2 */
+static volatile uint32_t * const DMA_CH0_BR1_REG    = (uint32_t*)(GPDMA1_REG_BASE_ADDR + 0x098);    /* Block Register 1 */
+static volatile uint32_t * const DMA_CH0_SAR_REG    = (uint32_t*)(GPDMA1_REG_BASE_ADDR + 0x09C);    /* Source Address Register */
+static volatile uint32_t * const DMA_CH0_DAR_REG    = (uint32_t*)(GPDMA1_REG_BASE_ADDR + 0x0A0);    /* Destination Address Register */
+static volatile uint32_t * const DMA_CH0_LLR_REG    = (uint32_t*)(GPDMA1_REG_BASE_ADDR + 0x0CC);    /* Linked-List address Register */
 
 /* STM32U545XX RCC registers */
-#define RCC_REG_BASE_ADDR (uint32_t)0x46020C00
+static volatile uint32_t * const RCC_AHB1ENR_REG    = (uint32_t*)(RCC_REG_BASE_ADDR + 0x088);   /* AHB1 periph. clock ENable Reg. */
 static volatile uint32_t * const RCC_AHB2ENR1_REG   = (uint32_t*)(RCC_REG_BASE_ADDR + 0x08C);   /* AHB2 periph. clock ENable Reg. 1 */
 static volatile uint32_t * const RCC_APB2ENR_REG    = (uint32_t*)(RCC_REG_BASE_ADDR + 0x0A4);   /* APB2 periph. clock ENable Reg. */
 static volatile uint32_t * const RCC_CCIPR1_REG     = (uint32_t*)(RCC_REG_BASE_ADDR + 0x0E0);   /* Periph. Independent Clk. Conf. Reg. 1 */
 
 /* STM32U545XX GPIOA registers */
-#define GPIOA_REG_BASE_ADDR (uint32_t)0x42020000
 // static volatile uint32_t * const GPIOA_ODR_REG      = (uint32_t*)(GPIOA_REG_BASE_ADDR + 0x14);  /* GPIOA Output Data Register */
 static volatile uint32_t * const GPIOA_MODER_REG    = (uint32_t*)(GPIOA_REG_BASE_ADDR + 0x00);  /* GPIOA MODE Register */
 static volatile uint32_t * const GPIOA_OSPEEDR_REG  = (uint32_t*)(GPIOA_REG_BASE_ADDR + 0x08);  /* GPIOA Output SPEED Register */
@@ -37,6 +80,7 @@ static volatile uint32_t * const GPIOA_AFRH_REG     = (uint32_t*)(GPIOA_REG_BASE
 /* RCC register bits */
 #define USART_CLK_EN    (uint32_t)(1 << 14)                                         /* USART1 Clock enable bit */
 #define GPIOA_CLK_EN    (uint32_t)(1 << 0)                                          /* GPIOA Clock enable bit */
+#define GPDMA1_CLK_EN   (uint32_t)(1 << 0)                                          /* GPDMA1 Clock enable bit */
 
 /* GPIOA register bits */
 #define USART_TX_PIN    9                                                           /* USART1 TX pin PA9 */
@@ -72,12 +116,40 @@ static volatile uint32_t * const GPIOA_AFRH_REG     = (uint32_t*)(GPIOA_REG_BASE
 
 /* UART CTRL register control bits */
 #define USART_CR1_UE    (uint32_t)(1 << 0)          /* Usart Enable bit */
+#define USART_CR1_RE    (uint32_t)(1 << 2)          /* Receive Enable bit */
 #define USART_CR1_TE    (uint32_t)(1 << 3)          /* Transmit Enable bit */
+#define USART_CR1_RXNEIE (uint32_t)(1 << 5)         /* RX buffer Not Empty Interrupt Enable bit */
+#define USART_CR1_TXEIE (uint32_t)(1 << 7)          /* TX buffer Empty Interrupt Enable bit */
 #define UART_ENABLE (USART_CR1_TE | USART_CR1_UE)   /* UE + TE */
+#define USART_CR3_DMAT  (uint32_t)(1 << 7)          /* DMA enable Transmitter bit */
+
+/* GPDMA channel register bits */
+#define DMA_CR_EN       (uint32_t)(1 << 0)          /* channel ENable bit */
+#define DMA_CR_TCIE     (uint32_t)(1 << 8)          /* Transfer Complete Interrupt Enable bit */
+#define DMA_CR_DTEIE    (uint32_t)(1 << 10)         /* Data Transfer Error Interrupt Enable bit */
+#define DMA_CR_ULEIE    (uint32_t)(1 << 11)         /* Update Link Error Interrupt Enable bit */
+#define DMA_CR_USEIE    (uint32_t)(1 << 12)         /* User Setting Error Interrupt Enable bit */
+#define DMA_CR_START    (DMA_CR_EN | DMA_CR_TCIE | DMA_CR_DTEIE | DMA_CR_ULEIE | DMA_CR_USEIE)
+#define DMA_SR_TCF      (uint32_t)(1 << 8)          /* Transfer Complete Flag */
+#define DMA_SR_ERRORS   (uint32_t)(0x7 << 10)       /* Data Transfer, Update Link, and User Setting Error flags */
+#define DMA_FCR_ALL     (uint32_t)(0x7F << 8)       /* All flag clear bits */
+#define DMA_TR1_SINC    (uint32_t)(1 << 3)          /* Source address INCrement bit, byte wide source and destination */
+#define DMA_REQ_USART1_TX   25                      /* GPDMA1 request number of USART1 TX */
+#define DMA_MAX_BLOCK   0xFFFFUL                    /* Maximum bytes in one block, BNDT is 16 bits */
+
+/* NVIC register values */
+#define USART1_IRQ_BIT      (uint32_t)(1 << (USART1_IRQN - 32))     /* USART1 bit in ISER1/ISPR1 */
+#define GPDMA1_CH0_IRQ_BIT  (uint32_t)(1 << GPDMA1_CH0_IRQN)        /* GPDMA1 channel 0 bit in ISER0/ICER0 */
+#define UART_IRQ_PRIO       0xC0                                    /* Same as SysTick, so that the ISRs never nest */
 
 /* UART ISR register flags */
 #define USART_ISR_TXE   (uint32_t)(1 << 7)          /* TX buffer Empty */
 #define USART_ISR_TC    (uint32_t)(1 << 6)          /* Transmit Complete */
+#define USART_ISR_RXNE  (uint32_t)(1 << 5)          /* RX buffer Not Empty */
+#define USART_ISR_ORE   (uint32_t)(1 << 3)          /* OverRun Error */
+
+/* UART ICR register flags */
+#define USART_ICR_ORECF (uint32_t)(1 << 3)          /* OverRun Error Clear Flag */
 
 /* Easier mnemonics */
 #define UART_DATA_REGISTER      (UART0_TDR_REG)
@@ -85,11 +157,60 @@ static volatile uint32_t * const GPIOA_AFRH_REG     = (uint32_t*)(GPIOA_REG_BASE
 #define GPIOA_CLK_ENABLE_REG    (RCC_AHB2ENR1_REG)
 #define UART1_CLK_ENABLE_REG    (RCC_APB2ENR_REG)
 
+/** @brief Size of the TX ring buffer in bytes. Must be a power of two. Override to adjust */
+#ifndef UART_TX_BUFFER_SIZE
+#define UART_TX_BUFFER_SIZE 256UL
+#endif
+
+#if (UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1)) != 0
+#error "UART_TX_BUFFER_SIZE must be a power of two"
+#endif
+
+/** @brief Writers blocked on a full TX buffer are woken once this much space is free */
+#define UART_TX_WAKEUP_SPACE (UART_TX_BUFFER_SIZE / 2)
+
+/** @brief Timeout of a writer waiting for space, in case the buffer drained before it started waiting */
+#define UART_TX_WAIT_MS 10
+
+/** @brief Size of the RX ring buffer in bytes. Must be a power of two. Override to adjust */
+#ifndef UART_RX_BUFFER_SIZE
+#define UART_RX_BUFFER_SIZE 256UL
+#endif
+
+#if (UART_RX_BUFFER_SIZE & (UART_RX_BUFFER_SIZE - 1)) != 0
+#error "UART_RX_BUFFER_SIZE must be a power of two"
+#endif
+
+/** @brief Number of writes that can be queued for DMA. Must be a power of two. Override to adjust */
+#ifndef UART_DMA_QUEUE_LEN
+#define UART_DMA_QUEUE_LEN 8UL
+#endif
+
+#if (UART_DMA_QUEUE_LEN & (UART_DMA_QUEUE_LEN - 1)) != 0
+#error "UART_DMA_QUEUE_LEN must be a power of two"
+#endif
+
+/* ========================= TYPE DEFINITIONS ========================= */
+
+/** @brief A buffer queued for DMA transmit */
+typedef struct Uart_Dma_Request {
+    const char *buf;            /** @brief Buffer to send, owned by the driver until the callback */
+    uint32_t len;               /** @brief Number of bytes to send */
+    Uart_Write_Callback cb;     /** @brief Called when done, may be NULL */
+} uart_dma_req_t;
+
 /* ========================= FUNCTION DECLARATIONS ========================= */
 
 int STM_UART_init(void);
 int STM_UART_printc(const char *c);
 int STM_UART_printstr(const char *msg);
+int STM_UART_flush(void);
+int STM_UART_write(const char *buf, uint32_t len, Uart_Write_Callback cb);
+int STM_UART_read(char *buf, uint32_t len, int ms);
+int STM_UART_readline(char *buf, uint32_t len, int ms);
+int STM_UART_rx_notify(Uart_Rx_Callback cb);
+void USART1_IRQHandler(void);
+void GPDMA1_Channel0_IRQHandler(void);
 
 /* ========================= STATIC DATA ========================= */
 
@@ -97,10 +218,66 @@ int STM_UART_printstr(const char *msg);
 static const UartDriver drv = {
     &STM_UART_init,
     &STM_UART_printc,
-    &STM_UART_printstr
+    &STM_UART_printstr,
+    &STM_UART_flush,
+    &STM_UART_write,
+    &STM_UART_read,
+    &STM_UART_readline,
+    &STM_UART_rx_notify
 };
 const UartDriver *Uart_Driver = &drv;
 
+/** @brief TX ring buffer, drained by the USART1 interrupt */
+static char tx_buffer[UART_TX_BUFFER_SIZE];
+
+/** @brief Free-running TX buffer write index, only advanced by writers */
+static volatile uint32_t tx_head;
+
+/** @brief Free-running TX buffer read index, only advanced by the interrupt or a flush */
+static volatile uint32_t tx_tail;
+
+/** @brief Event for writers waiting for space in the TX buffer */
+static os_event_t tx_space;
+
+/** @brief Queue of buffers to send with DMA. The head is advanced by writers, the tail by the DMA interrupt */
+static uart_dma_req_t dma_queue[UART_DMA_QUEUE_LEN];
+static volatile uint32_t dma_head;
+static volatile uint32_t dma_tail;
+
+/** @brief Bytes of the oldest queued buffer already sent, and in the running transfer */
+static uint32_t dma_sent;
+static uint32_t dma_block;
+
+/** @brief Set while a DMA transfer is running */
+static volatile uint32_t dma_busy;
+
+/** @brief RX ring buffer, filled by the USART1 interrupt */
+static char rx_buffer[UART_RX_BUFFER_SIZE];
+
+/** @brief Free-running RX buffer write index, only advanced by the interrupt. Also the
+ *      sequence number readers wait on, see @ref uart_rx_wait */
+static volatile uint32_t rx_head;
+
+/** @brief Free-running RX buffer read index, only advanced by readers */
+static volatile uint32_t rx_tail;
+
+/** @brief Number of complete lines in the RX buffer */
+static volatile uint32_t rx_lines;
+
+/** @brief Last byte received, and last byte read, for telling apart CRLF from two line ends */
+static char rx_prev_in;
+static char rx_prev_out;
+
+/** @brief Number of bytes dropped because the RX buffer was full */
+static volatile uint32_t rx_dropped;
+
+/** @brief Events for readers waiting for any data, and for a complete line */
+static os_event_t rx_data;
+static os_event_t rx_line;
+
+/** @brief Called on each byte received, see @ref STM_UART_rx_notify */
+static volatile Uart_Rx_Callback rx_cb;
+
 /* ========================= FUNCTION DEFINITIONS ========================= */
 
 /**
@@ -129,6 +306,19 @@ void usart1_clock_enable(void)
     *UART1_CLK_ENABLE_REG = temp;
 }
 
+/**
+ * @brief Enable GPDMA1 peripheral clock in RCC
+ */
+void gpdma1_clock_enable(void)
+{
+    uint32_t temp;
+
+    /* Enable GPDMA1 clock */
+    temp = *RCC_AHB1ENR_REG;
+    temp |= GPDMA1_CLK_EN;
+    *RCC_AHB1ENR_REG = temp;
+}
+
 /**
  * @brief Initialize the USART1 peripheral
  * @note  Configures clock sources, pinmuxes, and enables the peripheral
@@ -139,9 +329,10 @@ int STM_UART_init(void)
 {
     uint32_t temp;
 
-    /* Enable GPIOA and USART1 clocks */
+    /* Enable GPIOA, USART1, and GPDMA1 clocks */
     gpioa_clock_enable();
     usart1_clock_enable();
+    gpdma1_clock_enable();
 
     /* set UART clock source to PCLK2 */
     temp = *RCC_CCIPR1_REG;
@@ -176,15 +367,178 @@ int STM_UART_init(void)
     /* Set baudrate (4MHz / 0x22 = 115200bps). TODO: figure out how on earth to do this automatically */
     *UART0_BRR_REG = 0x22;
 
+    /* Enable DMA requests for transmit. They are only served while the DMA channel is enabled */
+    *UART0_CR3_REG = USART_CR3_DMAT;
+
     /* Enable UART */
-    *UART_CONTROL_REGISTER = USART_CR1_UE | USART_CR1_TE;
+    *UART_CONTROL_REGISTER = USART_CR1_UE | USART_CR1_TE | USART_CR1_RE | USART_CR1_RXNEIE;
+
+    /* Configure DMA channel 0 for byte transfers from memory to the USART1 TX data register */
+    *DMA_CH0_CR_REG = 0;
+    *DMA_CH0_FCR_REG = DMA_FCR_ALL;
+    *DMA_CH0_TR1_REG = DMA_TR1_SINC;
+    *DMA_CH0_TR2_REG = DMA_REQ_USART1_TX;
+    *DMA_CH0_DAR_REG = (uint32_t)(uintptr_t)UART_DATA_REGISTER;
+    *DMA_CH0_LLR_REG = 0;
+
+    /* Enable the USART1 and DMA interrupts. The TX buffer empty interrupt itself is enabled when there is data to send */
+    *NVIC_IPR_USART1_REG = UART_IRQ_PRIO;
+    *NVIC_IPR_GPDMA1_CH0_REG = UART_IRQ_PRIO;
+    *NVIC_ISER1_REG = USART1_IRQ_BIT;
+    *NVIC_ISER0_REG = GPDMA1_CH0_IRQ_BIT;
 
     return 0;
 }
 
 
 /**
- * @brief Prints one character to USART1 output
+ * @brief Mask the USART1 and DMA interrupts, for sending by busy-waiting
+ */
+static inline void uart_irqs_mask(void)
+{
+    *NVIC_ICER1_REG = USART1_IRQ_BIT;
+    *NVIC_ICER0_REG = GPDMA1_CH0_IRQ_BIT;
+}
+
+/**
+ * @brief Unmask the USART1 and DMA interrupts
+ */
+static inline void uart_irqs_unmask(void)
+{
+    *NVIC_ISER1_REG = USART1_IRQ_BIT;
+    *NVIC_ISER0_REG = GPDMA1_CH0_IRQ_BIT;
+}
+
+/**
+ * @brief Start a DMA transfer of the oldest queued buffer, from where the previous
+ *      transfer left off. Buffers larger than a DMA block are sent in several transfers
+ */
+static void uart_dma_start(void)
+{
+    const uart_dma_req_t *req = &dma_queue[dma_tail & (UART_DMA_QUEUE_LEN - 1)];
+
+    dma_block = req->len - dma_sent;
+    if(dma_block > DMA_MAX_BLOCK) {
+        dma_block = DMA_MAX_BLOCK;
+    }
+    dma_busy = 1;
+
+    /* The TX buffer waits until DMA is done */
+    *UART_CONTROL_REGISTER &= ~USART_CR1_TXEIE;
+
+    *DMA_CH0_SAR_REG = (uint32_t)(uintptr_t)(req->buf + dma_sent);
+    *DMA_CH0_BR1_REG = dma_block;
+    *DMA_CH0_CR_REG = DMA_CR_START;
+}
+
+/**
+ * @brief Start the next DMA transfer, if there's a queued buffer, and
+ *      the TX buffer has been drained
+ */
+static void uart_dma_schedule(void)
+{
+    if(!dma_busy && (dma_head != dma_tail) && (tx_tail == tx_head)) {
+        uart_dma_start();
+    }
+}
+
+/**
+ * @brief Handle the end of a DMA transfer. Continues the buffer being sent,
+ *      or completes it and starts the next one. Once all queued buffers are sent,
+ *      hands over to the TX buffer
+ * @param[in] status    UART_OK if the transfer completed, UART_ERROR on a DMA error
+ */
+static void uart_dma_done(int status)
+{
+    const uart_dma_req_t *req = &dma_queue[dma_tail & (UART_DMA_QUEUE_LEN - 1)];
+    const char *buf = req->buf;
+    uint32_t len = req->len;
+    Uart_Write_Callback cb = req->cb;
+
+    dma_busy = 0;
+    dma_sent += dma_block;
+
+    /* Continue with the rest of the buffer */
+    if((status == UART_OK) && (dma_sent < len)) {
+        uart_dma_start();
+        return;
+    }
+
+    /* Free the queue entry before the callback, so that it can queue the next buffer */
+    dma_sent = 0;
+    dma_tail++;
+    if(cb) {
+        cb(buf, len, status);
+    }
+
+    if(dma_head != dma_tail) {
+        uart_dma_start();
+    } else if(tx_tail != tx_head) {
+        *UART_CONTROL_REGISTER |= USART_CR1_TXEIE;
+    }
+}
+
+/**
+ * @brief Complete running and queued DMA transfers by busy-waiting. The
+ *      interrupts must be masked
+ */
+static void uart_dma_drain(void)
+{
+    uint32_t status;
+
+    while(dma_busy) {
+        do {
+            status = *DMA_CH0_SR_REG;
+        } while((status & (DMA_SR_TCF | DMA_SR_ERRORS)) == 0);
+
+        *DMA_CH0_FCR_REG = DMA_FCR_ALL;
+        uart_dma_done((status & DMA_SR_ERRORS) ? UART_ERROR : UART_OK);
+    }
+}
+
+/**
+ * @brief Send the oldest byte of the TX buffer by busy-waiting, for when the
+ *      interrupt can not drain it. The interrupts must be masked
+ */
+static void uart_tx_poll(void)
+{
+    /* Let DMA writes in progress finish first, then keep the interrupt from sending */
+    uart_dma_drain();
+    *UART_CONTROL_REGISTER &= ~USART_CR1_TXEIE;
+
+    /* Busy-loop until TXE (Transmit buffer empty flag) is set */
+    while((*UART0_ISR_REG & USART_ISR_TXE) == 0) { ; }
+
+    /* Move byte to UART Transmit Data Register */
+    *UART_DATA_REGISTER = tx_buffer[tx_tail & (UART_TX_BUFFER_SIZE - 1)];
+    tx_tail++;
+}
+
+/**
+ * @brief Add a byte to the TX buffer. Blocks through the scheduler while
+ *      the buffer is full, or busy-waits if the scheduler is not running
+ *      or if called from an interrupt
+ * @param[in] c     byte to add
+ */
+static void uart_tx_put(char c)
+{
+    while((tx_head - tx_tail) >= UART_TX_BUFFER_SIZE) {
+        if(IRQ_active() || (event_wait(&tx_space, UART_TX_WAIT_MS) == OS_ERROR)) {
+            /* Make space by sending a byte, keeping the interrupts from sending too */
+            uart_irqs_mask();
+            uart_tx_poll();
+            uart_irqs_unmask();
+        }
+    }
+
+    tx_buffer[tx_head & (UART_TX_BUFFER_SIZE - 1)] = c;
+    tx_head++;
+}
+
+/**
+ * @brief Prints one character to USART1 output. Returns once the character
+ *      is buffered; the USART1 interrupt sends it
+ * @note  Writes from different tasks must not be concurrent
  * 
  * @return 0 on success, -1 on error
  */
@@ -195,20 +549,18 @@ int STM_UART_printc(const char *c)
         return -1;
     }
 
-    /* Busy-loop until TXE (Transmit buffer empty flag) is set */
-    while((*UART0_ISR_REG & USART_ISR_TXE) == 0) { ; }
+    uart_tx_put(*c);
 
-    /* Move byte to UART Transmit Data Register */
-    *UART_DATA_REGISTER = *c;
-
-    /* Busy-loop until TC (Transmit Complete flag) is set */
-    while((*UART0_ISR_REG & USART_ISR_TC) == 0) { ; }
+    /* Enable TXE interrupt to start sending */
+    *UART_CONTROL_REGISTER |= USART_CR1_TXEIE;
 
     return 0;
 }
 
 /**
- * @brief Prints a null-terminated string to USART1 output
+ * @brief Prints a null-terminated string to USART1 output. Returns once the
+ *      string is buffered; the USART1 interrupt sends it
+ * @note  Writes from different tasks must not be concurrent
  * 
  * @return 0 on success
  */
@@ -217,16 +569,336 @@ int STM_UART_printstr(const char *msg)
     
     /* Loop until null character is reached */
     while(*msg != '\0') {
+        uart_tx_put(*msg++);
 
-        /* Busy-loop until TXE (Transmit buffer empty flag) is set */
-        while((*UART0_ISR_REG & USART_ISR_TXE) == 0) { ; }
-
-        /* Move byte to UART Transmit Data Register */
-        *UART_DATA_REGISTER = (*msg++);
+        /* Enable TXE interrupt to start sending, already while buffering the rest */
+        *UART_CONTROL_REGISTER |= USART_CR1_TXEIE;
     }
 
+    return 0;
+}
+
+/**
+ * @brief Sends all buffered output by busy-waiting. Works with interrupts
+ *      disabled, e.g. on panic paths
+ *
+ * @return 0 on success
+ */
+int STM_UART_flush(void)
+{
+    /* Take over from the interrupts */
+    uart_irqs_mask();
+
+    do {
+        while(tx_tail != tx_head) {
+            uart_tx_poll();
+        }
+
+        /* Send the buffers queued for DMA, they wait for the TX buffer to drain */
+        uart_dma_schedule();
+        uart_dma_drain();
+    } while(tx_tail != tx_head);
+
+    *UART_CONTROL_REGISTER &= ~USART_CR1_TXEIE;
+
     /* Busy-loop until TC (Transmit Complete flag) is set */
     while((*UART0_ISR_REG & USART_ISR_TC) == 0) { ; }
 
+    uart_irqs_unmask();
+
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Queue a buffer to be sent to USART1 output with DMA, without copying it.
+ *      Queued buffers are sent in order, after the output buffered by the print functions
+ * @note  The buffer must stay valid until the callback is called. The callback is
+ *      called from an interrupt, or from @ref STM_UART_flush
+ * @note  Writes from different tasks must not be concurrent
+ * @param[in] buf   buffer to send
+ * @param[in] len   number of bytes to send
+ * @param[in] cb    called when the buffer has been sent, may be NULL
+ *
+ * @return 0 on success, -1 on error or if the queue is full
+ */
+int STM_UART_write(const char *buf, uint32_t len, Uart_Write_Callback cb)
+{
+    uart_dma_req_t *req;
+
+    /* Null-check parameters */
+    if(!buf || !len) {
+        return -1;
+    }
+
+    if((dma_head - dma_tail) >= UART_DMA_QUEUE_LEN) {
+        return -1;
+    }
+
+    req = &dma_queue[dma_head & (UART_DMA_QUEUE_LEN - 1)];
+    req->buf = buf;
+    req->len = len;
+    req->cb = cb;
+    dma_head++;
+
+    /* Pend the USART1 interrupt to start the transfer, unless one is already running */
+    *NVIC_ISPR1_REG = USART1_IRQ_BIT;
+
+    return 0;
+}
+
+/**
+ * @brief Check if a received byte ends a line. CR, LF, and CRLF each end one line
+ * @param[in] c     the byte
+ * @param[in] prev  the byte before it
+ * @return nonzero if the byte ends a line
+ */
+static inline uint32_t uart_rx_is_line_end(char c, char prev)
+{
+    return (c == '\r') || ((c == '\n') && (prev != '\r'));
+}
+
+/**
+ * @brief Add a received byte to the RX buffer, and wake readers. Called from the interrupt
+ * @param[in] c     received byte
+ */
+static void uart_rx_put(char c)
+{
+    if((rx_head - rx_tail) >= UART_RX_BUFFER_SIZE) {
+        rx_dropped++;
+        return;
+    }
+
+    rx_buffer[rx_head & (UART_RX_BUFFER_SIZE - 1)] = c;
+    rx_head++;
+
+    if(uart_rx_is_line_end(c, rx_prev_in)) {
+        (void)__atomic_fetch_add(&rx_lines, 1, __ATOMIC_SEQ_CST);
+    }
+    rx_prev_in = c;
+
+    if(rx_data) {
+        event_signal(&rx_data);
+    }
+
+    /* Line readers are woken on a complete line, or if the buffer fills up without one */
+    if(rx_line && (rx_lines || ((rx_head - rx_tail) >= UART_RX_BUFFER_SIZE))) {
+        event_signal(&rx_line);
+    }
+
+    if(rx_cb) {
+        rx_cb();
+    }
+}
+
+/**
+ * @brief Take the oldest byte from the RX buffer, which must not be empty
+ * @return the byte
+ */
+static char uart_rx_get(void)
+{
+    char c;
+
+    c = rx_buffer[rx_tail & (UART_RX_BUFFER_SIZE - 1)];
+    if(uart_rx_is_line_end(c, rx_prev_out)) {
+        (void)__atomic_fetch_sub(&rx_lines, 1, __ATOMIC_SEQ_CST);
+    }
+    rx_prev_out = c;
+    rx_tail++;
+
+    return c;
+}
+
+/**
+ * @brief Check if a reader can proceed
+ * @param[in] line  nonzero to check for a complete line, or a full buffer, instead of any data
+ * @return nonzero if there's data for the reader
+ */
+static inline uint32_t uart_rx_ready(uint32_t line)
+{
+    if(line) {
+        return rx_lines || ((rx_head - rx_tail) >= UART_RX_BUFFER_SIZE);
+    }
+    return rx_head != rx_tail;
+}
+
+/**
+ * @brief Wait through the scheduler until there's data for a reader, or the timeout
+ *      passes. Returns right away if the scheduler is not running. The write index
+ *      is read before checking for data, and the reader only starts waiting if it
+ *      has not moved since, so a byte received in between is not missed
+ * @param[in] event     event to wait for
+ * @param[in] line      nonzero to wait for a complete line
+ * @param[in] ms        timeout in milliseconds, or OS_WAIT_FOREVER
+ */
+static void uart_rx_wait(os_event_t *event, uint32_t line, int ms)
+{
+    uint64_t deadline = TICK_get() + (uint64_t)ms;
+    uint64_t now;
+    uint32_t head;
+    int wait = ms;
+
+    for(;;) {
+        head = rx_head;
+        if(uart_rx_ready(line)) {
+            return;
+        }
+
+        if(ms >= 0) {
+            now = TICK_get();
+            if(now >= deadline) {
+                return;
+            }
+            wait = (int)(deadline - now);
+        }
+
+        if(event_wait_seq(event, &rx_head, head, wait) == OS_ERROR) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Reads received bytes from USART1. Waits until at least one byte is
+ *      received, or the timeout passes. Does not wait if the scheduler is not running
+ * @param[out] buf  buffer to read to
+ * @param[in] len   size of the buffer
+ * @param[in] ms    timeout in milliseconds, 0 to not wait, or OS_WAIT_FOREVER
+ *
+ * @return number of bytes read, 0 on timeout, -1 on error
+ */
+int STM_UART_read(char *buf, uint32_t len, int ms)
+{
+    uint32_t n = 0;
+
+    /* Null-check parameters */
+    if(!buf || !len) {
+        return -1;
+    }
+
+    uart_rx_wait(&rx_data, 0, ms);
+
+    while((n < len) && (rx_head != rx_tail)) {
+        buf[n++] = uart_rx_get();
+    }
+
+    return (int)n;
+}
+
+/**
+ * @brief Reads a line received from USART1. The reader is only woken once a
+ *      complete line has been received. The line end is not stored, and the
+ *      line is null-terminated. A line too long for the buffer is truncated
+ * @param[out] buf  buffer to read to
+ * @param[in] len   size of the buffer, including the null terminator
+ * @param[in] ms    timeout in milliseconds, 0 to not wait, or OS_WAIT_FOREVER
+ *
+ * @return length of the line, -1 on timeout or error
+ */
+int STM_UART_readline(char *buf, uint32_t len, int ms)
+{
+    uint32_t n = 0;
+    char prev;
+    char c;
+
+    /* Null-check parameters */
+    if(!buf || !len) {
+        return -1;
+    }
+
+    uart_rx_wait(&rx_line, 1, ms);
+    if(!uart_rx_ready(1)) {
+        return -1;
+    }
+
+    while(rx_head != rx_tail) {
+        prev = rx_prev_out;
+        c = uart_rx_get();
+
+        if(uart_rx_is_line_end(c, prev)) {
+            break;
+        }
+
+        /* LF of a CRLF, the line ended at the CR */
+        if(c == '\n') {
+            continue;
+        }
+        if(n < (len - 1)) {
+            buf[n++] = c;
+        }
+    }
+    buf[n] = '\0';
+
+    return (int)n;
+}
+
+/**
+ * @brief Set the callback called from the USART1 interrupt on each byte
+ *      received, after the byte is in the RX buffer and readers are woken
+ * @param[in] cb    callback, or NULL to remove it
+ *
+ * @return 0
+ */
+int STM_UART_rx_notify(Uart_Rx_Callback cb)
+{
+    rx_cb = cb;
+
+    return 0;
+}
+
+/**
+ * @brief USART1 interrupt handler. Stores received bytes in the RX buffer.
+ *      Sends the next byte of the TX buffer when the TX data register is empty,
+ *      and wakes writers waiting for space. Starts queued DMA writes once the
+ *      TX buffer is drained
+ */
+void USART1_IRQHandler(void)
+{
+    uint32_t status;
+
+    status = *UART0_ISR_REG;
+
+    /* A byte was lost before the previous one was read */
+    if(status & USART_ISR_ORE) {
+        *UART0_ICR_REG = USART_ICR_ORECF;
+        rx_dropped++;
+    }
+
+    /* Reading the data register clears the flag */
+    if(status & USART_ISR_RXNE) {
+        uart_rx_put((char)*UART0_RDR_REG);
+    }
+
+    if((*UART_CONTROL_REGISTER & USART_CR1_TXEIE) && (*UART0_ISR_REG & USART_ISR_TXE)) {
+        if(dma_busy) {
+            /* DMA owns the data register, continue once it's done */
+            *UART_CONTROL_REGISTER &= ~USART_CR1_TXEIE;
+        } else if(tx_tail != tx_head) {
+            *UART_DATA_REGISTER = tx_buffer[tx_tail & (UART_TX_BUFFER_SIZE - 1)];
+            tx_tail++;
+        } else {
+            /* All sent, stop the interrupt until there is more */
+            *UART_CONTROL_REGISTER &= ~USART_CR1_TXEIE;
+        }
+
+        /* Wake waiting writers once there's room for a batch of writes */
+        if(tx_space && (UART_TX_BUFFER_SIZE - (tx_head - tx_tail)) >= UART_TX_WAKEUP_SPACE) {
+            event_signal(&tx_space);
+        }
+    }
+
+    uart_dma_schedule();
+}
+
+/**
+ * @brief GPDMA1 channel 0 interrupt handler. Handles the end of a DMA transfer
+ */
+void GPDMA1_Channel0_IRQHandler(void)
+{
+    uint32_t status;
+
+    status = *DMA_CH0_SR_REG;
+    if(status & (DMA_SR_TCF | DMA_SR_ERRORS)) {
+        *DMA_CH0_FCR_REG = DMA_FCR_ALL;
+        uart_dma_done((status & DMA_SR_ERRORS) ? UART_ERROR : UART_OK);
+    }
+}
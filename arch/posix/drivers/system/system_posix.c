@@ -0,0 +1,626 @@
+/*
+ * @file system_posix.c
+ * @brief POSIX host system utilities driver, for simulating the kernel
+ *      as a regular Linux process
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* =================== INCLUDES =============================== */
+#include <stdint.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <time.h>
+#include <ucontext.h>
+#include "system.h"
+#include "os.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Signal used to emulate the SysTick interrupt */
+#define TICK_SIGNAL         SIGALRM
+
+/** @brief Signal used to emulate the spare interrupts, raised when one is pended */
+#define SPARE_IRQ_SIGNAL    SIGUSR1
+
+/** @brief Number of spare interrupts, all interrupts are spare on host */
+#define SPARE_IRQ_COUNT     32UL
+
+/** @brief Priority of the code outside spare interrupts, lower than any of them */
+#define SPARE_IRQ_IDLE      0x100UL
+
+/** @brief Critical section state bits, the emulated interrupts blocked on entry */
+#define CRITICAL_TICK       0x1UL
+#define CRITICAL_SPARE_IRQ  0x2UL
+
+/** @brief Entries of the task state list, see task_state_e in os.c. These
+ *      are the same offsets PendSV_Handler uses on the Cortex-M33 port */
+#define STATE_NEXT          0
+#define STATE_RUNNING       3
+#define STATE_EJECTED       4
+#define STATE_WOKEN         5
+
+/** @brief Size of the heap region, as reserved by the target linker scripts */
+#define HEAP_SIZE           CONFIG_HEAP_SIZE
+
+#define STRINGIFY(x)        #x
+#define XSTRINGIFY(x)       STRINGIFY(x)
+
+/* ========================= FUNCTION DECLARATIONS ========================= */
+
+int POSIX_TICK_init(int ms, Tick_Callback cb);
+int POSIX_PendSV_init(PendSV_Callback cb);
+void POSIX_Task_Stack_init(task_t *task);
+uint32_t POSIX_Count_Leading_Zeros(uint32_t value);
+uint64_t POSIX_TICK_get(void);
+uint64_t POSIX_time_get(void);
+void POSIX_busy_sleep(int us);
+void POSIX_PendSV_trigger(void);
+void POSIX_wait_for_interrupt(void);
+void POSIX_sync_barriers(void);
+uint32_t POSIX_cycles_get(void);
+uint32_t POSIX_critical_enter(void);
+void POSIX_critical_exit(uint32_t state);
+uintptr_t POSIX_syscall(uint32_t num, uintptr_t a0, uintptr_t a1, uintptr_t a2);
+int POSIX_spare_irq_init(uint32_t irqn, uint32_t prio, Irq_Callback cb);
+void POSIX_spare_irq_pend(uint32_t irqn);
+int POSIX_irq_attach(uint32_t irqn, Irq_Handler handler, uint32_t prio);
+uint32_t POSIX_irq_active(void);
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief System driver vtable */
+static const SystemDriver drv = {
+    &POSIX_TICK_init,
+    &POSIX_PendSV_init,
+    &POSIX_Task_Stack_init,
+    &POSIX_Count_Leading_Zeros,
+    &POSIX_TICK_get,
+    &POSIX_time_get,
+    &POSIX_busy_sleep,
+    &POSIX_PendSV_trigger,
+    &POSIX_wait_for_interrupt,
+    &POSIX_sync_barriers,
+    &POSIX_cycles_get,
+    &POSIX_critical_enter,
+    &POSIX_critical_exit,
+    &POSIX_syscall,
+    &POSIX_spare_irq_init,
+    &POSIX_spare_irq_pend,
+    &POSIX_irq_attach,
+    &POSIX_irq_active
+};
+
+/** @brief System driver pointer, matching extern in os driver abstraction */
+const SystemDriver * const Sys_Driver = &drv;
+
+/** @brief Static pointers for ISR callbacks */
+static Tick_Callback tick_cb;
+static PendSV_Callback pendsv_cb;
+
+/** @brief System tick counter */
+static volatile uint64_t systicks;
+
+/** @brief Monotonic clock reading when the tick was started, in nanoseconds */
+static uint64_t time_start;
+
+/** @brief Saved CPU context of each task, takes the role of the
+ *      registers stacked by PendSV_Handler on the target */
+static ucontext_t task_contexts[MAX_NUM_TASKS];
+
+/** @brief Signal set of the emulated interrupts, the tick and spare interrupt
+ *      signals, used to "disable interrupts" */
+static sigset_t irq_sigset;
+
+/** @brief Set while an emulated ISR, SysTick or a spare interrupt, is running */
+static volatile sig_atomic_t in_isr;
+
+/** @brief Emulated PendSV pending bit, set when a switch is requested from the ISR */
+static volatile sig_atomic_t pendsv_pending;
+
+/** @brief Callback of the spare interrupts */
+static Irq_Callback spare_irq_cb;
+
+/** @brief Priority of each spare interrupt, as on the NVIC lower values preempt */
+static uint8_t spare_irq_prio[SPARE_IRQ_COUNT];
+
+/** @brief Pending spare interrupts, a bit per interrupt number */
+static volatile uint32_t spare_irq_pending;
+
+/** @brief Priority of the running spare interrupt, @ref SPARE_IRQ_IDLE if none */
+static volatile uint32_t spare_irq_active = SPARE_IRQ_IDLE;
+
+/** @brief Heap region, in place of the .heap section of the target linker scripts */
+uint8_t __attribute__((aligned(8))) __HeapStart[HEAP_SIZE];
+
+/** @brief End of the heap region */
+asm(".globl __HeapLimit\n.set __HeapLimit, __HeapStart + " XSTRINGIFY(HEAP_SIZE));
+
+#ifdef OS_BENCH
+/** @brief Nanoseconds spent in @ref POSIX_context_switch during the latest context switch */
+volatile uint32_t pendsv_cycles;
+
+/** @brief Always 0, there is no MPU to reprogram on host */
+volatile uint32_t pendsv_mpu_cycles;
+
+/** @brief Start of the ongoing context switch */
+static uint32_t pendsv_start;
+#endif /* OS_BENCH */
+
+/** @brief Extern linkage to definition of task states */
+extern uint32_t task_state_list[];
+
+/** @brief Extern linkage to definition of tasks to run, @ref OS_TASKS_INIT */
+extern task_t __tasks[];
+
+/** @brief Extern linkage to the running and next TCB */
+extern task_switch_t task_switch;
+
+/** @brief Extern linkage to the kernel functions of system calls */
+extern const os_syscall_t syscall_table[];
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/** @brief Debugging function, that will be called if a task function tries to return */
+static void loop_forever(void)
+{
+    while(1) {;}
+}
+
+/**
+ * @brief Entry point of every task context created by @ref POSIX_Task_Stack_init
+ * @param tasknum   index of the task in @ref __tasks
+ */
+static void POSIX_task_entry(int tasknum)
+{
+    task_t *task = &__tasks[tasknum];
+
+    task->fn(task->arg1, task->arg2, task->arg3);
+
+    /* Tasks must never return, same as on target */
+    loop_forever();
+}
+
+/**
+ * @brief Perform a context switch, the host equivalent of PendSV_Handler.
+ *      Moves the running task to EJECTED and the NEXT task to RUNNING, makes
+ *      the next TCB current, then swaps the CPU context. The tick signal must
+ *      be blocked by the caller.
+ */
+static void POSIX_context_switch(void)
+{
+    task_t *curr, *next;
+
+#ifdef OS_BENCH
+    pendsv_start = POSIX_cycles_get();
+#endif /* OS_BENCH */
+
+    /* Move current task from RUNNING to EJECTED, and the next task from NEXT to RUNNING */
+    task_state_list[STATE_EJECTED] = task_state_list[STATE_RUNNING];
+    task_state_list[STATE_RUNNING] = task_state_list[STATE_NEXT];
+    task_state_list[STATE_NEXT] = 0;
+
+    /* Make the next TCB the current one */
+    curr = task_switch.current_tcb;
+    next = task_switch.next_tcb;
+    task_switch.current_tcb = next;
+
+    /* Store the current context and resume the next one. Execution continues
+        from here once some other task switches back to this one */
+    (void)swapcontext(&task_contexts[curr - __tasks], &task_contexts[next - __tasks]);
+
+#ifdef OS_BENCH
+    /* Back in this task, the switch started in some other task is complete */
+    pendsv_cycles = POSIX_cycles_get() - pendsv_start;
+#endif /* OS_BENCH */
+}
+
+/**
+ * @brief Run the emulated PendSV: wake the tasks signalled from interrupts
+ *      with the PendSV callback, if any, then perform the context switch if
+ *      a task is selected. The emulated interrupts are blocked meanwhile
+ */
+static void POSIX_pendsv(void)
+{
+    sigset_t old;
+
+    (void)sigprocmask(SIG_BLOCK, &irq_sigset, &old);
+    if(task_state_list[STATE_WOKEN] && pendsv_cb) {
+        pendsv_cb();
+    }
+    if(task_state_list[STATE_NEXT]) {
+        POSIX_context_switch();
+    }
+    (void)sigprocmask(SIG_SETMASK, &old, (sigset_t*)0);
+}
+
+/**
+ * @brief Tick signal handler, the host equivalent of SysTick_Handler.
+ * @n Increments the system tick count, calls the tick callback (if set),
+ *      and performs the context switch if PendSV was requested meanwhile,
+ *      mimicking the tail-chaining of PendSV after SysTick on target.
+ * @param sig   unused
+ */
+static void POSIX_SysTick_Handler(int sig)
+{
+    (void)sig;
+
+    in_isr = 1;
+
+    systicks++;
+
+    if(tick_cb) {
+        tick_cb();
+    }
+
+    in_isr = 0;
+
+    if(pendsv_pending) {
+        pendsv_pending = 0;
+        POSIX_pendsv();
+    }
+}
+
+/**
+ * @brief Trigger the emulated PendSV interrupt
+ * @n From an interrupt handler, PendSV is deferred until the outermost one is
+ *      done, running once however many times it was triggered. From a task, it
+ *      runs right away, as PendSV would be taken immediately on target.
+ */
+void POSIX_PendSV_trigger(void)
+{
+    if(in_isr) {
+        pendsv_pending = 1;
+        return;
+    }
+
+    POSIX_pendsv();
+}
+
+/**
+ * @brief Sleep until the next signal, i.e. the next emulated interrupt
+ */
+void POSIX_wait_for_interrupt(void)
+{
+    sigset_t none;
+
+    (void)sigemptyset(&none);
+    (void)sigsuspend(&none);
+}
+
+/**
+ * @brief Full memory barrier, the closest thing to dsb/isb on host
+ */
+void POSIX_sync_barriers(void)
+{
+    __sync_synchronize();
+}
+
+/**
+ * @brief Enter a critical section by blocking the signals of the emulated
+ *      interrupts, which may call into the kernel
+ * @return CRITICAL_* bits of the signals that were blocked already
+ */
+uint32_t POSIX_critical_enter(void)
+{
+    sigset_t old;
+    uint32_t state;
+
+    (void)sigprocmask(SIG_BLOCK, &irq_sigset, &old);
+
+    state = sigismember(&old, TICK_SIGNAL) ? CRITICAL_TICK : 0;
+    if(sigismember(&old, SPARE_IRQ_SIGNAL)) {
+        state |= CRITICAL_SPARE_IRQ;
+    }
+
+    return state;
+}
+
+/**
+ * @brief Exit a critical section, unblocking the signals that were not
+ *      blocked already when entering. A spare interrupt pended meanwhile is
+ *      taken here
+ * @param[in] state     value returned by @ref POSIX_critical_enter
+ */
+void POSIX_critical_exit(uint32_t state)
+{
+    sigset_t unblock;
+
+    (void)sigemptyset(&unblock);
+    if(!(state & CRITICAL_TICK)) {
+        (void)sigaddset(&unblock, TICK_SIGNAL);
+    }
+    if(!(state & CRITICAL_SPARE_IRQ)) {
+        (void)sigaddset(&unblock, SPARE_IRQ_SIGNAL);
+    }
+    (void)sigprocmask(SIG_UNBLOCK, &unblock, (sigset_t*)0);
+}
+
+/**
+ * @brief Run the pending spare interrupts of higher priority than the running
+ *      one, highest first, as the NVIC would preempt it with them
+ */
+static void POSIX_spare_irq_dispatch(void)
+{
+    uint32_t active, prio, irqn, best;
+
+    active = spare_irq_active;
+
+    while(1) {
+        best = SPARE_IRQ_COUNT;
+        prio = active;
+        for(irqn = 0; irqn < SPARE_IRQ_COUNT; irqn++) {
+            if((spare_irq_pending & (0x1UL << irqn)) && spare_irq_prio[irqn] < prio) {
+                best = irqn;
+                prio = spare_irq_prio[irqn];
+            }
+        }
+        if(best == SPARE_IRQ_COUNT) {
+            return;
+        }
+
+        (void)__atomic_fetch_and(&spare_irq_pending, ~(0x1UL << best), __ATOMIC_SEQ_CST);
+        spare_irq_active = prio;
+        spare_irq_cb(best);
+        spare_irq_active = active;
+    }
+}
+
+/**
+ * @brief Spare interrupt signal handler, the host equivalent of
+ *      Spare_IRQHandler. Runs with the tick signal blocked, as spare interrupts
+ *      preempt SysTick, but not its own signal, for higher priority spare
+ *      interrupts pended by a callback to nest. Callbacks run on the stack of
+ *      the interrupted task, there is no shared stack on host
+ * @param sig   unused
+ */
+static void POSIX_Spare_IRQ_Handler(int sig)
+{
+    sig_atomic_t nested;
+
+    (void)sig;
+
+    /* Preempting SysTick or another spare interrupt, the outermost handler runs PendSV */
+    nested = in_isr;
+    in_isr = 1;
+
+    POSIX_spare_irq_dispatch();
+
+    in_isr = nested;
+    if(!nested && pendsv_pending) {
+        pendsv_pending = 0;
+        POSIX_pendsv();
+    }
+}
+
+/**
+ * @brief Enable a spare interrupt, installing the signal handler on first use
+ * @param[in] irqn  interrupt number, below @ref SPARE_IRQ_COUNT
+ * @param[in] prio  interrupt priority
+ * @param[in] cb    callback of all spare interrupts
+ * @return 0 on success, -1 if the interrupt number or priority is out of range
+ */
+int POSIX_spare_irq_init(uint32_t irqn, uint32_t prio, Irq_Callback cb)
+{
+    struct sigaction sa = {0};
+
+    if(irqn >= SPARE_IRQ_COUNT || prio >= SPARE_IRQ_IDLE) {
+        return -1;
+    }
+
+    if(!spare_irq_cb) {
+        sa.sa_handler = &POSIX_Spare_IRQ_Handler;
+        sa.sa_flags = SA_RESTART | SA_NODEFER;
+        (void)sigemptyset(&sa.sa_mask);
+        (void)sigaddset(&sa.sa_mask, TICK_SIGNAL);
+        if(sigaction(SPARE_IRQ_SIGNAL, &sa, (struct sigaction*)0) != 0) {
+            return -1;
+        }
+    }
+
+    spare_irq_cb = cb;
+    spare_irq_prio[irqn] = (uint8_t)prio;
+
+    return 0;
+}
+
+/**
+ * @brief Pend a spare interrupt by raising its signal, delivered before this
+ *      returns unless blocked by a critical section. A spare interrupt of
+ *      lower priority than the running one stays pending until it returns
+ * @param[in] irqn  interrupt number
+ */
+void POSIX_spare_irq_pend(uint32_t irqn)
+{
+    if(irqn >= SPARE_IRQ_COUNT) {
+        return;
+    }
+
+    (void)__atomic_fetch_or(&spare_irq_pending, 0x1UL << irqn, __ATOMIC_SEQ_CST);
+    (void)raise(SPARE_IRQ_SIGNAL);
+}
+
+/**
+ * @brief Attach an interrupt handler. There are no interrupts on host besides
+ *      the emulated spare ones, so nothing can be attached
+ * @param[in] irqn      interrupt number
+ * @param[in] handler   handler
+ * @param[in] prio      interrupt priority
+ * @return -1
+ */
+int POSIX_irq_attach(uint32_t irqn, Irq_Handler handler, uint32_t prio)
+{
+    (void)irqn;
+    (void)handler;
+    (void)prio;
+
+    return -1;
+}
+
+/**
+ * @brief Check whether an emulated interrupt, SysTick or a spare one, is running
+ * @return nonzero in an emulated interrupt, 0 in a task
+ */
+uint32_t POSIX_irq_active(void)
+{
+    return (uint32_t)in_isr;
+}
+
+/**
+ * @brief System call entry. There is no privilege separation on host, so the
+ *      kernel function is called directly
+ * @param[in] num   system call number
+ * @param[in] a0    first argument
+ * @param[in] a1    second argument
+ * @param[in] a2    third argument
+ * @return result of the call, OS_ERROR for an unknown number
+ */
+uintptr_t POSIX_syscall(uint32_t num, uintptr_t a0, uintptr_t a1, uintptr_t a2)
+{
+    if(num >= OS_SYSCALL_COUNT) {
+        return (uintptr_t)OS_ERROR;
+    }
+
+    return syscall_table[num](a0, a1, a2);
+}
+
+/**
+ * @brief Getter for the free running cycle counter. There is no portable
+ *      cycle counter on host, so this counts nanoseconds instead
+ * @return nanoseconds, wrapping around at 32 bits
+ */
+uint32_t POSIX_cycles_get(void)
+{
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec);
+}
+
+/**
+ * @brief Getter for the time since the tick was started
+ * @return nanoseconds
+ */
+uint64_t POSIX_time_get(void)
+{
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec - time_start;
+}
+
+/**
+ * @brief Tick initialization function
+ * @n Installs the tick signal handler, populates callback and starts an
+ *      interval timer firing every @p ms milliseconds
+ */
+int POSIX_TICK_init(int ms, Tick_Callback cb)
+{
+    struct sigaction sa = {0};
+    struct itimerval timer = {0};
+
+    /* Store the provided callback */
+    tick_cb = cb;
+
+    /* Count time from here on */
+    time_start = 0;
+    time_start = POSIX_time_get();
+
+    /* Restart interrupted system calls, such as UART writes to stdout */
+    sa.sa_handler = &POSIX_SysTick_Handler;
+    sa.sa_flags = SA_RESTART;
+    (void)sigemptyset(&sa.sa_mask);
+    if(sigaction(TICK_SIGNAL, &sa, (struct sigaction*)0) != 0) {
+        return -1;
+    }
+
+    /* Set the tick interval and start the timer */
+    timer.it_interval.tv_sec = ms / 1000;
+    timer.it_interval.tv_usec = (ms % 1000) * 1000;
+    timer.it_value = timer.it_interval;
+    if(setitimer(ITIMER_REAL, &timer, (struct itimerval*)0) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief PendSV initialization function
+ * @n Prepares the signal set used for masking the emulated interrupts during
+ *      context switches and critical sections
+ * @param[in] cb    callback run by the emulated PendSV before the context switch
+ */
+int POSIX_PendSV_init(PendSV_Callback cb)
+{
+    pendsv_cb = cb;
+
+    (void)sigemptyset(&irq_sigset);
+    (void)sigaddset(&irq_sigset, TICK_SIGNAL);
+    (void)sigaddset(&irq_sigset, SPARE_IRQ_SIGNAL);
+
+    return 0;
+}
+
+/**
+ * @brief Getter for tick count
+ * @return tick count
+ */
+uint64_t POSIX_TICK_get(void)
+{
+    return systicks;
+}
+
+/**
+ * @brief Blocking busy sleep
+ * @param[in] us    sleep interval in microseconds
+ */
+void POSIX_busy_sleep(int us)
+{
+    struct timespec start, now;
+    int64_t elapsed;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        (void)clock_gettime(CLOCK_MONOTONIC, &now);
+        elapsed = (int64_t)(now.tv_sec - start.tv_sec) * 1000000
+                + (now.tv_nsec - start.tv_nsec) / 1000;
+    } while(elapsed < us);
+}
+
+/** @brief Initialize the context of a task so that switching to it the first
+ *      time starts the task entry function on the task's own stack, see
+ *      @ref POSIX_context_switch
+ * @param task  task to initialize the context of
+ */
+void POSIX_Task_Stack_init(task_t *task)
+{
+    int tasknum = (int)(task - __tasks);
+    ucontext_t *ctx = &task_contexts[tasknum];
+
+    (void)getcontext(ctx);
+
+    /* The stack pointer given by the kernel is the last word of the task stack */
+    ctx->uc_stack.ss_sp = (uint8_t*)task->sp + 0x4UL - task->stack_sz;
+    ctx->uc_stack.ss_size = task->stack_sz;
+    ctx->uc_link = (ucontext_t*)0;
+
+    makecontext(ctx, (void (*)(void))&POSIX_task_entry, 1, tasknum);
+}
+
+/**
+ * @brief Count leading zeros
+ *
+ * @param value The unsigned integer to count leading zeros for
+ * @return The number of leading zeros (0-32)
+ */
+uint32_t POSIX_Count_Leading_Zeros(uint32_t value)
+{
+    /* Builtin is undefined for zero, unlike the CLZ instruction */
+    if(!value) {
+        return 32;
+    }
+    return (uint32_t)__builtin_clz(value);
+}
@@ -0,0 +1,266 @@
+/*
+ * @file uart_posix.c
+ * @brief POSIX host UART driver, printing to the standard output
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* =================== INCLUDES =============================== */
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include "uart.h"
+
+/* ========================= TYPE DEFINITIONS ========================= */
+
+/* os.h can not be included along with unistd.h, their sleep() declarations
+ * conflict. The kernel event interface is declared here instead */
+typedef volatile uint32_t os_event_t;
+#define OS_ERROR -1
+
+/* ========================= FUNCTION DECLARATIONS ========================= */
+
+int event_wait(os_event_t *event, int ms);
+
+int POSIX_UART_init(void);
+int POSIX_UART_printc(const char *c);
+int POSIX_UART_printstr(const char *msg);
+int POSIX_UART_flush(void);
+int POSIX_UART_write(const char *buf, uint32_t len, Uart_Write_Callback cb);
+int POSIX_UART_read(char *buf, uint32_t len, int ms);
+int POSIX_UART_readline(char *buf, uint32_t len, int ms);
+int POSIX_UART_rx_notify(Uart_Rx_Callback cb);
+
+/* ========================= STATIC DATA ========================= */
+
+
+static const UartDriver drv = {
+    &POSIX_UART_init,
+    &POSIX_UART_printc,
+    &POSIX_UART_printstr,
+    &POSIX_UART_flush,
+    &POSIX_UART_write,
+    &POSIX_UART_read,
+    &POSIX_UART_readline,
+    &POSIX_UART_rx_notify
+};
+const UartDriver *Uart_Driver = &drv;
+
+/** @brief Event never signalled, waited on with a timeout to poll stdin once per tick */
+static os_event_t rx_poll;
+
+/** @brief Last byte read, for telling apart CRLF from two line ends */
+static char rx_prev;
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/**
+ * @brief Initialize the UART, nothing to do as stdout is always open
+ *
+ * @return 0 on success
+ */
+int POSIX_UART_init(void)
+{
+    return 0;
+}
+
+/**
+ * @brief Prints one character to stdout
+ *
+ * @return 0 on success, -1 on error
+ */
+int POSIX_UART_printc(const char *c)
+{
+    /* Null-check parameters */
+    if(!c) {
+        return -1;
+    }
+
+    if(write(STDOUT_FILENO, c, 1) != 1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Prints a null-terminated string to stdout
+ *
+ * @return 0 on success, -1 on error
+ */
+int POSIX_UART_printstr(const char *msg)
+{
+    size_t len;
+
+    /* Null-check parameters */
+    if(!msg) {
+        return -1;
+    }
+
+    len = strlen(msg);
+    if(write(STDOUT_FILENO, msg, len) != (ssize_t)len) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Flush the output, nothing to do as writes to stdout are not buffered
+ *
+ * @return 0 on success
+ */
+int POSIX_UART_flush(void)
+{
+    return 0;
+}
+
+/**
+ * @brief Writes a buffer to stdout. The write is done before returning,
+ *      and the callback is called right away
+ *
+ * @return 0 on success, -1 on error
+ */
+int POSIX_UART_write(const char *buf, uint32_t len, Uart_Write_Callback cb)
+{
+    int status = UART_OK;
+
+    /* Null-check parameters */
+    if(!buf || !len) {
+        return -1;
+    }
+
+    if(write(STDOUT_FILENO, buf, len) != (ssize_t)len) {
+        status = UART_ERROR;
+    }
+
+    if(cb) {
+        cb(buf, len, status);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Wait until stdin is readable, or the timeout passes. Stdin is polled
+ *      once per tick, letting other tasks run in between. Blocks in poll()
+ *      if the scheduler is not running
+ * @param[in] ms    timeout in milliseconds, or -1 to wait forever
+ *
+ * @return 1 if readable, 0 on timeout or error
+ */
+static int posix_uart_rx_wait(int ms)
+{
+    struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+    struct timespec start;
+    struct timespec now;
+    int ret;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while(1) {
+        ret = poll(&pfd, 1, 0);
+        if(ret > 0) {
+            return 1;
+        }
+        if((ret < 0) && (errno != EINTR)) {
+            return 0;
+        }
+
+        if(ms >= 0) {
+            (void)clock_gettime(CLOCK_MONOTONIC, &now);
+            if((((now.tv_sec - start.tv_sec) * 1000) + ((now.tv_nsec - start.tv_nsec) / 1000000)) >= ms) {
+                return 0;
+            }
+        }
+
+        if(event_wait(&rx_poll, 1) == OS_ERROR) {
+            return (poll(&pfd, 1, ms) > 0);
+        }
+    }
+}
+
+/**
+ * @brief Reads bytes from stdin. Waits until at least one byte is available,
+ *      or the timeout passes
+ *
+ * @return number of bytes read, 0 on timeout, -1 on error
+ */
+int POSIX_UART_read(char *buf, uint32_t len, int ms)
+{
+    ssize_t n;
+
+    /* Null-check parameters */
+    if(!buf || !len) {
+        return -1;
+    }
+
+    if(!posix_uart_rx_wait(ms)) {
+        return 0;
+    }
+
+    n = read(STDIN_FILENO, buf, len);
+    if(n < 0) {
+        return -1;
+    }
+
+    return (int)n;
+}
+
+/**
+ * @brief Reads a line from stdin. CR, LF, and CRLF end a line. The line end
+ *      is not stored, and the line is null-terminated. A line too long for
+ *      the buffer is truncated. The timeout applies to each byte
+ *
+ * @return length of the line, -1 on timeout or error
+ */
+int POSIX_UART_readline(char *buf, uint32_t len, int ms)
+{
+    uint32_t n = 0;
+    char prev;
+    char c;
+
+    /* Null-check parameters */
+    if(!buf || !len) {
+        return -1;
+    }
+
+    while(1) {
+        if(!posix_uart_rx_wait(ms) || (read(STDIN_FILENO, &c, 1) != 1)) {
+            return -1;
+        }
+        prev = rx_prev;
+        rx_prev = c;
+
+        if((c == '\r') || ((c == '\n') && (prev != '\r'))) {
+            break;
+        }
+
+        /* LF of a CRLF, the line ended at the CR */
+        if(c == '\n') {
+            continue;
+        }
+        if(n < (len - 1)) {
+            buf[n++] = c;
+        }
+    }
+    buf[n] = '\0';
+
+    return (int)n;
+}
+
+/**
+ * @brief Receive callbacks are not supported, stdin is polled
+ * @param[in] cb    unused
+ *
+ * @return -1
+ */
+int POSIX_UART_rx_notify(Uart_Rx_Callback cb)
+{
+    (void)cb;
+
+    return -1;
+}
@@ -0,0 +1,703 @@
+/*
+ * @file bench.c
+ * @brief Kernel microbenchmark application, an alternative to os/app.c
+ *
+ * Measures the cost of kernel operations in cycles of the system driver's
+ * cycle counter (DWT CYCCNT on target, nanoseconds on host), and prints the
+ * results in lines of the form
+ *
+ *      BENCH <name> <stat>=0x<value>
+ *
+ * between "BENCH begin" and "BENCH end" lines, see scripts/bench.py.
+ *
+ * The measurements are run one after another by tasks of different priority:
+ *  1. bench_main records the boot-to-first-task time
+ *  2. bench_main measures SysTick ISR cost with no sleeping tasks, by spinning
+ *      on the cycle counter and recording the gaps caused by the interrupt
+ *  3. bench_main sleeps repeatedly; on the first sleep the sleeper tasks run
+ *      and go to sleep forever. The latency from the tick to bench_main
+ *      running is measured against a timestamp updated by bench_ping spinning
+ *  4. bench_main measures SysTick ISR cost again, now with the sleepers pending
+ *  5. bench_main goes to sleep forever, after which bench_ping and bench_pong
+ *      yield to each other to measure the round-trip and context switch cost,
+ *      and the part of the context switch reprogramming the MPU
+ *  6. bench_ping measures the cost of a print_hex call against print_fmt and
+ *      LOG calls printing the same, with the UART output flushed before each sample
+ *  7. bench_ping measures mem_alloc and mem_free calls of varying sizes, with
+ *      the system heap fragmented by allocations kept in between
+ *  8. bench_ping measures pool_alloc and pool_free calls, the fixed-size
+ *      block alternative to the heap
+ *  9. bench_ping measures an event_signal call made directly, and through a
+ *      system call as unprivileged tasks make it, for the cost of the call
+ * 10. bench_ping measures TICK_get and TIME_get calls, the cost of a timestamp
+ * 11. bench_ping runs two coroutines yielding to each other, for the round
+ *      trip of coroutine switches to compare against the yield round trip
+ * 12. bench_ping sleeps for bench_user to start, an unprivileged task that
+ *      only yields through system calls, and measures yield round trips
+ *      with it. Until then bench_user is never picked, bench_ping and
+ *      bench_pong coming before it in the task list
+ * 13. bench_ping starts bench_busy and then bench_busy_threshold, which spin
+ *      while bench_waker above them wakes up every tick, yielding now and
+ *      then. The context switches per second of the waker preempting the
+ *      plain one are compared against the other, whose preemption threshold
+ *      holds the waker back until it yields. Until then the three wait for
+ *      events without a timeout, counted with the sleepers
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+
+#include "uart.h"
+#include "system.h"
+#include "os.h"
+#include "print/print.h"
+#include "log/log.h"
+#include "heap/heap.h"
+#include "pool/pool.h"
+#include "coro/coro.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Number of samples taken of yield round trips */
+#define BENCH_YIELD_SAMPLES     1000
+
+/** @brief Number of samples taken of sleep-to-wake latency */
+#define BENCH_WAKE_SAMPLES      100
+
+/** @brief Number of samples taken of print and log calls */
+#define BENCH_PRINT_SAMPLES     20
+
+/** @brief Number of samples taken of heap calls, also the number of blocks kept allocated */
+#define BENCH_HEAP_SAMPLES      16
+
+/** @brief Number of samples taken of direct and system calls */
+#define BENCH_SYSCALL_SAMPLES   100
+
+/** @brief Number of SysTick interrupts sampled */
+#define BENCH_TICK_SAMPLES      100
+
+/** @brief Number of spins used to find out the cost of the spin loop itself */
+#define BENCH_CALIBRATE_SPINS   1000
+
+/** @brief A gap in spinning longer than this many loop iterations is an interrupt */
+#define BENCH_GAP_FACTOR        4
+
+/** @brief Measurements above this are broken, e.g. by a SysTick reload in between */
+#define BENCH_MAX_PLAUSIBLE     0x00100000UL
+
+/** @brief Number of windows the context switches are counted over, and their length */
+#define BENCH_SWITCH_SAMPLES    5
+#define BENCH_SWITCH_WINDOW_MS  100
+
+/** @brief Interval at which the busy tasks yield */
+#define BENCH_SWITCH_SLICE_MS   10
+
+/** @brief Sleep interval long enough to never wake up during the benchmark */
+#define BENCH_FOREVER           0x7FFFFFFF
+
+/** @brief Benchmark phases, see the file description */
+#define PHASE_SPIN              0
+#define PHASE_YIELD             1
+#define PHASE_DONE              2
+
+/* ========================= TYPE DEFINITIONS ========================= */
+
+/** @brief Statistics of one measurement */
+typedef struct Bench_Stat {
+    /** @brief Name of the measurement in the results */
+    const char *name;
+
+    /** @brief Smallest sample */
+    uint32_t min;
+
+    /** @brief Largest sample */
+    uint32_t max;
+
+    /** @brief Sum of all samples, for the average */
+    uint32_t sum;
+
+    /** @brief Number of samples */
+    uint32_t count;
+} bench_stat_t;
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief Cycle count just before the scheduler was started */
+static uint32_t boot_start;
+
+/** @brief Current benchmark phase */
+static volatile uint32_t phase = PHASE_SPIN;
+
+/** @brief Latest cycle count seen by the spinning task */
+static volatile uint32_t spin_stamp;
+
+/** @brief Results */
+static bench_stat_t boot_stat = { "boot_to_first_task", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t tick_idle_stat = { "systick_isr_0_sleepers", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t tick_sleepers_stat = { "systick_isr_8_sleepers", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t wake_stat = { "sleep_to_wake", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t yield_stat = { "yield_roundtrip", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t pendsv_stat = { "pendsv_switch", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t pendsv_mpu_stat = { "pendsv_mpu", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t print_hex_stat = { "print_hex_call", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t print_fmt_stat = { "print_fmt_call", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t log_stat = { "log_call", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t mem_alloc_stat = { "mem_alloc_call", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t mem_free_stat = { "mem_free_call", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t pool_alloc_stat = { "pool_alloc_call", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t pool_free_stat = { "pool_free_call", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t signal_stat = { "event_signal_call", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t sys_signal_stat = { "sys_event_signal_call", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t tick_get_stat = { "tick_get_call", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t time_get_stat = { "time_get_call", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t coro_stat = { "coro_roundtrip", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t user_yield_stat = { "user_yield_roundtrip", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t preempt_switch_stat = { "preempt_switches_per_s", 0xFFFFFFFFUL, 0, 0, 0 };
+static bench_stat_t threshold_switch_stat = { "threshold_switches_per_s", 0xFFFFFFFFUL, 0, 0, 0 };
+
+/** @brief Signalled to start each of the busy tasks, and the waker */
+static os_event_t bench_busy_go;
+static os_event_t bench_busy_threshold_go;
+static os_event_t bench_waker_go;
+
+/** @brief Signalled when a busy task is done, after counting it in bench_busy_runs */
+static os_event_t bench_busy_done;
+static volatile uint32_t bench_busy_runs;
+
+/** @brief Set while the waker is to keep waking up, and the number of times it has */
+static volatile uint32_t bench_waking;
+static volatile uint32_t bench_wakeups;
+
+/** @brief Pool of the pool call measurements, half of its blocks are kept allocated */
+OS_POOL_DEFINE(bench_pool, 64, 2 * BENCH_HEAP_SAMPLES);
+
+/** @brief Scheduler of the coroutine measurement, run by bench_ping itself */
+static OS_CO_SCHED_DEFINE(bench_sched);
+
+/** @brief Coroutines yielding to each other */
+static co_t bench_co_ping;
+static co_t bench_co_pong;
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/**
+ * @brief Add a sample into statistics
+ * @param stat      statistics to update
+ * @param value     the sample
+ */
+static void bench_add(bench_stat_t *stat, uint32_t value)
+{
+    if(value > BENCH_MAX_PLAUSIBLE) {
+        return;
+    }
+
+    if(value < stat->min) {
+        stat->min = value;
+    }
+    if(value > stat->max) {
+        stat->max = value;
+    }
+    stat->sum += value;
+    stat->count++;
+}
+
+/**
+ * @brief Print one result line
+ * @param name      name of the measurement
+ * @param stat      name of the statistic, including the separators
+ * @param value     the value
+ */
+static void bench_print(const char *name, const char *stat, uint32_t value)
+{
+    (void)UART_print_str("BENCH ");
+    (void)UART_print_str(name);
+    print_hex(stat, value);
+}
+
+/**
+ * @brief Print the results of one measurement
+ * @param stat      statistics to print
+ */
+static void bench_report(const bench_stat_t *stat)
+{
+    if(!stat->count) {
+        bench_print(stat->name, " samples=", 0);
+        return;
+    }
+
+    bench_print(stat->name, " samples=", stat->count);
+    bench_print(stat->name, " min=", stat->min);
+    bench_print(stat->name, " avg=", stat->sum / stat->count);
+    bench_print(stat->name, " max=", stat->max);
+}
+
+/**
+ * @brief Measure the cost of the SysTick ISR by spinning on the cycle counter.
+ *      The smallest step is the cost of the loop itself, anything much longer
+ *      is time spent in an interrupt
+ * @param stat      statistics to update
+ */
+static void bench_tick_isr(bench_stat_t *stat)
+{
+    uint32_t i, prev, now, delta;
+    uint32_t loop = 0xFFFFFFFFUL;
+
+    /* Find out the cost of the loop */
+    prev = CYCLES_get();
+    for(i = 0; i < BENCH_CALIBRATE_SPINS; i++) {
+        now = CYCLES_get();
+        delta = now - prev;
+        if(delta < loop) {
+            loop = delta;
+        }
+        prev = now;
+    }
+
+    /* Record the gaps */
+    while(stat->count < BENCH_TICK_SAMPLES) {
+        now = CYCLES_get();
+        delta = now - prev;
+        if(delta > loop * BENCH_GAP_FACTOR) {
+            bench_add(stat, delta - loop);
+        }
+        prev = now;
+    }
+}
+
+/**
+ * @brief Measure the cost of printing a value as text on target, and as a log
+ *      record. Output from earlier samples is flushed first, so that waiting
+ *      for room in the UART buffer is not counted
+ */
+static void bench_print_calls(void)
+{
+    uint32_t i, start, end;
+
+    for(i = 0; i < BENCH_PRINT_SAMPLES; i++) {
+        (void)UART_flush();
+        start = CYCLES_get();
+        print_hex("bench ", i);
+        end = CYCLES_get();
+        bench_add(&print_hex_stat, end - start);
+    }
+
+    for(i = 0; i < BENCH_PRINT_SAMPLES; i++) {
+        (void)UART_flush();
+        start = CYCLES_get();
+        print_fmt("bench 0x%08X", (unsigned int)i);
+        end = CYCLES_get();
+        bench_add(&print_fmt_stat, end - start);
+    }
+
+    for(i = 0; i < BENCH_PRINT_SAMPLES; i++) {
+        (void)UART_flush();
+        start = CYCLES_get();
+        LOG("bench 0x%08X", i);
+        end = CYCLES_get();
+        bench_add(&log_stat, end - start);
+    }
+
+    /* End the line of log records */
+    print("");
+}
+
+/** @brief Measure the cost of system heap calls. Every other block is kept
+ *      allocated, so that frees merge with free neighbours and allocations
+ *      split the holes left behind */
+static void bench_heap_calls(void)
+{
+    void *kept[BENCH_HEAP_SAMPLES];
+    void *ptr;
+    uint32_t i, start, end, size;
+
+    for(i = 0; i < BENCH_HEAP_SAMPLES; i++) {
+        size = 8 + (i * 37) % 96;
+
+        start = CYCLES_get();
+        ptr = mem_alloc(size);
+        end = CYCLES_get();
+        bench_add(&mem_alloc_stat, end - start);
+
+        kept[i] = mem_alloc(size);
+
+        start = CYCLES_get();
+        mem_free(ptr);
+        end = CYCLES_get();
+        bench_add(&mem_free_stat, end - start);
+    }
+
+    for(i = 0; i < BENCH_HEAP_SAMPLES; i++) {
+        mem_free(kept[i]);
+    }
+}
+
+/** @brief Measure the cost of pool calls, with blocks kept allocated in
+ *      between as in @ref bench_heap_calls */
+static void bench_pool_calls(void)
+{
+    void *kept[BENCH_HEAP_SAMPLES];
+    void *ptr;
+    uint32_t i, start, end;
+
+    for(i = 0; i < BENCH_HEAP_SAMPLES; i++) {
+        start = CYCLES_get();
+        ptr = pool_alloc(&bench_pool);
+        end = CYCLES_get();
+        bench_add(&pool_alloc_stat, end - start);
+
+        kept[i] = pool_alloc(&bench_pool);
+
+        start = CYCLES_get();
+        (void)pool_free(&bench_pool, ptr);
+        end = CYCLES_get();
+        bench_add(&pool_free_stat, end - start);
+    }
+
+    for(i = 0; i < BENCH_HEAP_SAMPLES; i++) {
+        (void)pool_free(&bench_pool, kept[i]);
+    }
+}
+
+/** @brief Measure the cost of a system call, against calling the same kernel
+ *      function directly. Nothing waits for the event, so no switch follows */
+static void bench_syscalls(void)
+{
+    static os_event_t event;
+    uint32_t i, start, end;
+
+    for(i = 0; i < BENCH_SYSCALL_SAMPLES; i++) {
+        start = CYCLES_get();
+        event_signal(&event);
+        end = CYCLES_get();
+        bench_add(&signal_stat, end - start);
+
+        start = CYCLES_get();
+        sys_event_signal(&event);
+        end = CYCLES_get();
+        bench_add(&sys_signal_stat, end - start);
+    }
+}
+
+/** @brief Measure the cost of reading the tick count, against the time at the
+ *      resolution of the system timer */
+static void bench_time_calls(void)
+{
+    uint32_t i, start, end;
+
+    for(i = 0; i < BENCH_SYSCALL_SAMPLES; i++) {
+        start = CYCLES_get();
+        (void)TICK_get();
+        end = CYCLES_get();
+        bench_add(&tick_get_stat, end - start);
+
+        start = CYCLES_get();
+        (void)TIME_get();
+        end = CYCLES_get();
+        bench_add(&time_get_stat, end - start);
+    }
+}
+
+/** @brief Coroutine that yields on every resume, for as long as the benchmark runs */
+static uint32_t bench_yielder(co_t *co)
+{
+    CO_BEGIN(co);
+    while(1) {
+        CO_YIELD(co);
+    }
+    CO_END(co);
+}
+
+/** @brief Measure the round trip of two coroutines yielding to each other,
+ *      a pass of their scheduler, as the yield round trip measures two tasks */
+static void bench_coro_calls(void)
+{
+    uint32_t i, start, end;
+
+    (void)co_spawn(&bench_sched, &bench_co_ping, &bench_yielder);
+    (void)co_spawn(&bench_sched, &bench_co_pong, &bench_yielder);
+
+    for(i = 0; i < BENCH_YIELD_SAMPLES; i++) {
+        start = CYCLES_get();
+        (void)co_sched_run(&bench_sched);
+        end = CYCLES_get();
+        bench_add(&coro_stat, end - start);
+    }
+}
+
+/** @brief Measure the round trip of yielding to @ref bench_user, which yields
+ *      back through a system call. bench_pong sees the benchmark done, and
+ *      bench_user starts, while this sleeps */
+static void bench_user_calls(void)
+{
+    uint32_t i, start, end;
+
+    sleep(1);
+
+    for(i = 0; i < BENCH_YIELD_SAMPLES; i++) {
+        start = CYCLES_get();
+        yield();
+        end = CYCLES_get();
+        bench_add(&user_yield_stat, end - start);
+    }
+}
+
+/** @brief Run one of the busy tasks, and wait until it is done. It is above
+ *      this task, which only runs again once the busy task waits */
+static void bench_busy_run(os_event_t *go)
+{
+    uint32_t runs;
+
+    runs = bench_busy_runs;
+    event_signal(go);
+    (void)event_wait_seq(&bench_busy_done, &bench_busy_runs, runs, OS_WAIT_FOREVER);
+}
+
+/** @brief Count the context switches per second caused by @ref bench_waker,
+ *      while spinning and yielding every BENCH_SWITCH_SLICE_MS
+ * @param stat      statistics to update
+ */
+static void bench_switches(bench_stat_t *stat)
+{
+    uint64_t now, end, slice;
+    uint32_t i, wakeups;
+
+    bench_waking = 1;
+    event_signal(&bench_waker_go);
+
+    for(i = 0; i < BENCH_SWITCH_SAMPLES; i++) {
+        wakeups = bench_wakeups;
+        now = TICK_get();
+        end = now + BENCH_SWITCH_WINDOW_MS;
+        slice = now + BENCH_SWITCH_SLICE_MS;
+        while((now = TICK_get()) < end) {
+            if(now >= slice) {
+                yield();
+                slice = now + BENCH_SWITCH_SLICE_MS;
+            }
+        }
+
+        /* Each wakeup switches to the waker and back */
+        bench_add(stat, 2 * (bench_wakeups - wakeups) * (1000 / BENCH_SWITCH_WINDOW_MS));
+    }
+
+    bench_waking = 0;
+}
+
+/** @brief Highest priority benchmark task, runs first and drives the
+ *      boot, SysTick and sleep-to-wake measurements */
+void bench_main(void* arg1, void* arg2, void* arg3)
+{
+    uint32_t i, now;
+
+    (void)arg1;
+    (void)arg2;
+    (void)arg3;
+
+    bench_add(&boot_stat, CYCLES_get() - boot_start);
+
+    /* Nothing is sleeping yet */
+    bench_tick_isr(&tick_idle_stat);
+
+    /* The first round lets the sleepers go to sleep, it is not recorded */
+    for(i = 0; i <= BENCH_WAKE_SAMPLES; i++) {
+        sleep(1);
+        now = CYCLES_get();
+        if(i > 0) {
+            bench_add(&wake_stat, now - spin_stamp);
+        }
+    }
+
+    /* All sleepers are now pending */
+    bench_tick_isr(&tick_sleepers_stat);
+
+    /* Hand over to the yield benchmark */
+    phase = PHASE_YIELD;
+    while(1) {
+        sleep(BENCH_FOREVER);
+    }
+}
+
+/** @brief Task that just sleeps, adding work to the SysTick ISR */
+void bench_sleeper(void* arg1, void* arg2, void* arg3)
+{
+    (void)arg1;
+    (void)arg2;
+    (void)arg3;
+
+    while(1) {
+        sleep(BENCH_FOREVER);
+    }
+}
+
+/** @brief Spins timestamping until the yield phase, then measures yield round
+ *      trips with @ref bench_pong, times print calls, and finally
+ *      prints all the results */
+void bench_ping(void* arg1, void* arg2, void* arg3)
+{
+    uint32_t i, start, end;
+
+    (void)arg1;
+    (void)arg2;
+    (void)arg3;
+
+    while(phase == PHASE_SPIN) {
+        spin_stamp = CYCLES_get();
+    }
+
+    for(i = 0; i < BENCH_YIELD_SAMPLES; i++) {
+        start = CYCLES_get();
+        yield();
+        end = CYCLES_get();
+        bench_add(&yield_stat, end - start);
+#ifdef OS_BENCH
+        bench_add(&pendsv_stat, pendsv_cycles);
+        if(pendsv_mpu_cycles) {
+            bench_add(&pendsv_mpu_stat, pendsv_mpu_cycles);
+        }
+#endif /* OS_BENCH */
+    }
+    phase = PHASE_DONE;
+
+    bench_print_calls();
+    bench_heap_calls();
+    bench_pool_calls();
+    bench_syscalls();
+    bench_time_calls();
+    bench_coro_calls();
+    bench_user_calls();
+    bench_busy_run(&bench_busy_go);
+    bench_busy_run(&bench_busy_threshold_go);
+
+    print("BENCH begin");
+    bench_report(&boot_stat);
+    bench_report(&tick_idle_stat);
+    bench_report(&tick_sleepers_stat);
+    bench_report(&wake_stat);
+    bench_report(&yield_stat);
+    bench_report(&pendsv_stat);
+    bench_report(&pendsv_mpu_stat);
+    bench_report(&print_hex_stat);
+    bench_report(&print_fmt_stat);
+    bench_report(&log_stat);
+    bench_report(&mem_alloc_stat);
+    bench_report(&mem_free_stat);
+    bench_report(&pool_alloc_stat);
+    bench_report(&pool_free_stat);
+    bench_report(&signal_stat);
+    bench_report(&sys_signal_stat);
+    bench_report(&tick_get_stat);
+    bench_report(&time_get_stat);
+    bench_report(&coro_stat);
+    bench_report(&user_yield_stat);
+    bench_report(&preempt_switch_stat);
+    bench_report(&threshold_switch_stat);
+    print("BENCH end");
+
+    while(1) {
+        sleep(BENCH_FOREVER);
+    }
+}
+
+/** @brief Yields back to @ref bench_ping until the benchmark is done */
+void bench_pong(void* arg1, void* arg2, void* arg3)
+{
+    (void)arg1;
+    (void)arg2;
+    (void)arg3;
+
+    while(phase != PHASE_DONE) {
+        yield();
+    }
+
+    while(1) {
+        sleep(BENCH_FOREVER);
+    }
+}
+
+/** @brief Unprivileged task yielding through system calls, for @ref
+ *      bench_user_calls. Touches nothing but its stack, and the code and
+ *      constants in flash */
+void bench_user(void* arg1, void* arg2, void* arg3)
+{
+    (void)arg1;
+    (void)arg2;
+    (void)arg3;
+
+    while(1) {
+        sys_yield();
+    }
+}
+
+/** @brief Spins counting context switches each time it is started, see @ref
+ *      bench_switches. Two of these run, with and without a threshold
+ * @param arg1  statistics to update
+ * @param arg2  event starting it
+ */
+void bench_busy(void* arg1, void* arg2, void* arg3)
+{
+    (void)arg3;
+
+    while(1) {
+        (void)event_wait((os_event_t *)arg2, OS_WAIT_FOREVER);
+        bench_switches((bench_stat_t *)arg1);
+        bench_busy_runs++;
+        event_signal(&bench_busy_done);
+    }
+}
+
+/** @brief Wakes up every tick while a busy task spins, each wakeup preempting
+ *      it unless it has a preemption threshold */
+void bench_waker(void* arg1, void* arg2, void* arg3)
+{
+    (void)arg1;
+    (void)arg2;
+    (void)arg3;
+
+    while(1) {
+        (void)event_wait(&bench_waker_go, OS_WAIT_FOREVER);
+        while(bench_waking) {
+            sleep(1);
+            bench_wakeups++;
+        }
+    }
+}
+
+/** @brief Register the tasks with the OS. The number of sleepers is in the
+ *      name of the SysTick measurement, counting the waker and busy tasks
+ *      waiting for their turn */
+OS_TASKS_INIT(
+    OS_TASK_DEFINE(bench_main, 0, 0, 0, OS_LOWEST_PRIO + 3),
+    OS_TASK_DEFINE(bench_waker, 0, 0, 0, OS_LOWEST_PRIO + 3),
+    OS_TASK_DEFINE(bench_sleeper, 0, 0, 0, OS_LOWEST_PRIO + 2),
+    OS_TASK_DEFINE(bench_sleeper, 0, 0, 0, OS_LOWEST_PRIO + 2),
+    OS_TASK_DEFINE(bench_sleeper, 0, 0, 0, OS_LOWEST_PRIO + 2),
+    OS_TASK_DEFINE(bench_sleeper, 0, 0, 0, OS_LOWEST_PRIO + 2),
+    OS_TASK_DEFINE(bench_sleeper, 0, 0, 0, OS_LOWEST_PRIO + 2),
+    OS_TASK_DEFINE(bench_busy, &preempt_switch_stat, (void *)&bench_busy_go, 0, OS_LOWEST_PRIO + 2),
+    OS_THRESHOLD_TASK_DEFINE(bench_busy, &threshold_switch_stat, (void *)&bench_busy_threshold_go, 0,
+        OS_LOWEST_PRIO + 2, OS_LOWEST_PRIO + 3),
+    OS_TASK_DEFINE(bench_ping, 0, 0, 0, OS_LOWEST_PRIO + 1),
+    OS_TASK_DEFINE(bench_pong, 0, 0, 0, OS_LOWEST_PRIO + 1),
+    OS_USER_TASK_DEFINE(bench_user, 0, 0, 0, OS_LOWEST_PRIO + 1),
+);
+
+/**
+ * @brief Entrypoint
+ */
+void main(void)
+{
+    /* Initialize UART for printing */
+    UART_init();
+
+    print("KantOS kernel benchmark");
+
+    /* Kick off scheduling. Will not return */
+    boot_start = CYCLES_get();
+    scheduler_start();
+
+    print("UNREACHABLE");
+
+    while(1) { ; }
+}
@@ -0,0 +1,11 @@
+# Generated by scripts/genconfig.py from Kconfig, prj.conf, do not edit
+CONFIG_MAX_TASKS := 5
+CONFIG_TASK_STACK_SIZE := 0x400
+CONFIG_IDLE_STACK_SIZE := 0x100
+CONFIG_MAIN_STACK_SIZE := 0x400
+CONFIG_TRACE := n
+CONFIG_SST := n
+CONFIG_SST_STACK_SIZE := 0x400
+CONFIG_MPU := y
+CONFIG_FPU := n
+CONFIG_HEAP_SIZE := 2048
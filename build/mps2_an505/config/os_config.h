@@ -0,0 +1,14 @@
+/* Generated by scripts/genconfig.py from Kconfig, prj.conf, do not edit */
+#ifndef __OS_CONFIG_H__
+#define __OS_CONFIG_H__
+
+#define CONFIG_MAX_TASKS 5
+#define CONFIG_TASK_STACK_SIZE 0x400
+#define CONFIG_IDLE_STACK_SIZE 0x100
+#define CONFIG_MAIN_STACK_SIZE 0x400
+/* CONFIG_TRACE is not set */
+#define CONFIG_MPU 1
+/* CONFIG_FPU is not set */
+#define CONFIG_HEAP_SIZE 2048
+
+#endif /* __OS_CONFIG_H__ */
@@ -21,19 +21,47 @@
 /** @brief SysTick ISR callback function pointer */
 typedef void (*Tick_Callback)(void);
 
+/** @brief PendSV callback function pointer, called before the context switch */
+typedef void (*PendSV_Callback)(void);
+
+/** @brief Spare interrupt callback function pointer, given the interrupt number */
+typedef void (*Irq_Callback)(uint32_t);
+
+/** @brief Interrupt handler function pointer, called by the hardware from the vector table */
+typedef void (*Irq_Handler)(void);
+
 /** @brief Abstract System Driver vtable definition */
 typedef struct SystemDriver {
     const int (* const TickInit)(int, Tick_Callback);
-    const int (* const PendSVInit)(void);
+    const int (* const PendSVInit)(PendSV_Callback);
     const void (* const TaskStackInit)(task_t *);
     const uint32_t (* const CountLeadingZeros)(uint32_t);
     const uint64_t (* const GetTicks)(void);
+    const uint64_t (* const GetTime)(void);
     const void (* const BusySleep)(int);
     const void (* const PendSVTrigger)(void);
+    const void (* const WaitForInterrupt)(void);
+    const void (* const SyncBarriers)(void);
+    const uint32_t (* const GetCycles)(void);
+    const uint32_t (* const CriticalEnter)(void);
+    const void (* const CriticalExit)(uint32_t);
+    const uintptr_t (* const Syscall)(uint32_t, uintptr_t, uintptr_t, uintptr_t);
+    const int (* const SpareIrqInit)(uint32_t, uint32_t, Irq_Callback);
+    const void (* const SpareIrqPend)(uint32_t);
+    const int (* const IrqAttach)(uint32_t, Irq_Handler, uint32_t);
+    const uint32_t (* const IrqActive)(void);
 } SystemDriver;
 
 /** @brief Pointer to SystemDriver implementation */
-extern const SystemDriver *Sys_Driver;
+extern const SystemDriver * const Sys_Driver;
+
+#ifdef OS_BENCH
+/** @brief Duration of the latest context switch in cycles, measured by the system driver */
+extern volatile uint32_t pendsv_cycles;
+
+/** @brief Part of the latest context switch spent reprogramming the MPU, 0 without one */
+extern volatile uint32_t pendsv_mpu_cycles;
+#endif /* OS_BENCH */
 
 /* =================== FUNCTION DEFINITIONS ================== */
 
@@ -71,18 +99,50 @@ static inline uint64_t TICK_get(void)
 }
 
 /**
- * @brief Set a callback for the PendSV interrupt
+ * @brief Get the time since startup in nanoseconds, at the resolution of the
+ *      system timer rather than of the tick. Lock-free, may be called from
+ *      tasks and interrupts, e.g. to timestamp events
+ *
+ * @return nanoseconds since the system tick was started
+ */
+static inline uint64_t TIME_get(void)
+{
+    if(!Sys_Driver) {
+        return (uint64_t)0;
+    }
+
+    return Sys_Driver->GetTime();
+}
+
+/**
+ * @brief Get the free running cycle counter, for measuring short intervals
+ * 
+ * @return number of cycles, wrapping around at 32 bits
+ */
+static inline uint32_t CYCLES_get(void)
+{
+    if(!Sys_Driver) {
+        return 0;
+    }
+
+    return Sys_Driver->GetCycles();
+}
+
+/**
+ * @brief Set a callback for the PendSV interrupt, called as it is entered
+ *      when the WOKEN entry of the task state list is not empty. A context
+ *      switch follows only if the NEXT entry is set after it
  * @param[in] cb    callback
  * 
  * @return SYSTEM_OK on success, SYSTEM_ERROR otherwise
  */
-static inline int PendSV_init()
+static inline int PendSV_init(PendSV_Callback cb)
 {
     if(!Sys_Driver) {
         return SYSTEM_ERROR;
     }
     
-    if(Sys_Driver->PendSVInit() != 0) {
+    if(Sys_Driver->PendSVInit(cb) != 0) {
         return SYSTEM_ERROR;
     }
     return SYSTEM_OK;
@@ -138,5 +198,149 @@ static inline uint32_t CountLeadingZeros(uint32_t value)
     return 0;
 }
 
+/**
+ * @brief Halt the CPU until the next interrupt arrives
+ */
+static inline void WaitForInterrupt(void)
+{
+    if(Sys_Driver) {
+        Sys_Driver->WaitForInterrupt();
+    }
+}
+
+/**
+ * @brief Wait for outstanding memory accesses to complete and flush the
+ *      instruction pipeline, e.g. after reconfiguring interrupts
+ */
+static inline void SyncBarriers(void)
+{
+    if(Sys_Driver) {
+        Sys_Driver->SyncBarriers();
+    }
+}
+
+/**
+ * @brief Enter a critical section, masking the interrupts that may call kernel
+ *      functions. Interrupts of higher priority than the kernel's are not
+ *      masked, see the system driver. Critical sections may nest
+ *
+ * @return state to restore with @ref CriticalExit
+ */
+static inline uint32_t CriticalEnter(void)
+{
+    if(Sys_Driver) {
+        return Sys_Driver->CriticalEnter();
+    }
+    return 0;
+}
+
+/**
+ * @brief Exit a critical section
+ * @param[in] state     state returned by the matching @ref CriticalEnter
+ */
+static inline void CriticalExit(uint32_t state)
+{
+    if(Sys_Driver) {
+        Sys_Driver->CriticalExit(state);
+    }
+}
+
+/**
+ * @brief Call a kernel function from a task, through the system call entry
+ *      of the architecture. Works from unprivileged tasks
+ * @param[in] num   system call number, OS_SYS_*
+ * @param[in] a0    first argument
+ * @param[in] a1    second argument
+ * @param[in] a2    third argument
+ *
+ * @return result of the kernel function, OS_ERROR for an unknown number
+ */
+static inline uintptr_t Syscall(uint32_t num, uintptr_t a0, uintptr_t a1, uintptr_t a2)
+{
+    if(!Sys_Driver) {
+        return (uintptr_t)OS_ERROR;
+    }
+
+    return Sys_Driver->Syscall(num, a0, a1, a2);
+}
+
+/**
+ * @brief Enable a spare interrupt, one without a handler of its own, to call
+ *      a callback when pended with @ref SpareIRQ_pend. The callbacks of all
+ *      spare interrupts run on one stack they share, see the system driver
+ * @param[in] irqn  interrupt number
+ * @param[in] prio  interrupt priority, lower values preempt higher ones. Must
+ *      be within the priorities allowed to call the kernel, and above PendSV
+ * @param[in] cb    callback, the same for all spare interrupts
+ *
+ * @return SYSTEM_OK on success, SYSTEM_ERROR if the interrupt is not spare,
+ *      the priority is out of range, or the driver has no spare interrupts
+ */
+static inline int SpareIRQ_init(uint32_t irqn, uint32_t prio, Irq_Callback cb)
+{
+    if(!Sys_Driver || !cb) {
+        return SYSTEM_ERROR;
+    }
+
+    if(Sys_Driver->SpareIrqInit(irqn, prio, cb) != 0) {
+        return SYSTEM_ERROR;
+    }
+    return SYSTEM_OK;
+}
+
+/**
+ * @brief Pend a spare interrupt enabled with @ref SpareIRQ_init. Its callback
+ *      runs right away if its priority is above the current one, otherwise
+ *      once the current interrupt or critical section ends
+ * @param[in] irqn  interrupt number
+ */
+static inline void SpareIRQ_pend(uint32_t irqn)
+{
+    if(Sys_Driver) {
+        Sys_Driver->SpareIrqPend(irqn);
+    }
+}
+
+/**
+ * @brief Attach a handler to an interrupt, writing it straight into the vector
+ *      table, and enable the interrupt. The hardware calls the handler with
+ *      no dispatcher in between. Attaching another handler swaps it at run
+ *      time, and attaching 0 disables the interrupt and restores the handler
+ *      it was built with
+ * @param[in] irqn      interrupt number
+ * @param[in] handler   handler, or 0 to detach
+ * @param[in] prio      interrupt priority, lower values preempt higher ones.
+ *      Handlers calling the kernel must be within the priorities allowed to
+ *      call it, see the system driver
+ *
+ * @return SYSTEM_OK on success, SYSTEM_ERROR if the interrupt number is out of
+ *      range, or the vector table can not be written
+ */
+static inline int IRQ_attach(uint32_t irqn, Irq_Handler handler, uint32_t prio)
+{
+    if(!Sys_Driver) {
+        return SYSTEM_ERROR;
+    }
+
+    if(Sys_Driver->IrqAttach(irqn, handler, prio) != 0) {
+        return SYSTEM_ERROR;
+    }
+    return SYSTEM_OK;
+}
+
+/**
+ * @brief Check whether running in an interrupt or exception handler, rather
+ *      than in a task
+ *
+ * @return nonzero in a handler, 0 in a task or without a driver
+ */
+static inline uint32_t IRQ_active(void)
+{
+    if(!Sys_Driver) {
+        return 0;
+    }
+
+    return Sys_Driver->IrqActive();
+}
 
 #endif /* __SYSTEM_H__ */
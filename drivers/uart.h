@@ -9,6 +9,8 @@
 #define __UART_H__
 
 /* =================== INCLUDES =============================== */
+#include <stdint.h>
+
 /* =================== MACRO DEFINITIONS ====================== */
 
 #define UART_OK 0
@@ -16,10 +18,21 @@
 
 /* =================== TYPE DEFINITIONS ======================= */
 
+/** @brief Completion callback of @ref UART_write, with the buffer written, and UART_OK or UART_ERROR */
+typedef void (*Uart_Write_Callback)(const char *, uint32_t, int);
+
+/** @brief Receive callback of @ref UART_rx_notify, called from the receive interrupt */
+typedef void (*Uart_Rx_Callback)(void);
+
 typedef struct UartDriver {
     const int (* const Initialize)(void);
     const int (* const PrintChar)(const char *);
     const int (* const PrintString)(const char *);
+    const int (* const Flush)(void);
+    const int (* const Write)(const char *, uint32_t, Uart_Write_Callback);
+    const int (* const Read)(char *, uint32_t, int);
+    const int (* const ReadLine)(char *, uint32_t, int);
+    const int (* const RxNotify)(Uart_Rx_Callback);
 } UartDriver;
 
 extern const UartDriver *Uart_Driver;
@@ -79,4 +92,101 @@ static inline int UART_print_str(const char* msg)
     return UART_OK;
 }
 
+/**
+ * @brief Transmit all buffered output, busy-waiting until done. Usable with
+ *      interrupts disabled, e.g. on panic paths
+ * 
+ * @return UART_OK on success, UART_ERROR otherwise
+ */
+static inline int UART_flush(void)
+{
+    if(!Uart_Driver) {
+        return UART_ERROR;
+    }
+    
+    if(Uart_Driver->Flush() != 0) {
+        return UART_ERROR;
+    }
+    return UART_OK;
+}
+
+/**
+ * @brief Write a buffer to UART asynchronously, without copying it. The buffer
+ *      must stay valid until the callback is called
+ * @param[in] buf   buffer to write
+ * @param[in] len   number of bytes to write
+ * @param[in] cb    called when the buffer has been written, may be NULL
+ * 
+ * @return UART_OK if the write was started or queued, UART_ERROR otherwise
+ */
+static inline int UART_write(const char *buf, uint32_t len, Uart_Write_Callback cb)
+{
+    if(!Uart_Driver) {
+        return UART_ERROR;
+    }
+    
+    if(Uart_Driver->Write(buf, len, cb) != 0) {
+        return UART_ERROR;
+    }
+    return UART_OK;
+}
+
+/**
+ * @brief Read received bytes from UART. Waits until at least one byte has
+ *      been received, or the timeout passes
+ * @param[out] buf  buffer to read to
+ * @param[in] len   size of the buffer
+ * @param[in] ms    timeout in milliseconds, 0 to not wait, or -1 to wait forever
+ * 
+ * @return number of bytes read, 0 on timeout, -1 on error
+ */
+static inline int UART_read(char *buf, uint32_t len, int ms)
+{
+    if(!Uart_Driver) {
+        return -1;
+    }
+    
+    return Uart_Driver->Read(buf, len, ms);
+}
+
+/**
+ * @brief Read a line from UART. Waits until a complete line has been received,
+ *      or the timeout passes. The line is null-terminated, without the line end
+ * @param[out] buf  buffer to read to
+ * @param[in] len   size of the buffer, including the null terminator
+ * @param[in] ms    timeout in milliseconds, 0 to not wait, or -1 to wait forever
+ * 
+ * @return length of the line, -1 on timeout or error
+ */
+static inline int UART_read_line(char *buf, uint32_t len, int ms)
+{
+    if(!Uart_Driver) {
+        return -1;
+    }
+    
+    return Uart_Driver->ReadLine(buf, len, ms);
+}
+
+/**
+ * @brief Set a callback, called from the receive interrupt each time a byte has
+ *      been received, for readers that must not block in @ref UART_read and
+ *      wait on their own terms instead. One callback at a time, setting
+ *      another replaces it
+ * @param[in] cb    callback, or NULL to remove it
+ *
+ * @return UART_OK on success, UART_ERROR if the driver receives without an
+ *      interrupt, and readers have to poll
+ */
+static inline int UART_rx_notify(Uart_Rx_Callback cb)
+{
+    if(!Uart_Driver) {
+        return UART_ERROR;
+    }
+
+    if(Uart_Driver->RxNotify(cb) != 0) {
+        return UART_ERROR;
+    }
+    return UART_OK;
+}
+
 #endif /* __UART_H__ */
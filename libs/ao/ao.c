@@ -0,0 +1,459 @@
+/*
+ * @file ao.c
+ * @brief Implementation of the active objects
+ *
+ * A state machine finds the superstate of a state by sending it the empty
+ * signal, so that the hierarchy is only written down in the states. An event
+ * is offered to the current state and up its superstates until one handles
+ * it. A transition exits the states up to the one taking it, then up to the
+ * innermost state containing the target too, and enters down to the target,
+ * following the initial transitions from there.
+ *
+ * An actor is in the ready list of its group while it has events queued. The
+ * event being handled stays queued until handled, so that a post only adds
+ * the actor to the list when its queue was empty, and the group task adds it
+ * back after an event if more are queued. Events count the queues holding
+ * them, and go back to their pool once handled by the last actor.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include "system.h"
+#include "os.h"
+#include "atomic/atomic.h"
+#include "pool/pool.h"
+#include "ao.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief Events of the reserved signals, sent to states by the state machine */
+static const ao_event_t ao_reserved[] = {
+    [AO_SIG_EMPTY] = { .sig = AO_SIG_EMPTY },
+    [AO_SIG_ENTRY] = { .sig = AO_SIG_ENTRY },
+    [AO_SIG_EXIT] = { .sig = AO_SIG_EXIT },
+    [AO_SIG_INIT] = { .sig = AO_SIG_INIT },
+};
+
+/** @brief Started actors, the latest first, walked to publish events */
+static ao_actor_t *ao_actors;
+
+/* ========================= FUNCTION DEFINITIONS ============== */
+
+/**
+ * @brief The top state, containing all others. Ignores all events
+ * @param[in] me    actor
+ * @param[in] e     event
+ *
+ * @return AO_RET_IGNORED
+ */
+uint32_t ao_top(ao_actor_t *me, const ao_event_t *e)
+{
+    (void)me;
+    (void)e;
+
+    return AO_RET_IGNORED;
+}
+
+/** @brief Send a reserved signal to a state */
+static inline uint32_t ao_trig(ao_actor_t *me, ao_state_t state, uint32_t sig)
+{
+    return state(me, &ao_reserved[sig]);
+}
+
+/**
+ * @brief Superstate of a state
+ * @param[in] me    actor
+ * @param[in] state state
+ *
+ * @return superstate, 0 for the top state
+ */
+static ao_state_t ao_super(ao_actor_t *me, ao_state_t state)
+{
+    if(state == &ao_top) {
+        return 0;
+    }
+
+    (void)ao_trig(me, state, AO_SIG_EMPTY);
+
+    return me->temp;
+}
+
+/** @brief Whether a state is a state or one of its superstates */
+static int ao_contains(ao_actor_t *me, ao_state_t outer, ao_state_t state)
+{
+    for(; state; state = ao_super(me, state)) {
+        if(state == outer) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Enter the states from below an entered state down to a target, and
+ *      follow the initial transitions of the target onwards
+ * @param[in] me        actor
+ * @param[in] from      entered state containing the target
+ * @param[in] target    target state
+ */
+static void ao_enter(ao_actor_t *me, ao_state_t from, ao_state_t target)
+{
+    ao_state_t path[AO_MAX_DEPTH];
+    ao_state_t state;
+    int depth;
+
+    while(1) {
+        depth = 0;
+        for(state = target; state && state != from && depth < AO_MAX_DEPTH;
+            state = ao_super(me, state)) {
+            path[depth++] = state;
+        }
+        while(depth > 0) {
+            (void)ao_trig(me, path[--depth], AO_SIG_ENTRY);
+        }
+        me->state = target;
+
+        if(ao_trig(me, target, AO_SIG_INIT) != AO_RET_TRAN) {
+            return;
+        }
+        from = target;
+        target = me->temp;
+    }
+}
+
+/**
+ * @brief Handle an event in the state machine of an actor, right away. Called
+ *      by the group task for queued events, and usable on its own, e.g. to
+ *      drive a state machine without a queue
+ * @param[in] me    started actor
+ * @param[in] e     event
+ */
+void ao_dispatch(ao_actor_t *me, const ao_event_t *e)
+{
+    ao_state_t source;
+    ao_state_t target;
+    ao_state_t state;
+    uint32_t ret;
+
+    /* Offer the event to the current state, and up its superstates until handled */
+    state = me->state;
+    do {
+        source = state;
+        ret = state(me, e);
+        state = me->temp;
+    } while(ret == AO_RET_SUPER);
+
+    if(ret != AO_RET_TRAN) {
+        return;
+    }
+    target = me->temp;
+
+    /* Exit the substates of the state taking the transition */
+    for(state = me->state; state != source; state = ao_super(me, state)) {
+        (void)ao_trig(me, state, AO_SIG_EXIT);
+    }
+
+    /* Exit up to the innermost state containing the target, itself on a self-transition */
+    if(source == target) {
+        (void)ao_trig(me, source, AO_SIG_EXIT);
+        state = ao_super(me, source);
+    } else {
+        for(state = source; !ao_contains(me, state, target); state = ao_super(me, state)) {
+            (void)ao_trig(me, state, AO_SIG_EXIT);
+        }
+    }
+
+    ao_enter(me, state, target);
+}
+
+/**
+ * @brief Whether an actor is in a state, directly or in one of its substates
+ * @param[in] me    started actor
+ * @param[in] state state
+ *
+ * @return 1 if in the state, 0 otherwise
+ */
+int ao_is_in(ao_actor_t *me, ao_state_t state)
+{
+    return ao_contains(me, state, me->state);
+}
+
+/**
+ * @brief Add an actor to the ready list of its group. Must be called in a
+ *      critical section
+ */
+static void ao_ready(ao_group_t *group, ao_actor_t *me)
+{
+    me->ready_next = 0;
+    if(group->ready_tail) {
+        group->ready_tail->ready_next = me;
+    } else {
+        group->ready_head = me;
+    }
+    group->ready_tail = me;
+    group->readied++;
+}
+
+/** @brief Count one more queue holding an event */
+static inline void ao_event_hold(const ao_event_t *e)
+{
+    if(e->pool) {
+        (void)atomic_add(&((ao_event_t *)e)->refs, 1);
+    }
+}
+
+/** @brief Count one less queue holding an event, freeing it after the last */
+static inline void ao_event_release(const ao_event_t *e)
+{
+    if(e->pool && atomic_sub(&((ao_event_t *)e)->refs, 1) == 0) {
+        (void)pool_free(e->pool, (void *)e);
+    }
+}
+
+/**
+ * @brief Allocate an event from a pool, see @ref AO_EVENT_NEW. The event is
+ *      freed once handled by all actors it is posted or published to, and if
+ *      posting or publishing it fails. May be called from interrupts
+ * @param[in] pool  pool
+ * @param[in] size  size of the event
+ * @param[in] sig   signal
+ *
+ * @return event, or 0 if the pool is empty or its blocks too small
+ */
+ao_event_t *ao_event_new(pool_t *pool, uint32_t size, uint32_t sig)
+{
+    ao_event_t *e;
+
+    if(size < sizeof(ao_event_t) || size > pool->block_size) {
+        return 0;
+    }
+
+    e = pool_alloc(pool);
+    if(e) {
+        e->sig = sig;
+        e->refs = 0;
+        e->pool = pool;
+    }
+
+    return e;
+}
+
+/**
+ * @brief Start an actor, taking its initial transition, and have a group run
+ *      it. The entry actions run in the caller. Must be called once per actor,
+ *      from main or a task, before events are posted to it
+ * @param[in] me    actor
+ * @param[in] group group
+ *
+ * @return OS_OK, or OS_ERROR if started already, or the initial transition
+ *      does not transition
+ */
+int ao_start(ao_actor_t *me, ao_group_t *group)
+{
+    ao_state_t initial;
+    uint32_t state;
+
+    if(me->group || !me->temp || !group) {
+        return OS_ERROR;
+    }
+
+    initial = me->temp;
+    me->state = &ao_top;
+    if(initial(me, &ao_reserved[AO_SIG_INIT]) != AO_RET_TRAN) {
+        return OS_ERROR;
+    }
+    ao_enter(me, &ao_top, me->temp);
+
+    state = CriticalEnter();
+    me->group = group;
+    me->next = ao_actors;
+    ao_actors = me;
+    CriticalExit(state);
+
+    return OS_OK;
+}
+
+/**
+ * @brief Post an event to an actor, to be handled by its group task. May be
+ *      called from tasks, interrupts, and actors
+ * @param[in] me    started actor
+ * @param[in] e     event
+ *
+ * @return OS_OK, or OS_ERROR if the actor is not started or its queue is full
+ */
+int ao_post(ao_actor_t *me, const ao_event_t *e)
+{
+    ao_group_t *group;
+    uint32_t state;
+    uint32_t head;
+
+    group = me->group;
+    ao_event_hold(e);
+
+    state = CriticalEnter();
+    head = me->head;
+    if(!group || head - me->tail >= me->size) {
+        me->lost++;
+        CriticalExit(state);
+        ao_event_release(e);
+        return OS_ERROR;
+    }
+    me->queue[head % me->size] = e;
+    me->head = head + 1;
+    if(head == me->tail) {
+        ao_ready(group, me);
+    }
+    CriticalExit(state);
+
+    if(group->ready) {
+        event_signal(&group->ready);
+    }
+
+    return OS_OK;
+}
+
+/**
+ * @brief Subscribe an actor to the events published with a signal
+ * @param[in] me    actor
+ * @param[in] sig   signal, below @ref AO_PUB_SIGNALS
+ *
+ * @return OS_OK, or OS_ERROR if the signal cannot be published
+ */
+int ao_subscribe(ao_actor_t *me, uint32_t sig)
+{
+    if(sig >= AO_PUB_SIGNALS) {
+        return OS_ERROR;
+    }
+
+    (void)atomic_or(&me->subscriptions[sig / 32], 1UL << (sig % 32));
+
+    return OS_OK;
+}
+
+/**
+ * @brief Unsubscribe an actor from the events published with a signal
+ * @param[in] me    actor
+ * @param[in] sig   signal, below @ref AO_PUB_SIGNALS
+ *
+ * @return OS_OK, or OS_ERROR if the signal cannot be published
+ */
+int ao_unsubscribe(ao_actor_t *me, uint32_t sig)
+{
+    if(sig >= AO_PUB_SIGNALS) {
+        return OS_ERROR;
+    }
+
+    (void)atomic_clear(&me->subscriptions[sig / 32], 1UL << (sig % 32));
+
+    return OS_OK;
+}
+
+/**
+ * @brief Publish an event, posting it to every started actor subscribed to its
+ *      signal. Takes time linear in the number of started actors. May be
+ *      called from tasks, interrupts, and actors
+ * @param[in] e     event
+ *
+ * @return OS_OK, or OS_ERROR if the signal cannot be published, or the queue
+ *      of a subscriber was full
+ */
+int ao_publish(const ao_event_t *e)
+{
+    ao_actor_t *me;
+    uint32_t word, bit;
+    int ret = OS_OK;
+
+    /* Hold the event while posting, for a subscriber not to free it before the rest get it */
+    ao_event_hold(e);
+
+    if(e->sig < AO_PUB_SIGNALS) {
+        word = e->sig / 32;
+        bit = 1UL << (e->sig % 32);
+        for(me = ao_actors; me; me = me->next) {
+            if((me->subscriptions[word] & bit) && ao_post(me, e) != OS_OK) {
+                ret = OS_ERROR;
+            }
+        }
+    } else {
+        ret = OS_ERROR;
+    }
+
+    ao_event_release(e);
+
+    return ret;
+}
+
+/**
+ * @brief Handle one queued event of the group, of the actor that became ready
+ *      first. Called by the group task, must not be called elsewhere while
+ *      it runs
+ * @param[in] group group
+ *
+ * @return 1 if an event was handled, 0 if none were queued
+ */
+int ao_group_dispatch(ao_group_t *group)
+{
+    ao_actor_t *me;
+    const ao_event_t *e;
+    uint32_t state;
+    uint32_t tail;
+
+    state = CriticalEnter();
+    me = group->ready_head;
+    if(me) {
+        group->ready_head = me->ready_next;
+        if(!group->ready_head) {
+            group->ready_tail = 0;
+        }
+    }
+    CriticalExit(state);
+
+    if(!me) {
+        return 0;
+    }
+
+    tail = me->tail;
+    e = me->queue[tail % me->size];
+    ao_dispatch(me, e);
+
+    /* Take the event off the queue, the actor stays ready if more are queued */
+    state = CriticalEnter();
+    me->tail = tail + 1;
+    if(me->tail != me->head) {
+        ao_ready(group, me);
+    }
+    CriticalExit(state);
+
+    ao_event_release(e);
+
+    return 1;
+}
+
+/**
+ * @brief Task running a group of actors, handling their events as they are
+ *      posted. Register with OS_TASK_DEFINE(ao_group_task, &group, 0, 0, prio)
+ * @param[in] arg1  group
+ * @param[in] arg2  unused
+ * @param[in] arg3  unused
+ */
+void ao_group_task(void *arg1, void *arg2, void *arg3)
+{
+    ao_group_t *group = (ao_group_t *)arg1;
+    uint32_t readied;
+
+    (void)arg2;
+    (void)arg3;
+
+    /* An actor made ready after the count is read is not missed while starting to wait */
+    while(1) {
+        readied = group->readied;
+        if(!ao_group_dispatch(group)) {
+            (void)event_wait_seq(&group->ready, &group->readied, readied, OS_WAIT_FOREVER);
+        }
+    }
+}
@@ -0,0 +1,198 @@
+/*
+ * @file ao.h
+ * @brief Active objects: event-driven actors running hierarchical state
+ *      machines, many of them sharing one kernel task
+ *
+ * An actor is a hierarchical state machine (HSM) with a queue of events. Its
+ * states are functions, @ref ao_state_t, that handle an event and return
+ * whether they handled it, took a transition with @ref AO_TRAN, or leave it
+ * to their superstate named with @ref AO_SUPER. States are entered and exited
+ * with the reserved AO_SIG_ENTRY and AO_SIG_EXIT events, and AO_SIG_INIT
+ * takes the initial transition into a substate. Transitions are local; a
+ * transition into a substate or a superstate of the source does not exit it.
+ *
+ * Actors are gathered into groups, each run by one kernel task, @ref
+ * ao_group_task, which handles the queued events of its actors one at a
+ * time, in the order their actors became ready. Actors of a group share the
+ * priority of its task, and their handlers must never block. Events are
+ * posted to one actor with @ref ao_post, or published to all actors that
+ * subscribed to their signal with @ref ao_publish. They are allocated from a
+ * pool with @ref AO_EVENT_NEW, and freed once all actors have handled them.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+#ifndef __AO_H__
+#define __AO_H__
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include "os.h"
+#include "pool/pool.h"
+
+/* =================== MACRO DEFINITIONS ====================== */
+
+/** @brief Reserved signals, sent by the state machine itself. Application signals
+ *      start from AO_SIG_USER */
+#define AO_SIG_EMPTY        0U      /* asks a state for its superstate */
+#define AO_SIG_ENTRY        1U      /* state is entered */
+#define AO_SIG_EXIT         2U      /* state is exited */
+#define AO_SIG_INIT         3U      /* initial transition of a state just entered */
+#define AO_SIG_USER         4U
+
+/** @brief Number of signals that can be published, the rest can only be posted */
+#define AO_PUB_SIGNALS      64U
+
+/** @brief Deepest nesting of states, counting the outermost as one */
+#define AO_MAX_DEPTH        8
+
+/** @brief Results of a state function */
+#define AO_RET_HANDLED      0U      /* event handled */
+#define AO_RET_IGNORED      1U      /* event ignored, not offered to superstates */
+#define AO_RET_SUPER        2U      /* event left to the superstate in temp */
+#define AO_RET_TRAN         3U      /* transition to the state in temp */
+
+/** @brief Return from a state function, handling the event */
+#define AO_HANDLED()        (AO_RET_HANDLED)
+
+/** @brief Return from a state function, taking a transition to a state */
+#define AO_TRAN(me, target) ((me)->temp = (ao_state_t)(target), AO_RET_TRAN)
+
+/** @brief Return from a state function, leaving the event to its superstate.
+ *      Each state returns this for the events it does not handle, outermost
+ *      states with @ref ao_top */
+#define AO_SUPER(me, parent) ((me)->temp = (ao_state_t)(parent), AO_RET_SUPER)
+
+/**
+ * @brief Initializer of an actor, for an actor embedded in a struct of its own
+ * @param initial       initial transition, a state function returning @ref
+ *      AO_TRAN to the first state when called with AO_SIG_INIT
+ * @param queue_buf     array of event pointers for the queue of the actor
+ */
+#define AO_ACTOR_INIT(initial, queue_buf)                                       \
+{                                                                               \
+    .temp = (ao_state_t)(initial),                                              \
+    .queue = (queue_buf),                                                       \
+    .size = sizeof(queue_buf) / sizeof((queue_buf)[0]),                         \
+}
+
+/**
+ * @brief Define an actor
+ * @param name          name of the actor
+ * @param initial       initial transition, see @ref AO_ACTOR_INIT
+ * @param queue_len     number of events the actor can have queued
+ */
+#define OS_ACTOR_DEFINE(name, initial, queue_len)                               \
+_Static_assert((queue_len) > 0, "actor " #name " needs room for an event");     \
+                                                                                \
+static const ao_event_t *__ao_##name##_queue[(queue_len)];                      \
+                                                                                \
+ao_actor_t name = AO_ACTOR_INIT(initial, __ao_##name##_queue)
+
+/**
+ * @brief Define a group of actors, run by a kernel task of its own:
+ *      OS_TASK_DEFINE(ao_group_task, &name, 0, 0, priority)
+ * @param name          name of the group
+ */
+#define OS_ACTOR_GROUP_DEFINE(name)                                             \
+ao_group_t name = { 0 }
+
+/**
+ * @brief Allocate an event from a pool
+ * @param type          event struct, with an @ref ao_event_t as its first member
+ * @param pool          pool of blocks at least the size of the struct
+ * @param sig           signal of the event
+ *
+ * @return event, or 0 if the pool is empty or its blocks too small
+ */
+#define AO_EVENT_NEW(type, pool, sig)                                           \
+    ((type *)ao_event_new((pool), sizeof(type), (sig)))
+
+/* =================== TYPE DEFINITIONS ======================= */
+
+/** @brief An event. Application events embed this as their first member */
+typedef struct Ao_Event {
+    /** @brief Signal, telling what happened */
+    uint32_t sig;
+
+    /** @brief Number of queues holding the event, if allocated from a pool */
+    volatile uint32_t refs;
+
+    /** @brief Pool the event was allocated from, 0 for static events */
+    pool_t *pool;
+} ao_event_t;
+
+struct Ao_Actor;
+struct Ao_Group;
+
+/** @brief A state; handles an event, returning one of AO_RET_* */
+typedef uint32_t (*ao_state_t)(struct Ao_Actor *me, const ao_event_t *e);
+
+/** @brief An actor. Define with @ref OS_ACTOR_DEFINE, or embed with @ref AO_ACTOR_INIT */
+typedef struct Ao_Actor {
+    /** @brief Current state, the innermost one, 0 until started */
+    ao_state_t state;
+
+    /** @brief Target of a transition, or superstate, returned by a state;
+     *      the initial transition until started */
+    ao_state_t temp;
+
+    /** @brief Queue of events to handle */
+    const ao_event_t **queue;
+
+    /** @brief Number of events the queue has room for */
+    uint32_t size;
+
+    /** @brief Number of events posted, ever. Written in critical sections */
+    volatile uint32_t head;
+
+    /** @brief Number of events handled, ever. Written in critical sections */
+    volatile uint32_t tail;
+
+    /** @brief Number of events not posted, as the queue was full */
+    volatile uint32_t lost;
+
+    /** @brief Signals subscribed to, a bit per signal */
+    volatile uint32_t subscriptions[AO_PUB_SIGNALS / 32];
+
+    /** @brief Group running the actor, 0 until started */
+    struct Ao_Group *group;
+
+    /** @brief Next ready actor of the group */
+    struct Ao_Actor *ready_next;
+
+    /** @brief Next started actor */
+    struct Ao_Actor *next;
+} ao_actor_t;
+
+/** @brief A group of actors run by one task. Define with @ref OS_ACTOR_GROUP_DEFINE */
+typedef struct Ao_Group {
+    /** @brief Actors with events queued, in the order they became ready */
+    ao_actor_t *ready_head;
+    ao_actor_t *ready_tail;
+
+    /** @brief Number of times an actor was added to the ready list, ever */
+    volatile uint32_t readied;
+
+    /** @brief Task of the group waiting for events */
+    os_event_t ready;
+} ao_group_t;
+
+/* =================== FUNCTION DECLARATIONS ================== */
+
+uint32_t ao_top(ao_actor_t *me, const ao_event_t *e);
+void ao_dispatch(ao_actor_t *me, const ao_event_t *e);
+int ao_is_in(ao_actor_t *me, ao_state_t state);
+
+int ao_start(ao_actor_t *me, ao_group_t *group);
+int ao_post(ao_actor_t *me, const ao_event_t *e);
+int ao_subscribe(ao_actor_t *me, uint32_t sig);
+int ao_unsubscribe(ao_actor_t *me, uint32_t sig);
+int ao_publish(const ao_event_t *e);
+
+ao_event_t *ao_event_new(pool_t *pool, uint32_t size, uint32_t sig);
+
+int ao_group_dispatch(ao_group_t *group);
+void ao_group_task(void *arg1, void *arg2, void *arg3);
+
+#endif /* __AO_H__ */
@@ -0,0 +1,225 @@
+/*
+ * @file atomic.h
+ * @brief Lock-free atomic operations on 32-bit words, for data shared
+ *      between tasks and interrupts without critical sections
+ *
+ * On the target the operations are exclusive load/store loops: LDREX reads the
+ * word and opens the exclusive monitor, and STREX only writes it if nothing
+ * cleared the monitor since. An exception entry or return clears it, so a loop
+ * interrupted by an ISR touching the word retries. Other builds use the
+ * compiler's atomic builtins.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+#ifndef __ATOMIC_H__
+#define __ATOMIC_H__
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+
+/* =================== MACRO DEFINITIONS ====================== */
+
+/** @brief Exclusive load/store instructions are available */
+#if defined(__ARM_ARCH) && defined(__thumb2__)
+#define ATOMIC_LDREX_STREX  1
+#else
+#define ATOMIC_LDREX_STREX  0
+#endif
+
+/* =================== FUNCTION DEFINITIONS =================== */
+
+/**
+ * @brief Read a word shared with other tasks or interrupts
+ * @param[in] ptr   word to read
+ *
+ * @return value of the word
+ */
+static inline uint32_t atomic_load(volatile uint32_t *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Compare and swap: set a word to a new value if it still holds the
+ *      expected one
+ * @param[in] ptr       word to update
+ * @param[in] expected  value the word must hold
+ * @param[in] desired   new value of the word
+ *
+ * @return 1 if the word was updated, 0 if it held another value
+ */
+static inline int atomic_cas(volatile uint32_t *ptr, uint32_t expected, uint32_t desired)
+{
+#if ATOMIC_LDREX_STREX
+    uint32_t old;
+    uint32_t fail;
+
+    __asm volatile(
+        "1: ldrex   %0, [%2]        \n"
+        "   cmp     %0, %3          \n"
+        "   bne     2f              \n"
+        "   strex   %1, %4, [%2]    \n"
+        "   cmp     %1, #0          \n"
+        "   bne     1b              \n"
+        "   b       3f              \n"
+        "2: clrex                   \n"
+        "3:                         \n"
+        : "=&r" (old), "=&r" (fail)
+        : "r" (ptr), "r" (expected), "r" (desired)
+        : "cc", "memory"
+    );
+    return old == expected;
+#else
+    return __atomic_compare_exchange_n(ptr, &expected, desired, 0,
+        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+#endif
+}
+
+/**
+ * @brief Add to a word
+ * @param[in] ptr   word to update
+ * @param[in] value value to add, wrapping around
+ *
+ * @return new value of the word
+ */
+static inline uint32_t atomic_add(volatile uint32_t *ptr, uint32_t value)
+{
+#if ATOMIC_LDREX_STREX
+    uint32_t result;
+    uint32_t fail;
+
+    __asm volatile(
+        "1: ldrex   %0, [%2]        \n"
+        "   add     %0, %0, %3      \n"
+        "   strex   %1, %0, [%2]    \n"
+        "   cmp     %1, #0          \n"
+        "   bne     1b              \n"
+        : "=&r" (result), "=&r" (fail)
+        : "r" (ptr), "r" (value)
+        : "cc", "memory"
+    );
+    return result;
+#else
+    return __atomic_add_fetch(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * @brief Subtract from a word
+ * @param[in] ptr   word to update
+ * @param[in] value value to subtract, wrapping around
+ *
+ * @return new value of the word
+ */
+static inline uint32_t atomic_sub(volatile uint32_t *ptr, uint32_t value)
+{
+    return atomic_add(ptr, (uint32_t)0 - value);
+}
+
+/**
+ * @brief Set bits of a word
+ * @param[in] ptr   word to update
+ * @param[in] bits  bits to set
+ *
+ * @return value of the word before the update
+ */
+static inline uint32_t atomic_or(volatile uint32_t *ptr, uint32_t bits)
+{
+#if ATOMIC_LDREX_STREX
+    uint32_t old;
+    uint32_t result;
+    uint32_t fail;
+
+    __asm volatile(
+        "1: ldrex   %0, [%3]        \n"
+        "   orr     %1, %0, %4      \n"
+        "   strex   %2, %1, [%3]    \n"
+        "   cmp     %2, #0          \n"
+        "   bne     1b              \n"
+        : "=&r" (old), "=&r" (result), "=&r" (fail)
+        : "r" (ptr), "r" (bits)
+        : "cc", "memory"
+    );
+    return old;
+#else
+    return __atomic_fetch_or(ptr, bits, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * @brief Clear bits of a word
+ * @param[in] ptr   word to update
+ * @param[in] bits  bits to clear
+ *
+ * @return value of the word before the update
+ */
+static inline uint32_t atomic_clear(volatile uint32_t *ptr, uint32_t bits)
+{
+#if ATOMIC_LDREX_STREX
+    uint32_t old;
+    uint32_t result;
+    uint32_t fail;
+
+    __asm volatile(
+        "1: ldrex   %0, [%3]        \n"
+        "   bic     %1, %0, %4      \n"
+        "   strex   %2, %1, [%3]    \n"
+        "   cmp     %2, #0          \n"
+        "   bne     1b              \n"
+        : "=&r" (old), "=&r" (result), "=&r" (fail)
+        : "r" (ptr), "r" (bits)
+        : "cc", "memory"
+    );
+    return old;
+#else
+    return __atomic_fetch_and(ptr, ~bits, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * @brief Replace a word, e.g. to take all bits of a bit mask at once
+ * @param[in] ptr   word to update
+ * @param[in] value new value of the word
+ *
+ * @return value of the word before the update
+ */
+static inline uint32_t atomic_xchg(volatile uint32_t *ptr, uint32_t value)
+{
+#if ATOMIC_LDREX_STREX
+    uint32_t old;
+    uint32_t fail;
+
+    __asm volatile(
+        "1: ldrex   %0, [%2]        \n"
+        "   strex   %1, %3, [%2]    \n"
+        "   cmp     %1, #0          \n"
+        "   bne     1b              \n"
+        : "=&r" (old), "=&r" (fail)
+        : "r" (ptr), "r" (value)
+        : "cc", "memory"
+    );
+    return old;
+#else
+    return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * @brief Raise a word to at least a value, for high-water marks
+ * @param[in] ptr   word to update
+ * @param[in] value value the word must reach
+ */
+static inline void atomic_max(volatile uint32_t *ptr, uint32_t value)
+{
+    uint32_t old;
+
+    do {
+        old = atomic_load(ptr);
+        if(old >= value) {
+            return;
+        }
+    } while(!atomic_cas(ptr, old, value));
+}
+
+#endif /* __ATOMIC_H__ */
@@ -0,0 +1,266 @@
+/*
+ * @file coro.c
+ * @brief Implementation of the stackless coroutines
+ *
+ * A scheduler keeps its coroutines in a list. Coroutines may be spawned from
+ * any task, so they are added to the head of the list in a critical section.
+ * Only the scheduler task removes them, and only it writes the links past
+ * the head, so it walks the list without one.
+ *
+ * Semaphores, and bytes received by the UART, wake all scheduler tasks
+ * waiting, which poll their coroutines again. A wakeup during a pass, or as
+ * the task starts waiting, is noticed by the count of wakeups changing, so
+ * that the task makes another pass instead of waiting.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include "system.h"
+#include "os.h"
+#include "atomic/atomic.h"
+#include "coro.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Longest wait of a scheduler task between passes while a coroutine
+ *      waits in CO_AWAIT. Conditions with nothing signalling them, e.g. UART
+ *      reception without a receive callback, are polled this often */
+#define CO_POLL_MS              10
+
+/** @brief States of the UART receive callback, see @ref co_uart_read */
+#define CO_UART_UNSET           0U
+#define CO_UART_NOTIFIED        1U
+#define CO_UART_POLLED          2U
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief Scheduler tasks waiting for a semaphore to be given, or a byte received */
+static os_event_t co_wakeup;
+
+/** @brief Number of times a semaphore has been given, or a byte received, ever */
+static volatile uint32_t co_wakes;
+
+/** @brief Whether the UART wakes the schedulers, one of CO_UART_* */
+static volatile uint32_t co_uart;
+
+/* ========================= FUNCTION DEFINITIONS ============== */
+
+/**
+ * @brief Spawn a coroutine, to be run by a scheduler from its next pass. May
+ *      be called from any task, and from coroutines of any scheduler
+ * @param[in] sched     scheduler
+ * @param[in] co        coroutine, not spawned already
+ * @param[in] fn        body of the coroutine, started from the beginning
+ *
+ * @return OS_OK, or OS_ERROR if the coroutine is spawned already
+ */
+int co_spawn(co_sched_t *sched, co_t *co, co_fn_t fn)
+{
+    uint32_t state;
+
+    if(co->spawned) {
+        return OS_ERROR;
+    }
+
+    co->fn = fn;
+    co->line = 0;
+    co->sleeping = 0;
+    co->polling = 0;
+    co->spawned = 1;
+
+    state = CriticalEnter();
+    co->next = sched->head;
+    sched->head = co;
+    CriticalExit(state);
+
+    event_signal(&co_wakeup);
+
+    return OS_OK;
+}
+
+/**
+ * @brief Remove an ended coroutine from its scheduler
+ * @param[in] sched     scheduler
+ * @param[in] prev      coroutine before it when the pass started, 0 if none
+ * @param[in] co        coroutine
+ */
+static void co_unlink(co_sched_t *sched, co_t *prev, co_t *co)
+{
+    co_t **link;
+    uint32_t state;
+
+    /* Coroutines spawned meanwhile are in front of the head seen before */
+    state = CriticalEnter();
+    for(link = prev ? &prev->next : &sched->head; *link != co; link = &(*link)->next) {;}
+    *link = co->next;
+    CriticalExit(state);
+
+    co->spawned = 0;
+}
+
+/**
+ * @brief Resume each coroutine of a scheduler once, removing those that end,
+ *      and note the earliest sleeping one to wake up, and whether any polls.
+ *      Called by the scheduler task only, or by the application in place of one
+ * @param[in] sched     scheduler
+ *
+ * @return number of coroutines that yielded, ready to run again right away
+ */
+uint32_t co_sched_run(co_sched_t *sched)
+{
+    co_t *co;
+    co_t *prev = 0;
+    co_t *next;
+    uint32_t ready = 0;
+    uint32_t result;
+
+    sched->sleeping = 0;
+    sched->polling = 0;
+
+    for(co = sched->head; co; co = next) {
+        next = co->next;
+        co->polling = 0;
+        result = co->fn(co);
+        sched->resumes++;
+
+        if(result == CO_ENDED) {
+            co_unlink(sched, prev, co);
+            continue;
+        }
+
+        if(result == CO_YIELDED) {
+            ready++;
+        } else if(co->polling) {
+            sched->polling = 1;
+        } else if(co->sleeping && (!sched->sleeping || (int32_t)(co->wake - sched->wake) < 0)) {
+            sched->wake = co->wake;
+            sched->sleeping = 1;
+        }
+        prev = co;
+    }
+
+    return ready;
+}
+
+/**
+ * @brief Task running a scheduler of coroutines, making passes while they
+ *      are ready to run, and sleeping while they all wait.
+ *      Register with OS_TASK_DEFINE(co_sched_task, &sched, 0, 0, prio)
+ * @param[in] arg1  scheduler
+ * @param[in] arg2  unused
+ * @param[in] arg3  unused
+ */
+void co_sched_task(void *arg1, void *arg2, void *arg3)
+{
+    co_sched_t *sched = (co_sched_t *)arg1;
+    uint32_t wakes;
+    int32_t ms;
+
+    (void)arg2;
+    (void)arg3;
+
+    while(1) {
+        wakes = atomic_load(&co_wakes);
+        if(co_sched_run(sched) || wakes != atomic_load(&co_wakes)) {
+            continue;
+        }
+
+        ms = sched->polling ? CO_POLL_MS : OS_WAIT_FOREVER;
+        if(sched->sleeping) {
+            ms = (int32_t)(sched->wake - (uint32_t)TICK_get());
+            if(ms <= 0) {
+                continue;
+            }
+            if(sched->polling && ms > CO_POLL_MS) {
+                ms = CO_POLL_MS;
+            }
+        }
+
+        /* A wakeup after the count was read is not missed while starting to wait */
+        (void)event_wait_seq(&co_wakeup, &co_wakes, wakes, ms);
+    }
+}
+
+/**
+ * @brief Check whether the sleep of a coroutine is over, see @ref CO_SLEEP
+ * @param[in] co    coroutine
+ *
+ * @return 1 if over, 0 if still sleeping
+ */
+int co_timer_expired(co_t *co)
+{
+    co->sleeping = (int32_t)((uint32_t)TICK_get() - co->wake) < 0;
+
+    return !co->sleeping;
+}
+
+/**
+ * @brief Take a semaphore if available, without waiting, see @ref CO_SEM_TAKE.
+ *      May be called from any context
+ * @param[in] sem   semaphore
+ *
+ * @return 1 if taken, 0 if not available
+ */
+int co_sem_try(co_sem_t *sem)
+{
+    uint32_t count;
+
+    do {
+        count = atomic_load(&sem->count);
+        if(!count) {
+            return 0;
+        }
+    } while(!atomic_cas(&sem->count, count, count - 1));
+
+    return 1;
+}
+
+/**
+ * @brief Give a semaphore, waking coroutines waiting to take it. May be
+ *      called from tasks, interrupts, and coroutines
+ * @param[in] sem   semaphore
+ */
+void co_sem_give(co_sem_t *sem)
+{
+    (void)atomic_add(&sem->count, 1);
+    (void)atomic_add(&co_wakes, 1);
+    event_signal(&co_wakeup);
+}
+
+/**
+ * @brief Receive callback of the UART, waking the scheduler tasks. Called from
+ *      the receive interrupt
+ */
+static void co_uart_rx(void)
+{
+    (void)atomic_add(&co_wakes, 1);
+    event_signal(&co_wakeup);
+}
+
+/**
+ * @brief Read received bytes from UART without waiting, see @ref CO_UART_READ.
+ *      The first call sets the receive callback of the driver, waking the
+ *      scheduler tasks as a byte is received. Without one, the coroutine polls
+ * @param[in] co    coroutine
+ * @param[out] buf  buffer to read to
+ * @param[in] len   size of the buffer
+ *
+ * @return number of bytes read, 0 if none, -1 on error
+ */
+int co_uart_read(co_t *co, char *buf, uint32_t len)
+{
+    int result;
+
+    if(co_uart == CO_UART_UNSET) {
+        co_uart = (UART_rx_notify(&co_uart_rx) == UART_OK) ? CO_UART_NOTIFIED : CO_UART_POLLED;
+    }
+
+    result = UART_read(buf, len, 0);
+    if(!result && co_uart == CO_UART_POLLED) {
+        co->polling = 1;
+    }
+
+    return result;
+}
@@ -0,0 +1,209 @@
+/*
+ * @file coro.h
+ * @brief Stackless coroutines: many lightweight concurrent activities sharing
+ *      one kernel task
+ *
+ * A coroutine is a function that returns wherever it waits, and resumes from
+ * there the next time it is called. Its body is wrapped in @ref CO_BEGIN and
+ * @ref CO_END, and it waits with @ref CO_AWAIT and the awaitables built on
+ * it: @ref CO_SLEEP on the system tick, @ref CO_SEM_TAKE on a semaphore, and
+ * @ref CO_UART_READ on the UART receive buffer. The resume point is a line
+ * number, so a coroutine must keep all state living across waits in its
+ * @ref co_t, or in a struct embedding it, never in local variables. The
+ * body must not use switch statements that wait inside their cases.
+ *
+ * Coroutines are run by a scheduler, each scheduler by one kernel task, @ref
+ * co_sched_task. The task resumes its coroutines in turn; when all of them
+ * are waiting it sleeps until the earliest sleeping coroutine is due, a
+ * semaphore is given, or the UART receives a byte. Conditions of @ref
+ * CO_AWAIT, which nothing signals, are polled every CO_POLL_MS while a
+ * coroutine waits for one, as is the UART of a driver without a receive
+ * callback, see @ref UART_rx_notify. Coroutines
+ * share the priority of their task, and must never block.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+#ifndef __CORO_H__
+#define __CORO_H__
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include "system.h"
+#include "uart.h"
+#include "os.h"
+
+/* =================== MACRO DEFINITIONS ====================== */
+
+/** @brief Results of a coroutine */
+#define CO_WAITING          0U      /* waiting, resumed again on the next pass */
+#define CO_YIELDED          1U      /* gave way, ready to run on the next pass */
+#define CO_ENDED            2U      /* returned from its body, removed from its scheduler */
+
+/** @brief Start the body of a coroutine, resuming where it left off */
+#define CO_BEGIN(co)                                                            \
+    switch((co)->line) {                                                        \
+    case 0:
+
+/** @brief End the body of a coroutine. A coroutine ending here is restarted
+ *      from the beginning if spawned again */
+#define CO_END(co)                                                              \
+    }                                                                           \
+    (co)->line = 0;                                                             \
+    return CO_ENDED
+
+/** @brief Mark a resume point of a coroutine */
+#define CO_RESUME_POINT(co)                                                     \
+    (co)->line = __LINE__;                                                      \
+    case __LINE__:
+
+/** @brief Give way to the other coroutines of the scheduler */
+#define CO_YIELD(co)                                                            \
+do {                                                                            \
+    (co)->line = __LINE__;                                                      \
+    return CO_YIELDED;                                                          \
+    case __LINE__:;                                                             \
+} while(0)
+
+/** @brief Wait until a condition holds, which only changes as the scheduler
+ *      is woken, by a semaphore give, a byte received, or a timer */
+#define CO_AWAIT_WOKEN(co, cond)                                                \
+do {                                                                            \
+    CO_RESUME_POINT(co)                                                         \
+    if(!(cond)) {                                                               \
+        return CO_WAITING;                                                      \
+    }                                                                           \
+} while(0)
+
+/** @brief Wait until a condition holds. The condition is evaluated on every
+ *      pass of the scheduler, and should be cheap. Nothing signals it, so it
+ *      is polled every CO_POLL_MS while waited for */
+#define CO_AWAIT(co, cond)                                                      \
+do {                                                                            \
+    CO_RESUME_POINT(co)                                                         \
+    if(!(cond)) {                                                               \
+        (co)->polling = 1;                                                      \
+        return CO_WAITING;                                                      \
+    }                                                                           \
+} while(0)
+
+/** @brief End the coroutine right away */
+#define CO_EXIT(co)                                                             \
+do {                                                                            \
+    (co)->line = 0;                                                             \
+    return CO_ENDED;                                                            \
+} while(0)
+
+/** @brief Sleep for a number of milliseconds, on the system tick */
+#define CO_SLEEP(co, ms)                                                        \
+do {                                                                            \
+    (co)->wake = (uint32_t)TICK_get() + (uint32_t)(ms);                         \
+    CO_AWAIT_WOKEN(co, co_timer_expired(co));                                   \
+} while(0)
+
+/** @brief Take a semaphore, waiting until it is given if it is not available */
+#define CO_SEM_TAKE(co, sem)                                                    \
+    CO_AWAIT_WOKEN(co, co_sem_try(sem))
+
+/**
+ * @brief Read received bytes from UART, waiting until at least one byte has
+ *      been received. The scheduler is woken by the driver's receive
+ *      callback, or polls if the driver has none
+ * @param co        coroutine
+ * @param buf       buffer to read to, must outlive the wait
+ * @param len       size of the buffer
+ * @param result    int lvalue outliving the wait, set to the number of bytes
+ *      read, or -1 on error
+ */
+#define CO_UART_READ(co, buf, len, result)                                      \
+    CO_AWAIT_WOKEN(co, ((result) = co_uart_read((co), (buf), (len))) != 0)
+
+/**
+ * @brief Define a coroutine scheduler, run by a kernel task of its own:
+ *      OS_TASK_DEFINE(co_sched_task, &name, 0, 0, priority)
+ * @param name          name of the scheduler
+ */
+#define OS_CO_SCHED_DEFINE(name)                                                \
+co_sched_t name = { 0 }
+
+/**
+ * @brief Define a semaphore
+ * @param name          name of the semaphore
+ * @param initial       number of times it can be taken before given
+ */
+#define OS_CO_SEM_DEFINE(name, initial)                                         \
+co_sem_t name = { .count = (initial) }
+
+/* =================== TYPE DEFINITIONS ======================= */
+
+struct Co;
+struct Co_Sched;
+
+/** @brief Body of a coroutine; resumes it, returning one of CO_* */
+typedef uint32_t (*co_fn_t)(struct Co *co);
+
+/** @brief A coroutine. Applications with more state embed this as the first
+ *      member of a struct of their own */
+typedef struct Co {
+    /** @brief Body */
+    co_fn_t fn;
+
+    /** @brief Next coroutine of the scheduler */
+    struct Co *next;
+
+    /** @brief Tick to wake up at from @ref CO_SLEEP, lower 32 bits */
+    uint32_t wake;
+
+    /** @brief Resume point, the line it left off at, 0 to start from the beginning */
+    uint16_t line;
+
+    /** @brief Set while run by a scheduler */
+    uint8_t spawned;
+
+    /** @brief Set while waiting in @ref CO_SLEEP */
+    uint8_t sleeping;
+
+    /** @brief Set while waiting in @ref CO_AWAIT, or in @ref CO_UART_READ
+     *      with a driver that has no receive callback */
+    uint8_t polling;
+} co_t;
+
+/** @brief A scheduler of coroutines run by one task. Define with @ref OS_CO_SCHED_DEFINE */
+typedef struct Co_Sched {
+    /** @brief Coroutines, the latest spawned first */
+    co_t *head;
+
+    /** @brief Earliest tick a coroutine sleeping after the latest pass wakes
+     *      up at, lower 32 bits, valid if sleeping is set */
+    uint32_t wake;
+
+    /** @brief Set if a coroutine was sleeping after the latest pass */
+    uint32_t sleeping;
+
+    /** @brief Set if a coroutine was waiting in @ref CO_AWAIT after the latest pass */
+    uint32_t polling;
+
+    /** @brief Number of times a coroutine has been resumed, ever */
+    uint32_t resumes;
+} co_sched_t;
+
+/** @brief A counting semaphore. Define with @ref OS_CO_SEM_DEFINE */
+typedef struct Co_Sem {
+    /** @brief Number of times it can be taken before given */
+    volatile uint32_t count;
+} co_sem_t;
+
+/* =================== FUNCTION DECLARATIONS ================== */
+
+int co_spawn(co_sched_t *sched, co_t *co, co_fn_t fn);
+uint32_t co_sched_run(co_sched_t *sched);
+void co_sched_task(void *arg1, void *arg2, void *arg3);
+
+int co_timer_expired(co_t *co);
+
+int co_sem_try(co_sem_t *sem);
+void co_sem_give(co_sem_t *sem);
+
+int co_uart_read(co_t *co, char *buf, uint32_t len);
+
+#endif /* __CORO_H__ */
@@ -0,0 +1,445 @@
+/*
+ * @file heap.c
+ * @brief Implementation of the two-level segregated fit (TLSF) heap
+ *
+ * Each block has a header with a pointer to the previous block in memory and
+ * the size of its data, and the blocks of a heap follow each other in memory,
+ * up to a zero sized sentinel block at the end that is never free. A free
+ * block keeps its free list pointers in its data. Two free blocks are never
+ * next to each other, they are merged on free.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include <stddef.h>
+#include "os.h"
+#include "heap.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Flags in the low bits of block sizes */
+#define HEAP_BLOCK_FREE         0x1U
+#define HEAP_BLOCK_PREV_FREE    0x2U
+#define HEAP_BLOCK_FLAGS        (HEAP_BLOCK_FREE | HEAP_BLOCK_PREV_FREE)
+
+/** @brief Size of the header of an allocated block */
+#define HEAP_BLOCK_OVERHEAD     ((uint32_t)offsetof(heap_block_t, next_free))
+
+/** @brief Smallest data size of a block, a free block must fit its free list pointers */
+#define HEAP_BLOCK_MIN          ((uint32_t)(sizeof(heap_block_t) - HEAP_BLOCK_OVERHEAD))
+
+/** @brief Sizes below this are all in first level 0, split linearly */
+#define HEAP_SMALL_BLOCK        (1U << HEAP_FL_INDEX_SHIFT)
+
+/** @brief Largest allocation */
+#define HEAP_ALLOC_MAX          ((1U << HEAP_FL_INDEX_MAX) - (1U << (HEAP_FL_INDEX_MAX - HEAP_SL_COUNT_LOG2)))
+
+#if HEAP_FL_INDEX_MAX > 31 || HEAP_FL_INDEX_MAX <= HEAP_FL_INDEX_SHIFT
+#error "HEAP_FL_INDEX_MAX out of range"
+#endif
+
+_Static_assert((HEAP_BLOCK_OVERHEAD % HEAP_ALIGN) == 0 && (HEAP_BLOCK_MIN % HEAP_ALIGN) == 0,
+    "heap block header must keep the data aligned");
+
+/* ========================= FUNCTION DECLARATIONS ============= */
+/* ========================= EXTERN DEFINITIONS ================ */
+
+/** @brief Extern linkage to the heap region of the linker script. Weak, as
+ *      builds without the linker script may not have a heap */
+extern uint8_t __HeapStart[] __attribute__((weak));
+extern uint8_t __HeapLimit[] __attribute__((weak));
+
+/* ========================= STATIC DATA ======================= */
+
+/** @brief The system heap, initialized on first use */
+static heap_t mem_heap;
+
+/* ========================= FUNCTION DEFINITIONS ============== */
+
+/** @brief Index of the highest set bit, value must not be 0 */
+static inline uint32_t heap_fls(uint32_t value)
+{
+    return 31U - (uint32_t)__builtin_clz(value);
+}
+
+/** @brief Index of the lowest set bit, value must not be 0 */
+static inline uint32_t heap_ffs(uint32_t value)
+{
+    return (uint32_t)__builtin_ctz(value);
+}
+
+/** @brief Size of a block's data */
+static inline uint32_t block_size(const heap_block_t *block)
+{
+    return block->size & ~HEAP_BLOCK_FLAGS;
+}
+
+/** @brief Set the size of a block's data, keeping the flags */
+static inline void block_set_size(heap_block_t *block, uint32_t size)
+{
+    block->size = size | (block->size & HEAP_BLOCK_FLAGS);
+}
+
+/** @brief Data of a block */
+static inline void *block_to_ptr(heap_block_t *block)
+{
+    return (uint8_t *)block + HEAP_BLOCK_OVERHEAD;
+}
+
+/** @brief Block of allocated data */
+static inline heap_block_t *block_from_ptr(void *ptr)
+{
+    return (heap_block_t *)((uint8_t *)ptr - HEAP_BLOCK_OVERHEAD);
+}
+
+/** @brief Next block in memory */
+static inline heap_block_t *block_next(heap_block_t *block)
+{
+    return (heap_block_t *)((uint8_t *)block_to_ptr(block) + block_size(block));
+}
+
+/**
+ * @brief Find the lists of a block size
+ * @param[in] size  block size
+ * @param[out] fl   first level index
+ * @param[out] sl   second level index
+ */
+static void mapping_insert(uint32_t size, uint32_t *fl, uint32_t *sl)
+{
+    uint32_t top;
+
+    if(size < HEAP_SMALL_BLOCK) {
+        *fl = 0;
+        *sl = size / (HEAP_SMALL_BLOCK / HEAP_SL_COUNT);
+    } else {
+        top = heap_fls(size);
+        *sl = (size >> (top - HEAP_SL_COUNT_LOG2)) ^ HEAP_SL_COUNT;
+        *fl = top - (HEAP_FL_INDEX_SHIFT - 1);
+    }
+}
+
+/**
+ * @brief Find the first lists where every block fits a size; the size is
+ *      rounded up to the next list, so that any block of the list will do
+ * @param[in] size  requested size
+ * @param[out] fl   first level index
+ * @param[out] sl   second level index
+ */
+static void mapping_search(uint32_t size, uint32_t *fl, uint32_t *sl)
+{
+    if(size >= HEAP_SMALL_BLOCK) {
+        size += (1U << (heap_fls(size) - HEAP_SL_COUNT_LOG2)) - 1;
+    }
+    mapping_insert(size, fl, sl);
+}
+
+/**
+ * @brief Remove a free block from its list
+ * @param[in] heap  heap of the block
+ * @param[in] block free block
+ */
+static void remove_free_block(heap_t *heap, heap_block_t *block)
+{
+    uint32_t fl, sl;
+
+    mapping_insert(block_size(block), &fl, &sl);
+
+    if(block->prev_free) {
+        block->prev_free->next_free = block->next_free;
+    } else {
+        heap->blocks[fl][sl] = block->next_free;
+        if(!block->next_free) {
+            heap->sl_bitmap[fl] &= ~(1U << sl);
+            if(!heap->sl_bitmap[fl]) {
+                heap->fl_bitmap &= ~(1U << fl);
+            }
+        }
+    }
+    if(block->next_free) {
+        block->next_free->prev_free = block->prev_free;
+    }
+}
+
+/**
+ * @brief Insert a free block at the head of its list
+ * @param[in] heap  heap of the block
+ * @param[in] block free block
+ */
+static void insert_free_block(heap_t *heap, heap_block_t *block)
+{
+    uint32_t fl, sl;
+
+    mapping_insert(block_size(block), &fl, &sl);
+
+    block->prev_free = 0;
+    if(heap->sl_bitmap[fl] & (1U << sl)) {
+        block->next_free = heap->blocks[fl][sl];
+        block->next_free->prev_free = block;
+    } else {
+        block->next_free = 0;
+    }
+    heap->blocks[fl][sl] = block;
+    heap->sl_bitmap[fl] |= 1U << sl;
+    heap->fl_bitmap |= 1U << fl;
+}
+
+/**
+ * @brief Initialize a heap over a region of memory. The heap's bookkeeping is
+ *      kept in the heap structure, and block headers in the region
+ * @param[out] heap heap to initialize
+ * @param[in] mem   start of the region, aligned up to @ref HEAP_ALIGN
+ * @param[in] size  size of the region in bytes
+ *
+ * @return OS_OK on success, OS_ERROR if the region is too small or too large
+ */
+int heap_init(heap_t *heap, void *mem, uint32_t size)
+{
+    uintptr_t start, end;
+    heap_block_t *block, *sentinel;
+    uint32_t i;
+
+    heap->fl_bitmap = 0;
+    for(i = 0; i < HEAP_FL_COUNT; i++) {
+        heap->sl_bitmap[i] = 0;
+    }
+    heap->size = 0;
+    heap->free_bytes = 0;
+    heap->free_min = 0;
+    heap->allocated = 0;
+
+    if(!mem) {
+        return OS_ERROR;
+    }
+
+    start = ((uintptr_t)mem + HEAP_ALIGN - 1) & ~(uintptr_t)(HEAP_ALIGN - 1);
+    end = ((uintptr_t)mem + size) & ~(uintptr_t)(HEAP_ALIGN - 1);
+    if(end <= start || end - start < 2 * HEAP_BLOCK_OVERHEAD + HEAP_BLOCK_MIN
+        || end - start - 2 * HEAP_BLOCK_OVERHEAD > HEAP_ALLOC_MAX) {
+        return OS_ERROR;
+    }
+
+    /* One free block over the region, and the sentinel after it */
+    block = (heap_block_t *)start;
+    block->prev_phys = 0;
+    block->size = (uint32_t)(end - start - 2 * HEAP_BLOCK_OVERHEAD) | HEAP_BLOCK_FREE;
+
+    sentinel = block_next(block);
+    sentinel->prev_phys = block;
+    sentinel->size = HEAP_BLOCK_PREV_FREE;
+
+    insert_free_block(heap, block);
+    heap->size = block_size(block);
+    heap->free_bytes = heap->size;
+    heap->free_min = heap->size;
+
+    return OS_OK;
+}
+
+/**
+ * @brief Allocate memory from a heap, in a bounded number of steps. Not
+ *      thread-safe; use @ref mem_alloc for the system heap
+ * @param[in] heap  heap to allocate from
+ * @param[in] size  size in bytes
+ *
+ * @return the allocation, aligned to @ref HEAP_ALIGN, or 0 if no free block is large enough
+ */
+void *heap_alloc(heap_t *heap, uint32_t size)
+{
+    heap_block_t *block, *rest;
+    uint32_t fl, sl, map, total;
+
+    if(!size || size > HEAP_ALLOC_MAX) {
+        return 0;
+    }
+    size = (size + HEAP_ALIGN - 1) & ~(HEAP_ALIGN - 1);
+    if(size < HEAP_BLOCK_MIN) {
+        size = HEAP_BLOCK_MIN;
+    }
+
+    /* Find a non-empty list at or above the rounded size; first in the same
+        first level, then in the next non-empty first level */
+    mapping_search(size, &fl, &sl);
+    if(fl >= HEAP_FL_COUNT) {
+        return 0;
+    }
+    map = heap->sl_bitmap[fl] & (~0U << sl);
+    if(!map) {
+        map = (fl + 1 < HEAP_FL_COUNT) ? heap->fl_bitmap & (~0U << (fl + 1)) : 0;
+        if(!map) {
+            return 0;
+        }
+        fl = heap_ffs(map);
+        map = heap->sl_bitmap[fl];
+    }
+    sl = heap_ffs(map);
+
+    block = heap->blocks[fl][sl];
+    remove_free_block(heap, block);
+    total = block_size(block);
+
+    /* Split the remainder off as a free block, if it fits a block */
+    if(total >= size + HEAP_BLOCK_OVERHEAD + HEAP_BLOCK_MIN) {
+        block_set_size(block, size);
+        rest = block_next(block);
+        rest->prev_phys = block;
+        rest->size = (total - size - HEAP_BLOCK_OVERHEAD) | HEAP_BLOCK_FREE;
+        block_next(rest)->prev_phys = rest;
+        insert_free_block(heap, rest);
+        heap->free_bytes -= size + HEAP_BLOCK_OVERHEAD;
+    } else {
+        heap->free_bytes -= total;
+        block_next(block)->size &= ~HEAP_BLOCK_PREV_FREE;
+    }
+    block->size &= ~HEAP_BLOCK_FREE;
+
+    heap->allocated++;
+    if(heap->free_bytes < heap->free_min) {
+        heap->free_min = heap->free_bytes;
+    }
+
+    return block_to_ptr(block);
+}
+
+/**
+ * @brief Free memory allocated from a heap, in a bounded number of steps.
+ *      The block is merged with free blocks next to it. Not thread-safe;
+ *      use @ref mem_free for the system heap
+ * @param[in] heap  heap the memory was allocated from
+ * @param[in] ptr   allocation, may be 0
+ */
+void heap_free(heap_t *heap, void *ptr)
+{
+    heap_block_t *block, *prev, *next;
+
+    if(!ptr) {
+        return;
+    }
+    block = block_from_ptr(ptr);
+    if(block->size & HEAP_BLOCK_FREE) {
+        /* Freed twice */
+        return;
+    }
+
+    heap->allocated--;
+    heap->free_bytes += block_size(block);
+    block->size |= HEAP_BLOCK_FREE;
+
+    /* Merge with the previous block */
+    if(block->size & HEAP_BLOCK_PREV_FREE) {
+        prev = block->prev_phys;
+        remove_free_block(heap, prev);
+        block_set_size(prev, block_size(prev) + HEAP_BLOCK_OVERHEAD + block_size(block));
+        block = prev;
+        heap->free_bytes += HEAP_BLOCK_OVERHEAD;
+    }
+
+    /* Merge with the next block */
+    next = block_next(block);
+    if(next->size & HEAP_BLOCK_FREE) {
+        remove_free_block(heap, next);
+        block_set_size(block, block_size(block) + HEAP_BLOCK_OVERHEAD + block_size(next));
+        heap->free_bytes += HEAP_BLOCK_OVERHEAD;
+        next = block_next(block);
+    }
+
+    next->prev_phys = block;
+    next->size |= HEAP_BLOCK_PREV_FREE;
+    insert_free_block(heap, block);
+}
+
+/**
+ * @brief Get the statistics of a heap. Finding the largest free block takes
+ *      time in proportion to the free blocks in the largest size class, so
+ *      this is meant for diagnostics. Not thread-safe; use @ref mem_get_stats
+ *      for the system heap
+ * @param[in] heap      heap to get the statistics of
+ * @param[out] stats    statistics
+ */
+void heap_get_stats(heap_t *heap, heap_stats_t *stats)
+{
+    heap_block_t *block;
+    uint32_t fl;
+
+    stats->size = heap->size;
+    stats->free_bytes = heap->free_bytes;
+    stats->free_min = heap->free_min;
+    stats->allocated = heap->allocated;
+    stats->largest_free = 0;
+    stats->fragmentation = 0;
+
+    if(!heap->fl_bitmap) {
+        return;
+    }
+
+    fl = heap_fls(heap->fl_bitmap);
+    for(block = heap->blocks[fl][heap_fls(heap->sl_bitmap[fl])]; block; block = block->next_free) {
+        if(block_size(block) > stats->largest_free) {
+            stats->largest_free = block_size(block);
+        }
+    }
+
+    if(stats->free_bytes) {
+        stats->fragmentation = (stats->free_bytes - stats->largest_free) * 100U / stats->free_bytes;
+    }
+}
+
+/**
+ * @brief Initialize the system heap over the linker script's heap region, if
+ *      not done yet. Called in a critical section
+ */
+static void mem_init_locked(void)
+{
+    if(!mem_heap.size) {
+        (void)heap_init(&mem_heap, __HeapStart, (uint32_t)(__HeapLimit - __HeapStart));
+    }
+}
+
+/**
+ * @brief Allocate memory from the system heap, in a bounded number of steps.
+ *      May be called from tasks and interrupts calling the kernel
+ * @param[in] size  size in bytes
+ *
+ * @return the allocation, aligned to @ref HEAP_ALIGN, or 0 if out of memory
+ */
+void *mem_alloc(uint32_t size)
+{
+    uint32_t state;
+    void *ptr;
+
+    state = critical_enter();
+    mem_init_locked();
+    ptr = heap_alloc(&mem_heap, size);
+    critical_exit(state);
+
+    return ptr;
+}
+
+/**
+ * @brief Free memory allocated from the system heap, in a bounded number of
+ *      steps. May be called from tasks and interrupts calling the kernel
+ * @param[in] ptr   allocation, may be 0
+ */
+void mem_free(void *ptr)
+{
+    uint32_t state;
+
+    state = critical_enter();
+    heap_free(&mem_heap, ptr);
+    critical_exit(state);
+}
+
+/**
+ * @brief Get the statistics of the system heap, see @ref heap_get_stats
+ * @param[out] stats    statistics
+ */
+void mem_get_stats(heap_stats_t *stats)
+{
+    uint32_t state;
+
+    state = critical_enter();
+    mem_init_locked();
+    heap_get_stats(&mem_heap, stats);
+    critical_exit(state);
+}
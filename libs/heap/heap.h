@@ -0,0 +1,120 @@
+/*
+ * @file heap.h
+ * @brief Two-level segregated fit (TLSF) heap. Allocation and free take a
+ *      bounded number of steps, independent of the number of blocks
+ *
+ * Free blocks are kept in lists by size. The first level splits sizes by
+ * powers of two, and the second level splits each of those linearly into
+ * @ref HEAP_SL_COUNT lists. A bitmap of non-empty lists on both levels lets
+ * allocation find a large enough free block with two bit scans, and free
+ * merges a block with its free neighbours in memory before listing it.
+ *
+ * The system heap, @ref mem_alloc and @ref mem_free, is laid over the .heap
+ * section of the linker script, sized by __HEAP_SIZE, and safe to use from
+ * tasks and interrupts calling the kernel. Other heaps over any memory can
+ * be created with @ref heap_init, and are not thread-safe.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+#ifndef __HEAP_H__
+#define __HEAP_H__
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+
+/* =================== MACRO DEFINITIONS ====================== */
+
+/** @brief Alignment of allocations, and granularity of block sizes */
+#define HEAP_ALIGN_LOG2     3
+#define HEAP_ALIGN          (1U << HEAP_ALIGN_LOG2)
+
+/** @brief Number of second level lists per first level, as a power of 2 */
+#define HEAP_SL_COUNT_LOG2  3
+#define HEAP_SL_COUNT       (1U << HEAP_SL_COUNT_LOG2)
+
+/** @brief Blocks must be smaller than 2^HEAP_FL_INDEX_MAX bytes. The default
+ *      covers the RAM of the target. Override to adjust */
+#ifndef HEAP_FL_INDEX_MAX
+#define HEAP_FL_INDEX_MAX   18
+#endif
+
+/** @brief Sizes below 2^HEAP_FL_INDEX_SHIFT are all in the first first level list */
+#define HEAP_FL_INDEX_SHIFT (HEAP_SL_COUNT_LOG2 + HEAP_ALIGN_LOG2)
+
+/** @brief Number of first level lists */
+#define HEAP_FL_COUNT       (HEAP_FL_INDEX_MAX - HEAP_FL_INDEX_SHIFT + 1)
+
+/* =================== TYPE DEFINITIONS ======================= */
+
+/** @brief Header of a block of heap memory. Only the previous block pointer
+ *      and the size are kept for allocated blocks, their data follows */
+typedef struct Heap_Block {
+    /** @brief Previous block in memory, for merging */
+    struct Heap_Block *prev_phys;
+
+    /** @brief Size of the block's data, flags in the low bits */
+    uint32_t size;
+
+    /** @brief Neighbours in the free list, in the data of a free block */
+    struct Heap_Block *next_free;
+    struct Heap_Block *prev_free;
+} heap_block_t;
+
+/** @brief A heap. Initialize with @ref heap_init */
+typedef struct Heap {
+    /** @brief Bit of each first level with any free blocks */
+    uint32_t fl_bitmap;
+
+    /** @brief Bit of each non-empty second level list, per first level */
+    uint32_t sl_bitmap[HEAP_FL_COUNT];
+
+    /** @brief Heads of the free lists, valid where the bitmaps are set */
+    heap_block_t *blocks[HEAP_FL_COUNT][HEAP_SL_COUNT];
+
+    /** @brief Bytes available for allocation, when nothing is allocated */
+    uint32_t size;
+
+    /** @brief Bytes in free blocks */
+    uint32_t free_bytes;
+
+    /** @brief Lowest value of free_bytes since initialization */
+    uint32_t free_min;
+
+    /** @brief Number of allocated blocks */
+    uint32_t allocated;
+} heap_t;
+
+/** @brief Heap statistics, see @ref heap_get_stats */
+typedef struct Heap_Stats {
+    /** @brief Bytes available for allocation, when nothing is allocated */
+    uint32_t size;
+
+    /** @brief Bytes in free blocks */
+    uint32_t free_bytes;
+
+    /** @brief Lowest number of free bytes since initialization */
+    uint32_t free_min;
+
+    /** @brief Largest block that can be allocated */
+    uint32_t largest_free;
+
+    /** @brief Number of allocated blocks */
+    uint32_t allocated;
+
+    /** @brief Percentage of free bytes not in the largest free block */
+    uint32_t fragmentation;
+} heap_stats_t;
+
+/* =================== FUNCTION DECLARATIONS ================== */
+
+int heap_init(heap_t *heap, void *mem, uint32_t size);
+void *heap_alloc(heap_t *heap, uint32_t size);
+void heap_free(heap_t *heap, void *ptr);
+void heap_get_stats(heap_t *heap, heap_stats_t *stats);
+
+void *mem_alloc(uint32_t size);
+void mem_free(void *ptr);
+void mem_get_stats(heap_stats_t *stats);
+
+#endif /* __HEAP_H__ */
@@ -0,0 +1,261 @@
+/*
+ * @file log.c
+ * @brief Implementation of deferred binary logging, and the log buffer
+ *      drained by the logger task
+ *
+ * The log buffer is a ring shared by any number of producers, tasks and
+ * interrupts, and read by the logger task. A producer reserves room for its
+ * output with a compare-and-swap of the reserve index, copies the output
+ * after a header byte, and commits it by setting the top bit of the header.
+ * The logger sends committed output in order, and stops at output still
+ * being written by a preempted producer.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include "uart.h"
+#include "system.h"
+#include "os.h"
+#include "print/print.h"
+#include "log.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Maximum length of a varint of a pointer sized value */
+#define LOG_VARINT_MAX      ((sizeof(uintptr_t) * 8 + 6) / 7)
+
+/** @brief Maximum length of a record; header, format ID, timestamp and arguments */
+#define LOG_RECORD_MAX      (1 + LOG_VARINT_MAX + 5 + LOG_MAX_ARGS * 5)
+
+/** @brief Size of the log buffer. Must be a power of 2. Override to adjust */
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE     1024
+#endif
+
+#if (LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) != 0
+#error "LOG_BUFFER_SIZE must be a power of 2"
+#endif
+
+/** @brief Mask for wrapping log buffer indices */
+#define LOG_BUFFER_MASK     (LOG_BUFFER_SIZE - 1)
+
+/** @brief Header bit of output that has been completely written */
+#define LOG_COMMITTED       0x80U
+
+/* ========================= FUNCTION DECLARATIONS ============= */
+/* ========================= STATIC DATA ======================= */
+
+/** @brief Log buffer; pieces of output, each after a header byte with the length */
+static uint8_t log_buffer[LOG_BUFFER_SIZE];
+
+/** @brief Free running index up to which the buffer has been reserved by producers.
+ *      Not static, for the tests to stand in for a preempted producer */
+volatile uint32_t log_reserved;
+
+/** @brief Free running index up to which the buffer has been sent by the logger */
+volatile uint32_t log_consumed;
+
+/** @brief Number of pieces of output dropped because the buffer was full */
+static volatile uint32_t log_dropped;
+
+/** @brief Number of pieces of output committed, ever. Updated before @ref log_ready
+ *      is signalled, for the logger not to miss output committed as it starts waiting */
+static volatile uint32_t log_commits;
+
+/** @brief Signalled when output is committed */
+static os_event_t log_ready;
+
+/** @brief Set by the logger task when it starts, after which output is buffered */
+volatile uint32_t log_task_started;
+
+/* ========================= FUNCTION DEFINITIONS ============== */
+
+/**
+ * @brief Encode a value as a LEB128 varint; seven bits per byte, low bits
+ *      first, the top bit set on all but the last byte
+ * @param[out] out  buffer to encode to
+ * @param[in] value value to encode
+ *
+ * @return number of bytes written
+ */
+static uint32_t log_varint(uint8_t *out, uintptr_t value)
+{
+    uint32_t len = 0;
+
+    while(value >= 0x80) {
+        out[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[len++] = (uint8_t)value;
+
+    return len;
+}
+
+/**
+ * @brief Append one piece of output into the log buffer
+ * @param[in] data  output to append
+ * @param[in] len   length of the output, at most @ref LOG_CHUNK_MAX
+ *
+ * @return 0 on success, -1 if the output was dropped
+ */
+static int log_put_chunk(const char *data, uint32_t len)
+{
+    uint32_t head, i;
+
+    head = __atomic_load_n(&log_reserved, __ATOMIC_RELAXED);
+    do {
+        if(head + 1 + len - __atomic_load_n(&log_consumed, __ATOMIC_ACQUIRE) > LOG_BUFFER_SIZE) {
+            __atomic_fetch_add(&log_dropped, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+    } while(!__atomic_compare_exchange_n(&log_reserved, &head, head + 1 + len, 0,
+                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    for(i = 0; i < len; i++) {
+        log_buffer[(head + 1 + i) & LOG_BUFFER_MASK] = (uint8_t)data[i];
+    }
+    __atomic_store_n(&log_buffer[head & LOG_BUFFER_MASK], (uint8_t)(LOG_COMMITTED | len),
+        __ATOMIC_RELEASE);
+    __atomic_fetch_add(&log_commits, 1, __ATOMIC_SEQ_CST);
+
+    if(log_ready) {
+        event_signal(&log_ready);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Output text or log records. Appended into the log buffer once the
+ *      logger task is running, sent to the UART directly before that.
+ *      Never blocks on the UART when buffered
+ * @param[in] data  output
+ * @param[in] len   length of the output
+ *
+ * @return 0 on success, -1 if some of the output was dropped
+ */
+int log_put(const char *data, uint32_t len)
+{
+    uint32_t chunk;
+    int ret = 0;
+
+    if(!log_task_started) {
+        while(len--) {
+            (void)UART_print_chr(data++);
+        }
+        return 0;
+    }
+
+    while(len) {
+        chunk = (len > LOG_CHUNK_MAX) ? LOG_CHUNK_MAX : len;
+        if(log_put_chunk(data, chunk) != 0) {
+            ret = -1;
+        }
+        data += chunk;
+        len -= chunk;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Send all committed output in the log buffer to the UART. Called by
+ *      the logger task; must not be called from elsewhere while it runs
+ */
+void log_drain(void)
+{
+    uint32_t tail = log_consumed;
+    uint32_t len, i;
+    uint8_t header;
+
+    while(tail != __atomic_load_n(&log_reserved, __ATOMIC_ACQUIRE)) {
+        header = __atomic_load_n(&log_buffer[tail & LOG_BUFFER_MASK], __ATOMIC_ACQUIRE);
+        if(!(header & LOG_COMMITTED)) {
+            /* Still being written by a preempted producer */
+            break;
+        }
+
+        len = header & ~LOG_COMMITTED;
+        for(i = 0; i < len; i++) {
+            (void)UART_print_chr((const char *)&log_buffer[(tail + 1 + i) & LOG_BUFFER_MASK]);
+        }
+
+        /* Clear the header and the output, before the space is released. A later
+            reservation may start on any of these bytes, and must not look committed */
+        for(i = 0; i <= len; i++) {
+            log_buffer[(tail + i) & LOG_BUFFER_MASK] = 0;
+        }
+        tail += 1 + len;
+        __atomic_store_n(&log_consumed, tail, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief Get the number of pieces of output dropped because the log buffer was full
+ *
+ * @return number of pieces dropped since boot
+ */
+uint32_t log_dropped_count(void)
+{
+    return log_dropped;
+}
+
+/**
+ * @brief Logger task, sending buffered output to the UART. Register with a
+ *      priority just above the idle task, so that logging never delays other tasks
+ */
+void log_task(void* arg1, void* arg2, void* arg3)
+{
+    uint32_t reported = 0;
+    uint32_t dropped;
+    uint32_t commits;
+
+    (void)arg1;
+    (void)arg2;
+    (void)arg3;
+
+    log_task_started = 1;
+
+    while(1) {
+        commits = __atomic_load_n(&log_commits, __ATOMIC_SEQ_CST);
+        log_drain();
+
+        /* Report drops through the buffer, more drops are counted if it is full again */
+        dropped = log_dropped;
+        if(dropped != reported) {
+            reported = dropped;
+            print_hex("LOG dropped ", dropped);
+            continue;
+        }
+
+        (void)event_wait_seq(&log_ready, &log_commits, commits, OS_WAIT_FOREVER);
+    }
+}
+
+/**
+ * @brief Send a log record. Use through the @ref LOG macro
+ * @param[in] fmt   format string in the .logstr section
+ * @param[in] args  argument words
+ * @param[in] nargs number of arguments, at most @ref LOG_MAX_ARGS
+ */
+void log_write(const char *fmt, const uint32_t *args, uint32_t nargs)
+{
+    uint8_t record[LOG_RECORD_MAX];
+    uint32_t len = 0;
+    uint32_t i;
+
+    if(nargs > LOG_MAX_ARGS) {
+        nargs = LOG_MAX_ARGS;
+    }
+
+    record[len++] = (uint8_t)(LOG_RECORD_TAG | nargs);
+    len += log_varint(&record[len], (uintptr_t)fmt);
+    len += log_varint(&record[len], (uint32_t)TICK_get());
+    for(i = 0; i < nargs; i++) {
+        len += log_varint(&record[len], args[i]);
+    }
+
+    (void)log_put((const char *)record, len);
+}
@@ -0,0 +1,65 @@
+/*
+ * @file log.h
+ * @brief Deferred binary logging. Log calls send a compact record instead of
+ *      text, and the text is formatted on the host by scripts/log_decode.py
+ *
+ * A record is a header byte, followed by LEB128 varints:
+ *
+ *      0x80 | nargs, format ID, timestamp in ticks, nargs argument words
+ *
+ * The format ID is the address of the format string in the .logstr section,
+ * which is not loaded on target. The header byte is never printable ASCII,
+ * so records can be mixed with text output on the same UART.
+ *
+ * Once @ref log_task is running, log records and print() output are appended
+ * into a buffer shared by all tasks and interrupts, without blocking, and the
+ * logger task sends them to the UART. Output that does not fit is dropped,
+ * and counted. Before that, output is sent to the UART directly.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+#ifndef __LOG_H__
+#define __LOG_H__
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+
+/* =================== MACRO DEFINITIONS ====================== */
+
+/** @brief Tag of the record header byte, the argument count is in the low bits */
+#define LOG_RECORD_TAG      0x80U
+
+/** @brief Maximum number of arguments in one record */
+#define LOG_MAX_ARGS        8
+
+/** @brief Maximum length of output appended into the log buffer as one piece.
+ *      Longer output is split, and may be interleaved with other output */
+#define LOG_CHUNK_MAX       127
+
+/**
+ * @brief Log a message. The format string must be a literal, and the arguments
+ *      integers of at most 32 bits; %d %i %u %x %X %c and %p are supported.
+ *      Pointers must be cast to uintptr_t
+ * @param fmt   printf-style format string
+ */
+#define LOG(fmt, ...)                                                           \
+    do {                                                                        \
+        static const char __log_fmt[]                                           \
+            __attribute__((section(".logstr"), used)) = fmt;                    \
+        const uint32_t __log_args[] = { 0, ##__VA_ARGS__ };                     \
+        _Static_assert(sizeof(__log_args) / sizeof(uint32_t) - 1 <= LOG_MAX_ARGS, \
+            "too many log arguments");                                          \
+        log_write(__log_fmt, &__log_args[1],                                    \
+            sizeof(__log_args) / sizeof(uint32_t) - 1);                         \
+    } while(0)
+
+/* =================== FUNCTION DECLARATIONS ================== */
+
+void log_write(const char *fmt, const uint32_t *args, uint32_t nargs);
+int log_put(const char *data, uint32_t len);
+void log_drain(void);
+uint32_t log_dropped_count(void);
+void log_task(void* arg1, void* arg2, void* arg3);
+
+#endif /* __LOG_H__ */
@@ -0,0 +1,205 @@
+/*
+ * @file pool.c
+ * @brief Implementation of the fixed-size memory block pools
+ *
+ * The free list head holds the number of the first free block, and each free
+ * block holds the number of the next one in its first word. A pop reads the
+ * head and the next number, and swaps the head to the next one if it is still
+ * the same. An interrupt may pop that block and push it back in between,
+ * leaving the same block first but another one next; the head also counts
+ * updates in its high half so that such a head no longer matches.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include "system.h"
+#include "os.h"
+#include "atomic/atomic.h"
+#include "pool.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Block number bits of the free list head */
+#define POOL_HEAD_INDEX         0xFFFFU
+
+/** @brief Update count increment of the free list head */
+#define POOL_HEAD_TAG           0x10000U
+
+/* ========================= FUNCTION DEFINITIONS ============== */
+
+/** @brief Block by its number, counting from one */
+static inline uint8_t *pool_block(pool_t *pool, uint32_t index)
+{
+    return pool->blocks + (index - 1) * pool->block_size;
+}
+
+/**
+ * @brief Take the first block of the free list
+ * @param[in] pool  pool
+ *
+ * @return block, or 0 if the list is empty
+ */
+static void *pool_pop(pool_t *pool)
+{
+    uint32_t head;
+    uint32_t next;
+    uint8_t *block;
+
+    do {
+        head = atomic_load(&pool->free_head);
+        if(!(head & POOL_HEAD_INDEX)) {
+            return 0;
+        }
+        block = pool_block(pool, head & POOL_HEAD_INDEX);
+        next = *(volatile uint32_t *)block;
+    } while(!atomic_cas(&pool->free_head, head,
+                ((head + POOL_HEAD_TAG) & ~POOL_HEAD_INDEX) | next));
+
+    return block;
+}
+
+/**
+ * @brief Take a block never allocated before from the end of the pool
+ * @param[in] pool  pool
+ *
+ * @return block, or 0 if all blocks have been allocated
+ */
+static void *pool_carve(pool_t *pool)
+{
+    uint32_t carved;
+
+    do {
+        carved = atomic_load(&pool->carved);
+        if(carved >= pool->count) {
+            return 0;
+        }
+    } while(!atomic_cas(&pool->carved, carved, carved + 1));
+
+    return pool_block(pool, carved + 1);
+}
+
+/**
+ * @brief Allocate a block in constant time, without blocking. May be called
+ *      from tasks and interrupts
+ * @param[in] pool  pool
+ *
+ * @return block, or 0 if the pool is empty
+ */
+void *pool_alloc(pool_t *pool)
+{
+    void *block;
+
+    block = pool_pop(pool);
+    if(!block) {
+        block = pool_carve(pool);
+        if(!block) {
+            return 0;
+        }
+    }
+
+    atomic_max(&pool->used_max, atomic_add(&pool->used, 1));
+
+    return block;
+}
+
+/**
+ * @brief Allocate a block, waiting for one to be freed if the pool is empty.
+ *      Must be called from a task
+ * @param[in] pool  pool
+ * @param[in] ms    longest wait in milliseconds, or OS_WAIT_FOREVER
+ *
+ * @return block, or 0 on timeout or if the scheduler is not running
+ */
+void *pool_alloc_wait(pool_t *pool, int ms)
+{
+    uint64_t deadline;
+    uint64_t now;
+    uint32_t head;
+    void *block;
+    int wait;
+
+    deadline = TICK_get() + (uint64_t)(ms < 0 ? 0 : ms);
+
+    while(1) {
+        /* Every free updates the head, one after this is not missed while starting to wait */
+        head = atomic_load(&pool->free_head);
+        block = pool_alloc(pool);
+        if(block) {
+            return block;
+        }
+
+        wait = OS_WAIT_FOREVER;
+        if(ms >= 0) {
+            now = TICK_get();
+            if(now >= deadline) {
+                return 0;
+            }
+            wait = (int)(deadline - now);
+        }
+
+        if(event_wait_seq(&pool->available, &pool->free_head, head, wait) == OS_ERROR) {
+            return 0;
+        }
+    }
+}
+
+/**
+ * @brief Return a block to its pool in constant time, waking the tasks
+ *      waiting for one. May be called from tasks and interrupts
+ * @param[in] pool  pool of the block
+ * @param[in] block block, may be 0
+ *
+ * @return OS_OK, or OS_ERROR if the block is not a block of the pool.
+ *      Freeing a block twice is not detected
+ */
+int pool_free(pool_t *pool, void *block)
+{
+    uint32_t offset;
+    uint32_t head;
+    uint32_t index;
+
+    if(!block) {
+        return OS_OK;
+    }
+
+    offset = (uint32_t)((uint8_t *)block - pool->blocks);
+    if((uint8_t *)block < pool->blocks || offset >= pool->count * pool->block_size
+        || offset % pool->block_size) {
+        return OS_ERROR;
+    }
+    index = offset / pool->block_size + 1;
+
+    (void)atomic_sub(&pool->used, 1);
+
+    do {
+        head = atomic_load(&pool->free_head);
+        *(volatile uint32_t *)block = head & POOL_HEAD_INDEX;
+    } while(!atomic_cas(&pool->free_head, head,
+                ((head + POOL_HEAD_TAG) & ~POOL_HEAD_INDEX) | index));
+
+    if(pool->available) {
+        event_signal(&pool->available);
+    }
+
+    return OS_OK;
+}
+
+/**
+ * @brief Get the usage of a pool
+ * @param[in] pool      pool
+ * @param[out] stats    statistics
+ */
+void pool_get_stats(pool_t *pool, pool_stats_t *stats)
+{
+    uint32_t used;
+
+    used = atomic_load(&pool->used);
+
+    stats->block_size = pool->block_size;
+    stats->count = pool->count;
+    stats->used = used;
+    stats->free = pool->count - used;
+    stats->free_min = pool->count - atomic_load(&pool->used_max);
+}
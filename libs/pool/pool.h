@@ -0,0 +1,110 @@
+/*
+ * @file pool.h
+ * @brief Fixed-size memory block pools. Allocation and free take constant
+ *      time, are lock-free, and can be called from interrupts
+ *
+ * A pool is declared statically with @ref OS_POOL_DEFINE and needs no
+ * initialization. Freed blocks are kept in a list linked through the blocks
+ * themselves, updated with a compare and swap, and blocks never allocated
+ * yet are handed out from the end of the pool. Tasks can wait for a block
+ * with @ref pool_alloc_wait when the pool is empty.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+#ifndef __POOL_H__
+#define __POOL_H__
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include "os.h"
+
+/* =================== MACRO DEFINITIONS ====================== */
+
+/** @brief Alignment of the blocks, and granularity of block sizes */
+#define POOL_ALIGN              4
+
+/** @brief Largest number of blocks in a pool */
+#define POOL_COUNT_MAX          0xFFFFU
+
+/** @brief Size of the blocks of a pool, a free block must fit the list link */
+#define POOL_BLOCK_SIZE(size)   ((size) < POOL_ALIGN ? POOL_ALIGN : \
+                                    ((size) + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1))
+
+/**
+ * @brief Define a pool of blocks
+ * @param name          name of the pool
+ * @param blk_size      size of the blocks in bytes
+ * @param blk_count     number of blocks
+ */
+#define OS_POOL_DEFINE(name, blk_size, blk_count)                               \
+_Static_assert((blk_count) > 0 && (blk_count) <= POOL_COUNT_MAX,                \
+    "pool " #name " block count out of range");                                 \
+                                                                                \
+static uint32_t __pool_##name##_blocks[                                         \
+    (POOL_BLOCK_SIZE(blk_size) / POOL_ALIGN) * (blk_count)                      \
+];                                                                              \
+                                                                                \
+pool_t name = {                                                                 \
+    .blocks = (uint8_t *)__pool_##name##_blocks,                                \
+    .block_size = POOL_BLOCK_SIZE(blk_size),                                    \
+    .count = (blk_count),                                                       \
+}
+
+/* =================== TYPE DEFINITIONS ======================= */
+
+/** @brief A pool of blocks. Define with @ref OS_POOL_DEFINE */
+typedef struct Pool {
+    /** @brief Memory of the blocks */
+    uint8_t *blocks;
+
+    /** @brief Size of each block */
+    uint32_t block_size;
+
+    /** @brief Number of blocks */
+    uint32_t count;
+
+    /** @brief Free list head: the number of the first free block plus one, or
+     *      zero if empty, in the low half. The high half counts the updates,
+     *      for a head read before a pop and push pair not to match */
+    volatile uint32_t free_head;
+
+    /** @brief Number of blocks allocated from the end of the pool, ever */
+    volatile uint32_t carved;
+
+    /** @brief Number of blocks allocated */
+    volatile uint32_t used;
+
+    /** @brief Highest number of blocks allocated at once */
+    volatile uint32_t used_max;
+
+    /** @brief Tasks waiting for a free block */
+    os_event_t available;
+} pool_t;
+
+/** @brief Pool statistics, see @ref pool_get_stats */
+typedef struct Pool_Stats {
+    /** @brief Size of each block */
+    uint32_t block_size;
+
+    /** @brief Number of blocks */
+    uint32_t count;
+
+    /** @brief Number of blocks allocated */
+    uint32_t used;
+
+    /** @brief Number of free blocks */
+    uint32_t free;
+
+    /** @brief Lowest number of free blocks, the low-water mark */
+    uint32_t free_min;
+} pool_stats_t;
+
+/* =================== FUNCTION DECLARATIONS ================== */
+
+void *pool_alloc(pool_t *pool);
+void *pool_alloc_wait(pool_t *pool, int ms);
+int pool_free(pool_t *pool, void *block);
+void pool_get_stats(pool_t *pool, pool_stats_t *stats);
+
+#endif /* __POOL_H__ */
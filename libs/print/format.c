@@ -0,0 +1,394 @@
+/*
+ * @file format.c
+ * @brief Freestanding printf-style formatter. Formats into a sink callback,
+ *      or a caller buffer, with no libc and no state outside the call
+ *
+ * Supported conversions are %d %i %u %x %X %s %c %p and %%, with the flags
+ * '-' (left align) and '0' (zero padding), a width given as digits or '*',
+ * and the length modifiers 'l' and 'll' for long and 64-bit integers.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include <stdarg.h>
+#include "print.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Size of the staging buffer, output is passed to the sink in pieces of this size */
+#define FORMAT_STAGE_SIZE   32
+
+/** @brief Maximum number of digits of a 64-bit integer, in decimal */
+#define FORMAT_DIGITS_MAX   20
+
+/** @brief Conversion flags */
+#define FORMAT_LEFT         (1U << 0)
+#define FORMAT_ZERO         (1U << 1)
+
+/* ========================= TYPE DEFINITIONS ================== */
+
+/** @brief State of one formatting call */
+typedef struct Format_State {
+    /** @brief Where the output goes */
+    Print_Sink sink;
+    void *ctx;
+
+    /** @brief Output not yet passed to the sink */
+    char stage[FORMAT_STAGE_SIZE];
+    uint32_t staged;
+
+    /** @brief Number of characters output */
+    int count;
+} format_state_t;
+
+/** @brief Caller buffer written to by @ref print_format */
+typedef struct Format_Buffer {
+    char *buf;
+    uint32_t size;
+    uint32_t len;
+} format_buffer_t;
+
+/* ========================= FUNCTION DECLARATIONS ============= */
+/* ========================= STATIC DATA ======================= */
+
+/** @brief Powers of ten for converting 64-bit integers without division */
+static const uint64_t format_pow10[FORMAT_DIGITS_MAX] = {
+    10000000000000000000ULL, 1000000000000000000ULL, 100000000000000000ULL,
+    10000000000000000ULL, 1000000000000000ULL, 100000000000000ULL, 10000000000000ULL,
+    1000000000000ULL, 100000000000ULL, 10000000000ULL, 1000000000ULL, 100000000ULL,
+    10000000ULL, 1000000ULL, 100000ULL, 10000ULL, 1000ULL, 100ULL, 10ULL, 1ULL
+};
+
+/* ========================= FUNCTION DEFINITIONS ============== */
+
+/**
+ * @brief Pass the staged output to the sink
+ * @param[in] st    formatting state
+ */
+static void format_flush(format_state_t *st)
+{
+    if(st->staged) {
+        st->sink(st->ctx, st->stage, st->staged);
+        st->staged = 0;
+    }
+}
+
+/**
+ * @brief Output a character
+ * @param[in] st    formatting state
+ * @param[in] c     character to output
+ */
+static void format_chr(format_state_t *st, char c)
+{
+    if(st->staged == FORMAT_STAGE_SIZE) {
+        format_flush(st);
+    }
+    st->stage[st->staged++] = c;
+    st->count++;
+}
+
+/**
+ * @brief Output a character repeatedly
+ * @param[in] st    formatting state
+ * @param[in] c     character to output
+ * @param[in] n     number of times to output it
+ */
+static void format_fill(format_state_t *st, char c, int n)
+{
+    while(n-- > 0) {
+        format_chr(st, c);
+    }
+}
+
+/**
+ * @brief Output a field, padded to a width
+ * @param[in] st        formatting state
+ * @param[in] prefix    sign or "0x" before the digits, may be empty
+ * @param[in] str       the field
+ * @param[in] len       length of the field
+ * @param[in] width     minimum width of the output, including the prefix
+ * @param[in] flags     FORMAT_LEFT and FORMAT_ZERO
+ */
+static void format_field(format_state_t *st, const char *prefix, const char *str, int len,
+    int width, uint32_t flags)
+{
+    int plen = 0;
+    int pad;
+
+    while(prefix[plen]) {
+        plen++;
+    }
+    pad = width - plen - len;
+
+    if(!(flags & (FORMAT_LEFT | FORMAT_ZERO))) {
+        format_fill(st, ' ', pad);
+    }
+    while(*prefix) {
+        format_chr(st, *prefix++);
+    }
+    if((flags & (FORMAT_LEFT | FORMAT_ZERO)) == FORMAT_ZERO) {
+        format_fill(st, '0', pad);
+    }
+    while(len-- > 0) {
+        format_chr(st, *str++);
+    }
+    if(flags & FORMAT_LEFT) {
+        format_fill(st, ' ', pad);
+    }
+}
+
+/**
+ * @brief Convert an integer to hex digits, with shifts only
+ * @param[out] end  end of the buffer to convert into, digits are written backwards
+ * @param[in] value integer to convert
+ * @param[in] upper use upper case digits
+ *
+ * @return number of digits
+ */
+static int format_hex(char *end, uint64_t value, int upper)
+{
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    int len = 0;
+
+    do {
+        *--end = digits[value & 0xFU];
+        value >>= 4;
+        len++;
+    } while(value);
+
+    return len;
+}
+
+/**
+ * @brief Convert an integer to decimal digits. 32-bit values are divided, the
+ *      hardware divides those; 64-bit ones are converted by subtracting powers
+ *      of ten, as there is no library for 64-bit division
+ * @param[out] buf  buffer of at least @ref FORMAT_DIGITS_MAX characters
+ * @param[in] value integer to convert
+ *
+ * @return number of digits, written from the start of the buffer
+ */
+static int format_dec(char *buf, uint64_t value)
+{
+    char tmp[FORMAT_DIGITS_MAX];
+    uint32_t v32;
+    int len = 0;
+    int i;
+    char digit;
+
+    if(value <= 0xFFFFFFFFULL) {
+        v32 = (uint32_t)value;
+        do {
+            tmp[len++] = '0' + (char)(v32 % 10);
+            v32 /= 10;
+        } while(v32);
+
+        for(i = 0; i < len; i++) {
+            buf[i] = tmp[len - 1 - i];
+        }
+        return len;
+    }
+
+    /* Skip leading zeros; the value has at least ten digits */
+    for(i = 0; value < format_pow10[i]; i++) { ; }
+    for(; i < FORMAT_DIGITS_MAX; i++) {
+        digit = '0';
+        while(value >= format_pow10[i]) {
+            value -= format_pow10[i];
+            digit++;
+        }
+        buf[len++] = digit;
+    }
+
+    return len;
+}
+
+/**
+ * @brief Format into a sink callback
+ * @param[in] sink  called with pieces of the output
+ * @param[in] ctx   passed to the sink
+ * @param[in] fmt   printf-style format string
+ * @param[in] args  arguments
+ *
+ * @return number of characters output
+ */
+int print_vformat(Print_Sink sink, void *ctx, const char *fmt, va_list args)
+{
+    format_state_t st;
+    char digits[FORMAT_DIGITS_MAX];
+    const char *prefix;
+    const char *str;
+    uint64_t value;
+    int64_t svalue;
+    uint32_t flags;
+    int width, longs, len;
+
+    st.sink = sink;
+    st.ctx = ctx;
+    st.staged = 0;
+    st.count = 0;
+
+    while(*fmt) {
+        if(*fmt != '%') {
+            format_chr(&st, *fmt++);
+            continue;
+        }
+        fmt++;
+
+        /* Flags */
+        flags = 0;
+        while(*fmt == '-' || *fmt == '0') {
+            flags |= (*fmt == '-') ? FORMAT_LEFT : FORMAT_ZERO;
+            fmt++;
+        }
+
+        /* Width */
+        width = 0;
+        if(*fmt == '*') {
+            width = va_arg(args, int);
+            if(width < 0) {
+                flags |= FORMAT_LEFT;
+                width = -width;
+            }
+            fmt++;
+        }
+        while(*fmt >= '0' && *fmt <= '9') {
+            width = width * 10 + (*fmt++ - '0');
+        }
+
+        /* Length */
+        longs = 0;
+        while(*fmt == 'l') {
+            longs++;
+            fmt++;
+        }
+
+        prefix = "";
+        switch(*fmt) {
+        case 'd':
+        case 'i':
+            if(longs >= 2) {
+                svalue = va_arg(args, long long);
+            } else if(longs == 1) {
+                svalue = va_arg(args, long);
+            } else {
+                svalue = va_arg(args, int);
+            }
+            if(svalue < 0) {
+                prefix = "-";
+                value = (uint64_t)0 - (uint64_t)svalue;
+            } else {
+                value = (uint64_t)svalue;
+            }
+            len = format_dec(digits, value);
+            format_field(&st, prefix, digits, len, width, flags);
+            break;
+
+        case 'u':
+        case 'x':
+        case 'X':
+            if(longs >= 2) {
+                value = va_arg(args, unsigned long long);
+            } else if(longs == 1) {
+                value = va_arg(args, unsigned long);
+            } else {
+                value = va_arg(args, unsigned int);
+            }
+            if(*fmt == 'u') {
+                len = format_dec(digits, value);
+                format_field(&st, prefix, digits, len, width, flags);
+            } else {
+                len = format_hex(&digits[FORMAT_DIGITS_MAX], value, *fmt == 'X');
+                format_field(&st, prefix, &digits[FORMAT_DIGITS_MAX - len], len, width, flags);
+            }
+            break;
+
+        case 'p':
+            /* Pointers are printed with all their digits */
+            value = (uintptr_t)va_arg(args, void *);
+            len = format_hex(&digits[FORMAT_DIGITS_MAX], value, 0);
+            while(len < (int)sizeof(void *) * 2) {
+                digits[FORMAT_DIGITS_MAX - ++len] = '0';
+            }
+            format_field(&st, "0x", &digits[FORMAT_DIGITS_MAX - len], len,
+                width, flags & ~FORMAT_ZERO);
+            break;
+
+        case 's':
+            str = va_arg(args, const char *);
+            if(!str) {
+                str = "(null)";
+            }
+            for(len = 0; str[len]; len++) { ; }
+            format_field(&st, prefix, str, len, width, flags & ~FORMAT_ZERO);
+            break;
+
+        case 'c':
+            digits[0] = (char)va_arg(args, int);
+            format_field(&st, prefix, digits, 1, width, flags & ~FORMAT_ZERO);
+            break;
+
+        case '%':
+            format_chr(&st, '%');
+            break;
+
+        case '\0':
+            /* Format string ended in the middle of a conversion */
+            format_flush(&st);
+            return st.count;
+
+        default:
+            /* Unknown conversion, output as is */
+            format_chr(&st, '%');
+            format_chr(&st, *fmt);
+            break;
+        }
+        fmt++;
+    }
+
+    format_flush(&st);
+    return st.count;
+}
+
+/**
+ * @brief Sink of @ref print_format, copying into the caller buffer
+ * @param[in] ctx   the buffer, @ref format_buffer_t
+ * @param[in] data  output
+ * @param[in] len   length of the output
+ */
+static void format_buffer_sink(void *ctx, const char *data, uint32_t len)
+{
+    format_buffer_t *out = (format_buffer_t *)ctx;
+
+    while(len-- && out->len + 1 < out->size) {
+        out->buf[out->len++] = *data++;
+    }
+}
+
+/**
+ * @brief Format into a caller buffer. The output is always null-terminated,
+ *      and truncated if it does not fit
+ * @param[out] buf  buffer to format into
+ * @param[in] size  size of the buffer, including the null terminator
+ * @param[in] fmt   printf-style format string
+ *
+ * @return number of characters written, not counting the null terminator
+ */
+int print_format(char *buf, uint32_t size, const char *fmt, ...)
+{
+    format_buffer_t out = { buf, size, 0 };
+    va_list args;
+
+    if(!buf || !size) {
+        return 0;
+    }
+
+    va_start(args, fmt);
+    (void)print_vformat(&format_buffer_sink, &out, fmt, args);
+    va_end(args);
+
+    buf[out.len] = 0;
+    return (int)out.len;
+}
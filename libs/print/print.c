@@ -1,28 +1,99 @@
 /*
  * @file print.c
- * @brief Implementation of generic debug print operations
+ * @brief Implementation of generic debug print operations. Each line is
+ *      collected into a buffer, and output in one piece through the log
+ *      buffer, see log/log.h
  *
  *      Copyright (c) 2025 Miikka Lukumies
  */
 
 /* ========================= INCLUDES ========================= */
 #include <stdint.h>
+#include <stdarg.h>
 #include "uart.h"
+#include "log/log.h"
 #include "print.h"
 
 /* ========================= CONSTANTS ========================= */
+
+/** @brief Size of the line buffer; lines longer than this are output in pieces */
+#define PRINT_LINE_MAX  LOG_CHUNK_MAX
+
+/* ========================= TYPE DEFINITIONS ================== */
+
+/** @brief Line being collected for output */
+typedef struct Print_Line {
+    /** @brief Characters collected */
+    char buf[PRINT_LINE_MAX];
+
+    /** @brief Number of characters collected */
+    uint32_t len;
+} print_line_t;
+
 /* ========================= FUNCTION DECLARATIONS ============= */
 /* ========================= STATIC DATA ======================= */
 /* ========================= FUNCTION DEFINITIONS ============== */
 
+/**
+ * @brief Append a character to a line, outputting the line so far if it is full
+ * @param[in] line  line to append to
+ * @param[in] c     character to append
+ */
+static void print_chr(print_line_t *line, char c)
+{
+    if(line->len == PRINT_LINE_MAX) {
+        (void)log_put(line->buf, line->len);
+        line->len = 0;
+    }
+    line->buf[line->len++] = c;
+}
+
+/**
+ * @brief Append a null-terminated string to a line
+ * @param[in] line  line to append to
+ * @param[in] str   string to append
+ */
+static void print_str(print_line_t *line, const char *str)
+{
+    while(*str) {
+        print_chr(line, *str++);
+    }
+}
+
+/**
+ * @brief End a line, and output it
+ * @param[in] line  line to output
+ */
+static void print_end(print_line_t *line)
+{
+    print_str(line, "\r\n");
+    (void)log_put(line->buf, line->len);
+}
+
+/**
+ * @brief Sink of @ref print_fmt, appending to a line
+ * @param[in] ctx   line to append to
+ * @param[in] data  formatted output
+ * @param[in] len   length of the output
+ */
+static void print_sink(void *ctx, const char *data, uint32_t len)
+{
+    while(len--) {
+        print_chr((print_line_t *)ctx, *data++);
+    }
+}
+
 /**
  * @brief Prints a null-terminated string and newline
  * @param[in] msg   string to print
  */
 void print(const char *msg)
 {
-    (void)UART_print_str(msg);
-    (void)UART_print_str("\r\n");
+    print_line_t line;
+
+    line.len = 0;
+    print_str(&line, msg);
+    print_end(&line);
 }
 /**
  * @brief Prints a null-terminated string, a hex value, and a newline
@@ -31,12 +102,14 @@ void print(const char *msg)
  */
 void print_hex(const char *msg, uint32_t value)
 {
+    print_line_t line;
     uint32_t tmp;
     int32_t i;
     char c;
 
-    (void)UART_print_str(msg);
-    (void)UART_print_str("0x");
+    line.len = 0;
+    print_str(&line, msg);
+    print_str(&line, "0x");
 
     for( i = 7; i >= 0; i--) {
         tmp = value >> (i*4) & 0xFUL; 
@@ -46,8 +119,24 @@ void print_hex(const char *msg, uint32_t value)
             c = 'A' + (char)(tmp - 10);
 
         }
-        (void)UART_print_chr(&c);
+        print_chr(&line, c);
     }
 
-    (void)UART_print_str("\r\n");
+    print_end(&line);
+}
+/**
+ * @brief Prints a formatted string and a newline, see format.c for the
+ *      supported conversions
+ * @param[in] fmt   printf-style format string
+ */
+void print_fmt(const char *fmt, ...)
+{
+    print_line_t line;
+    va_list args;
+
+    line.len = 0;
+    va_start(args, fmt);
+    (void)print_vformat(&print_sink, &line, fmt, args);
+    va_end(args);
+    print_end(&line);
 }
@@ -10,10 +10,20 @@
 
 /* ========================= INCLUDES ========================= */
 #include <stdint.h>
+#include <stdarg.h>
+
+/* =================== TYPE DEFINITIONS ======================= */
+
+/** @brief Sink of formatted output, called with pieces of it. The context is
+ *      the one given to @ref print_vformat */
+typedef void (*Print_Sink)(void *, const char *, uint32_t);
 
 /* =================== FUNCTION DECLARATIONS ================== */
 
 void print(const char *msg);
 void print_hex(const char *msg, uint32_t value);
+void print_fmt(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+int print_vformat(Print_Sink sink, void *ctx, const char *fmt, va_list args);
+int print_format(char *buf, uint32_t size, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
 
 #endif /* __PRINT_H__ */
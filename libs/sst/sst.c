@@ -0,0 +1,122 @@
+/*
+ * @file sst.c
+ * @brief Implementation of the run-to-completion tasks
+ *
+ * The events of a task are kept in a ring; head and tail count the events
+ * posted and handled, and index the ring modulo its size. Posting may happen
+ * from any context, so the slot is claimed and written in a critical section.
+ * Only the task itself advances the tail, after reading the event, so it
+ * needs no critical section to handle events.
+ *
+ * All spare interrupts share one callback, which finds the task of the
+ * active interrupt from the list of started tasks.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include "system.h"
+#include "os.h"
+#include "sst.h"
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief Started tasks, the latest first */
+static sst_task_t *sst_tasks;
+
+/* ========================= FUNCTION DEFINITIONS ============== */
+
+/**
+ * @brief Spare interrupt callback, runs the task of the interrupt until its
+ *      queue is empty. Events posted meanwhile are handled in the same run
+ * @param[in] irqn  active spare interrupt
+ */
+static void sst_dispatch(uint32_t irqn)
+{
+    sst_task_t *task;
+    uint32_t tail;
+    uint32_t event;
+
+    for(task = sst_tasks; task && task->irqn != irqn; task = task->next) {;}
+    if(!task) {
+        return;
+    }
+
+    tail = task->tail;
+    while(tail != task->head) {
+        event = task->queue[tail % task->size];
+        task->tail = ++tail;
+        task->handler(event);
+    }
+}
+
+/**
+ * @brief Start a run-to-completion task, enabling its spare interrupt. Events
+ *      posted before are handled right away. Must be called once per task,
+ *      from a task or from main before the scheduler starts
+ * @param[in] task  task
+ *
+ * @return OS_OK, or OS_ERROR if the task or its interrupt is in use already,
+ *      or the interrupt is not spare or its priority is out of range
+ */
+int sst_start(sst_task_t *task)
+{
+    sst_task_t *other;
+    uint32_t state;
+
+    for(other = sst_tasks; other; other = other->next) {
+        if(other == task || other->irqn == task->irqn) {
+            return OS_ERROR;
+        }
+    }
+
+    if(SpareIRQ_init(task->irqn, task->prio, &sst_dispatch) != SYSTEM_OK) {
+        return OS_ERROR;
+    }
+
+    state = CriticalEnter();
+    task->next = sst_tasks;
+    sst_tasks = task;
+    task->started = 1;
+    CriticalExit(state);
+
+    if(task->head != task->tail) {
+        SpareIRQ_pend(task->irqn);
+    }
+
+    return OS_OK;
+}
+
+/**
+ * @brief Post an event to a run-to-completion task, activating it. The task
+ *      preempts the caller right away if of higher priority, otherwise it
+ *      runs once nothing of its priority or higher does. May be called from
+ *      tasks, interrupts, and run-to-completion tasks
+ * @param[in] task  task
+ * @param[in] event event, passed to the handler as is
+ *
+ * @return OS_OK, or OS_ERROR if the queue of the task is full
+ */
+int sst_post(sst_task_t *task, uint32_t event)
+{
+    uint32_t state;
+    uint32_t head;
+
+    state = CriticalEnter();
+    head = task->head;
+    if(head - task->tail >= task->size) {
+        task->lost++;
+        CriticalExit(state);
+        return OS_ERROR;
+    }
+    task->queue[head % task->size] = event;
+    task->head = head + 1;
+    CriticalExit(state);
+
+    if(task->started) {
+        SpareIRQ_pend(task->irqn);
+    }
+
+    return OS_OK;
+}
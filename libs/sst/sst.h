@@ -0,0 +1,100 @@
+/*
+ * @file sst.h
+ * @brief Run-to-completion tasks sharing one stack, in the style of the Super
+ *      Simple Tasker and the Stack Resource Policy
+ *
+ * A run-to-completion task is an event handler, declared statically with
+ * @ref OS_SST_TASK_DEFINE and started with @ref sst_start. Events posted to it
+ * with @ref sst_post are queued, and the task is activated by pending a spare
+ * interrupt at the priority of the task. The NVIC then preempts whatever runs
+ * at a lower priority, tasks and other run-to-completion tasks alike, and the
+ * handler is called for each queued event. A handler returns instead of
+ * blocking, so there is no context to save: activations nest on one stack
+ * shared by all run-to-completion tasks, and PendSV is not involved at all.
+ *
+ * Handlers run in interrupt context at their priority. They must not block,
+ * i.e. call sleep, yield, event_wait, or pool_alloc_wait, but may call the
+ * kernel functions allowed from interrupts, e.g. event_signal, pool_alloc, and
+ * sst_post. Data shared with tasks of other priorities is accessed in critical
+ * sections, which mask all run-to-completion tasks. Needs CONFIG_SST.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+#ifndef __SST_H__
+#define __SST_H__
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include "os.h"
+
+/* =================== MACRO DEFINITIONS ====================== */
+
+/**
+ * @brief Define a run-to-completion task
+ * @param name          name of the task
+ * @param fn            event handler, @ref sst_handler_t
+ * @param irq           number of the spare interrupt activating the task, one
+ *      without a handler of its own in the vector table, and unique per task
+ * @param priority      interrupt priority of the task, lower values preempt
+ *      higher ones. From the highest priority allowed to call the kernel down
+ *      to, but not including, PendSV's; 0x80 - 0xC0 on the Cortex-M33 port
+ * @param queue_len     number of events the task can have queued
+ */
+#define OS_SST_TASK_DEFINE(name, fn, irq, priority, queue_len)                  \
+_Static_assert((queue_len) > 0, "task " #name " needs room for an event");      \
+                                                                                \
+static uint32_t __sst_##name##_queue[(queue_len)];                              \
+                                                                                \
+sst_task_t name = {                                                             \
+    .handler = (fn),                                                            \
+    .irqn = (irq),                                                              \
+    .prio = (priority),                                                         \
+    .queue = __sst_##name##_queue,                                              \
+    .size = (queue_len),                                                        \
+}
+
+/* =================== TYPE DEFINITIONS ======================= */
+
+/** @brief Event handler of a run-to-completion task, called once per event */
+typedef void (*sst_handler_t)(uint32_t event);
+
+/** @brief A run-to-completion task. Define with @ref OS_SST_TASK_DEFINE */
+typedef struct Sst_Task {
+    /** @brief Event handler */
+    sst_handler_t handler;
+
+    /** @brief Spare interrupt activating the task */
+    uint32_t irqn;
+
+    /** @brief Interrupt priority of the task */
+    uint32_t prio;
+
+    /** @brief Queue of posted events */
+    uint32_t *queue;
+
+    /** @brief Number of events the queue has room for */
+    uint32_t size;
+
+    /** @brief Number of events posted, ever. Written in critical sections */
+    volatile uint32_t head;
+
+    /** @brief Number of events handled, ever. Written by the task only */
+    volatile uint32_t tail;
+
+    /** @brief Number of events not posted, as the queue was full */
+    volatile uint32_t lost;
+
+    /** @brief Set once started */
+    volatile uint32_t started;
+
+    /** @brief Next started task */
+    struct Sst_Task *next;
+} sst_task_t;
+
+/* =================== FUNCTION DECLARATIONS ================== */
+
+int sst_start(sst_task_t *task);
+int sst_post(sst_task_t *task, uint32_t event);
+
+#endif /* __SST_H__ */
@@ -12,6 +12,7 @@
 #include "system.h"
 #include "os.h"
 #include "print/print.h"
+#include "log/log.h"
 
 /* ========================= CONSTANTS ========================= */
 
@@ -68,10 +69,12 @@ void taskB(void* arg1, void* arg2, void* arg3)
     }
 }
 
-/** @brief Register the tasks with the OS */
+/** @brief Register the tasks with the OS. The logger task sends their output
+ *  to the UART when they are not running */
 OS_TASKS_INIT(
-    OS_TASK_DEFINE(taskA, 0, 0, 0, OS_LOWEST_PRIO + 1),
-    OS_TASK_DEFINE(taskB, 0, 0, 0, OS_LOWEST_PRIO + 1),
+    OS_TASK_DEFINE(taskA, 0, 0, 0, OS_LOWEST_PRIO + 2),
+    OS_TASK_DEFINE(taskB, 0, 0, 0, OS_LOWEST_PRIO + 2),
+    OS_TASK_DEFINE(log_task, 0, 0, 0, OS_LOWEST_PRIO + 1),
 );
 
 /**
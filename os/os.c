@@ -11,6 +11,7 @@
 #include "os.h"
 #include "system.h"
 #include "print/print.h"
+#include "atomic/atomic.h"
 
 /* =================== EXTERN DEFINITIONS ===================== */
 
@@ -31,20 +32,27 @@ extern uint8_t task_stacks[];
 
 /* =================== MACRO DEFINITIONS ====================== */
 
-#ifdef OS_DEBUG
+#ifdef CONFIG_TRACE
 #define DBG_PRINT(x) (print(x))
 #define DBG_PRINT_HEX(x, y) (print_hex(x, y))
 #else
 #define DBG_PRINT(x)
 #define DBG_PRINT_HEX(x, y) 
-#endif /* OS_DEBUG */
+#endif /* CONFIG_TRACE */
 
 /** @brief Number of task states in @ref task_state_e */
-#define NUM_TASK_STATES 5
+#define NUM_TASK_STATES 6
 
 /** @brief Special value indicating a thread is not actively sleeping */
 #define OS_NOSLEEP 0xFFFFFFFFFFFFFFFF
 
+/** @brief Wakeup time of a task waiting for an event without a timeout */
+#define OS_WAIT_NO_TIMEOUT (OS_NOSLEEP - 1)
+
+/** @brief Result of event_wait_start when the sequence number has changed, and
+ *      the task did not start waiting */
+#define EVENT_WAIT_SKIPPED 2
+
 /** @brief Convert task number to a bit in @ref task_state_list; MSB = task 0 */
 #define TASK_NUM_TO_BIT(x) (1 << (31UL - x))
 
@@ -53,8 +61,8 @@ extern uint8_t task_stacks[];
  */
 #define TASK_NUM_TO_INITIAL_SP(tasknum) (                                       \
     (tasknum == (__tasks_count - 1))                                            \
-    ? &task_stacks[((tasknum - 1) * TASK_STACK_SIZE) + IDLE_STACK_SIZE - 0x4UL] \
-    : &task_stacks[(tasknum * TASK_STACK_SIZE) - 0x4UL]                         \
+    ? &task_stacks[(tasknum * TASK_STACK_SIZE) + IDLE_STACK_SIZE - 0x4UL]       \
+    : &task_stacks[((tasknum + 1) * TASK_STACK_SIZE) - 0x4UL]                   \
 )
 
 
@@ -66,18 +74,45 @@ typedef enum Task_State {
     READY   = 1,    /** @brief Task is ready to be executed */
     PENDING = 2,    /** @brief Task is sleeping or pending other synchronization */
     RUNNING = 3,    /** @brief Task is executing */
-    EJECTED = 4     /** @brief Task has just been context switched out */
+    EJECTED = 4,    /** @brief Task has just been context switched out */
+    WOKEN   = 5     /** @brief Task was woken by an interrupt, made ready by the next PendSV */
 } task_state_e;
 
 
 /* =================== STATIC DATA =============================== */
 
-/** @brief An array of 32-bit numbers, where each bit represents a task in that state */
+/** @brief An array of 32-bit numbers, where each bit represents a task in that state.
+ *      Once the scheduler runs, the entries are only updated with the atomic bit
+ *      operations of libs/atomic, or by the context switch, which is not preempted
+ *      by the kernel. An exception entry clears the exclusive monitor, so an update
+ *      preempted by SysTick or the context switch is retried with their changes */
 volatile uint32_t task_state_list[NUM_TASK_STATES] = {0};
 
+/** @brief TCBs of the running and next task, switched by the context switch */
+task_switch_t task_switch;
+
 /* =================== FUNCTION DECLARATIONS ===================== */
 
 void schedule(void);
+static void schedule_woken(void);
+static uint32_t preempt_locked(void);
+static void yield_locked(void);
+static void retire_ejected(void);
+static uintptr_t sys_yield_call(uintptr_t a0, uintptr_t a1, uintptr_t a2);
+static uintptr_t sys_sleep_call(uintptr_t ms, uintptr_t a1, uintptr_t a2);
+static uintptr_t sys_event_wait_call(uintptr_t event, uintptr_t ms, uintptr_t a2);
+static uintptr_t sys_event_wait_end_call(uintptr_t event, uintptr_t a1, uintptr_t a2);
+static uintptr_t sys_event_signal_call(uintptr_t event, uintptr_t a1, uintptr_t a2);
+
+/** @brief Kernel functions by system call number, called by the system call
+ *      entry of the system driver in privileged mode */
+const os_syscall_t syscall_table[OS_SYSCALL_COUNT] = {
+    [OS_SYS_YIELD]          = &sys_yield_call,
+    [OS_SYS_SLEEP]          = &sys_sleep_call,
+    [OS_SYS_EVENT_WAIT]     = &sys_event_wait_call,
+    [OS_SYS_EVENT_WAIT_END] = &sys_event_wait_end_call,
+    [OS_SYS_EVENT_SIGNAL]   = &sys_event_signal_call,
+};
 
 /* ========================= FUNCTION DEFINITIONS ========================= */
 
@@ -90,13 +125,13 @@ void schedule(void);
 __attribute__((weak)) void idle_task(void* arg1, void* arg2, void* arg3)
 {
     while(1) {
-#ifdef OS_DEBUG
+#ifdef CONFIG_TRACE
         print(__func__);
         busysleep(10);
         yield();
 #else
-        asm("wfi");
-#endif /* OS_DEBUG */
+        WaitForInterrupt();
+#endif /* CONFIG_TRACE */
     }
 }
 
@@ -109,11 +144,6 @@ void scheduler_start(void)
 {
     uint32_t i;
 
-    if(__tasks_count > MAX_NUM_TASKS) {
-        print("ERROR: task count may never exceed MAX_NUM_TASKS");
-        return;
-    }
-
     DBG_PRINT("================ SCHEDULER START =================");
     DBG_PRINT_HEX(" == > Number of tasks : ", __tasks_count);
 
@@ -130,6 +160,7 @@ void scheduler_start(void)
             task_state_list[READY] |= TASK_NUM_TO_BIT(i);
         } else {
             task_state_list[RUNNING] |= TASK_NUM_TO_BIT(i);
+            task_switch.current_tcb = &__tasks[i];
         }
 
         /* Initialize the task stack */
@@ -137,15 +168,15 @@ void scheduler_start(void)
     }
 
 
-    /* Initialize the PendSV interrupt that will handle context switches */
-    PendSV_init();
+    /* Initialize the PendSV interrupt that will handle context switches, and wake
+        the tasks signalled from interrupts */
+    PendSV_init(&schedule_woken);
 
     /* Initialize the System Tick for keeping time, enabling sleep() */
     TICK_init(1, &schedule);
 
     /* Flush the cache after configuring the interrupts */
-    asm("dsb");
-    asm("isb");
+    SyncBarriers();
 
     DBG_PRINT("================= OS START =================="); 
 
@@ -158,27 +189,12 @@ void scheduler_start(void)
  */
 void schedule(void)
 {
-    uint32_t task, selected;
+    uint32_t task;
     uint32_t pending, original_pending;
-    uint32_t curr, cur_prio, candidates, next;
     uint64_t ticks;
 
     /* Check the previously running task */
-    if(task_state_list[EJECTED]) {
-        task = CountLeadingZeros(task_state_list[EJECTED]);
-        
-        /* Check if task wakeup time has been set */
-        if(__tasks[task].wakeup_time != OS_NOSLEEP) {
-            
-            /* Mark task PENDING if it is */
-            task_state_list[PENDING] |= task_state_list[EJECTED];
-        } else {
-
-            /* Mark task READY if it is not */
-            task_state_list[READY] |= task_state_list[EJECTED];
-        }
-        task_state_list[EJECTED] = 0;
-    }
+    retire_ejected();
 
     /* Exit early if nothing to do */
     if(!task_state_list[PENDING]) {
@@ -201,38 +217,145 @@ void schedule(void)
         if(ticks > __tasks[task].wakeup_time) {
             /* Clear wakeup time, mark task ready */
             __tasks[task].wakeup_time = OS_NOSLEEP;
-            task_state_list[PENDING] &= ~(TASK_NUM_TO_BIT(task));
-            task_state_list[READY] |= TASK_NUM_TO_BIT(task);
+            (void)atomic_clear(&task_state_list[PENDING], TASK_NUM_TO_BIT(task));
+            (void)atomic_or(&task_state_list[READY], TASK_NUM_TO_BIT(task));
         }
         /* Clear bit to not check this task again */
         pending &= ~(TASK_NUM_TO_BIT(task));
     } while(pending);
 
-    /* Check if a task was moved from PENDING to READY */
-    if(task_state_list[PENDING] != original_pending) {
-
-        /* Get parameters of the running task */
-        curr = CountLeadingZeros(task_state_list[RUNNING]);
-        selected = curr;
-        candidates = task_state_list[READY];
-        cur_prio = __tasks[curr].prio;
-
-        /* Check if there's a task with same or higher priority marked as ready */
-        do {
-            next = CountLeadingZeros(candidates);
-            if(__tasks[next].prio >= cur_prio) {
-                selected = next;
-                break;
+    /* Check if a task was moved from PENDING to READY, and whether it preempts */
+    if(task_state_list[PENDING] != original_pending && preempt_locked()) {
+        (void)PendSV_trigger();
+    }
+}
+
+/**
+ * @brief Wake the tasks signalled by @ref event_signal_from_isr since the last
+ *      call, and select one of them to run if it preempts. Called by the system
+ *      driver as PendSV is entered, before the context switch, when the WOKEN
+ *      entry is not empty. However many interrupts signalled meanwhile, the
+ *      scheduling decision is made here once
+ */
+static void schedule_woken(void)
+{
+    uint32_t task, taskbit;
+    uint32_t woken;
+    uint32_t moved = 0;
+    uint32_t state;
+
+    state = CriticalEnter();
+
+    /* A task switched out to wait is in PENDING from here on */
+    retire_ejected();
+
+    woken = atomic_xchg(&task_state_list[WOKEN], 0);
+    while(woken) {
+        task = CountLeadingZeros(woken);
+        taskbit = TASK_NUM_TO_BIT(task);
+
+        /* Tasks no longer waiting timed out meanwhile */
+        if(__tasks[task].wait_event && __tasks[task].wakeup_time != OS_NOSLEEP) {
+            if(task_state_list[PENDING] & taskbit) {
+                __tasks[task].wakeup_time = OS_NOSLEEP;
+                (void)atomic_clear(&task_state_list[PENDING], taskbit);
+                (void)atomic_or(&task_state_list[READY], taskbit);
+                moved = 1;
+            } else {
+                /* Timed out but not run yet, or still being switched out after starting
+                    to wait, the tick wakes it */
+                __tasks[task].wakeup_time = 0;
             }
-            candidates &= ~(TASK_NUM_TO_BIT(next));
-        } while(candidates);
-
-        /* If a new task was selected, mark it as NEXT and trigger a context switch */
-        if(selected != curr) {
-            task_state_list[NEXT] = TASK_NUM_TO_BIT(selected);
-            task_state_list[READY] &= ~(TASK_NUM_TO_BIT(selected));
-            (void)PendSV_trigger();
         }
+        woken &= ~taskbit;
+    }
+
+    /* The context switch follows right after, no trigger needed */
+    if(moved) {
+        (void)preempt_locked();
+    }
+
+    CriticalExit(state);
+}
+
+/**
+ * @brief Select a READY task to preempt the task about to run: the NEXT task
+ *      if one is selected already, otherwise the RUNNING one. The first READY
+ *      task with the same or higher priority preempts it, or with a higher
+ *      priority than its preemption threshold if it has one. A preempted NEXT
+ *      task is made READY again. Must be called with the scheduler not
+ *      preemptible, i.e. from SysTick, PendSV, or a critical section
+ *
+ * @return 1 if a new task was selected, and a context switch is needed, 0 if not
+ */
+static uint32_t preempt_locked(void)
+{
+    uint32_t curr, selected, next;
+    uint32_t cur_prio, candidates;
+    uint32_t previous;
+
+    candidates = task_state_list[READY];
+    if(!candidates) {
+        return 0;
+    }
+
+    /* Get parameters of the task about to run. With a preemption threshold, only
+        tasks above the threshold preempt it */
+    previous = task_state_list[NEXT];
+    curr = CountLeadingZeros(previous ? previous : task_state_list[RUNNING]);
+    selected = curr;
+    cur_prio = __tasks[curr].prio;
+    if(__tasks[curr].threshold && __tasks[curr].threshold >= cur_prio) {
+        cur_prio = __tasks[curr].threshold + 1;
+    }
+
+    /* Check if there's a task with same or higher priority marked as ready */
+    do {
+        next = CountLeadingZeros(candidates);
+        if(__tasks[next].prio >= cur_prio) {
+            selected = next;
+            break;
+        }
+        candidates &= ~(TASK_NUM_TO_BIT(next));
+    } while(candidates);
+
+    if(selected == curr) {
+        return 0;
+    }
+
+    /* Mark the new task as NEXT, the one it replaces as NEXT is ready to run later */
+    if(previous) {
+        (void)atomic_or(&task_state_list[READY], previous);
+    }
+    task_state_list[NEXT] = TASK_NUM_TO_BIT(selected);
+    task_switch.next_tcb = &__tasks[selected];
+    (void)atomic_clear(&task_state_list[READY], TASK_NUM_TO_BIT(selected));
+
+    return 1;
+}
+
+/**
+ * @brief Move the task switched out by the last context switch from the
+ *      EJECTED entry into the PENDING entry if it is waiting, or into the
+ *      READY entry. Both @ref schedule and @ref yield_locked call this; the
+ *      entry is taken with one exchange, so only one of them moves the task
+ */
+static void retire_ejected(void)
+{
+    uint32_t ejected;
+    uint32_t task;
+
+    ejected = atomic_xchg(&task_state_list[EJECTED], 0);
+    if(!ejected) {
+        return;
+    }
+    task = CountLeadingZeros(ejected);
+
+    /* Mark task PENDING if its wakeup time has been set, READY if not */
+    if(__tasks[task].wakeup_time != OS_NOSLEEP) {
+        (void)atomic_or(&task_state_list[PENDING], ejected);
+    } else {
+        (void)atomic_or(&task_state_list[READY], ejected);
     }
 }
 
@@ -243,6 +366,21 @@ void schedule(void)
  *      switch will be performed
  */
 void yield(void)
+{
+    uint32_t state;
+
+    /* Selecting the next task reads the READY entry, and publishes the selection in the
+        NEXT entry and the next TCB pointer; SysTick must not select another one meanwhile */
+    state = CriticalEnter();
+    yield_locked();
+    CriticalExit(state);
+}
+
+/** @brief Select the next task to be executed, see @ref yield. Must be called
+ *      in a critical section. A context switch requested here is performed
+ *      once the critical section is exited
+ */
+static void yield_locked(void)
 {
     uint32_t tasknum;
     uint32_t nexttask;
@@ -253,21 +391,7 @@ void yield(void)
     DBG_PRINT_HEX("----> yield from: ", CountLeadingZeros(task_state_list[RUNNING]));
 
     /* Clean up any previously switched out task */
-    if(task_state_list[EJECTED]) {
-        tasknum = CountLeadingZeros(task_state_list[EJECTED]);
-        
-        /* Check if task wakeup time has been set */
-        if(__tasks[tasknum].wakeup_time != OS_NOSLEEP) {
-            
-            /* Mark task PENDING if it is */
-            task_state_list[PENDING] |= task_state_list[EJECTED];
-        } else {
-
-            /* Mark task READY if it is not */
-            task_state_list[READY] |= task_state_list[EJECTED];
-        }
-        task_state_list[EJECTED] = 0;
-    }
+    retire_ejected();
 
     /* Get the list of tasks ready to be run */
     candidates = task_state_list[READY];
@@ -313,7 +437,8 @@ void yield(void)
 
     /* Mark the selected task as next */
     task_state_list[NEXT] = TASK_NUM_TO_BIT(nexttask);
-    task_state_list[READY] &= ~(TASK_NUM_TO_BIT(nexttask));
+    task_switch.next_tcb = &__tasks[nexttask];
+    (void)atomic_clear(&task_state_list[READY], TASK_NUM_TO_BIT(nexttask));
 
     /* Trigger PendSV to context switch */
     (void)PendSV_trigger();
@@ -326,15 +451,312 @@ void yield(void)
 void sleep(int ms)
 {
     uint32_t task;
+    uint32_t state;
     /* Get running task number */
     task = CountLeadingZeros(task_state_list[RUNNING]);
 
     DBG_PRINT_HEX("----> sleep from: ", CountLeadingZeros(task_state_list[RUNNING]));
 
-    /* Mark the wakeup time */
+    /* Mark the wakeup time, and switch to the next task. SysTick must not
+        see a half-written wakeup time */
+    state = CriticalEnter();
     __tasks[task].wakeup_time = TICK_get() + (uint64_t)ms;
-    
-    /* Call yield to switch to the next task */
+    yield_locked();
+    CriticalExit(state);
+}
+
+
+/**
+ * @brief Start waiting for an event, see @ref event_wait. Switches to the next
+ *      task once the critical section is exited, or the system call returns
+ * @param[in] event     event to wait for
+ * @param[in] seq       sequence number to compare before waiting, 0 if none
+ * @param[in] seen      value of the sequence number the caller last saw
+ * @param[in] ms        timeout in milliseconds, or OS_WAIT_FOREVER
+ *
+ * @return OS_OK, EVENT_WAIT_SKIPPED if the sequence number has changed, or
+ *      OS_ERROR if the scheduler is not running
+ */
+static int event_wait_start(os_event_t *event, const volatile uint32_t *seq, uint32_t seen, int ms)
+{
+    uint32_t task;
+    uint32_t state;
+
+    /* Nothing to switch to before the scheduler is started */
+    if(!task_state_list[RUNNING]) {
+        return OS_ERROR;
+    }
+
+    task = CountLeadingZeros(task_state_list[RUNNING]);
+
+    /* A change made before this was signalled before the task is marked waiting, so the
+        signal would be lost. Changes made after it are signalled to the waiting task */
+    state = CriticalEnter();
+    if(seq && *seq != seen) {
+        CriticalExit(state);
+        return EVENT_WAIT_SKIPPED;
+    }
+
+    /* Mark the wakeup time first, a signal may arrive as soon as the task is marked waiting */
+    if(ms < 0) {
+        __tasks[task].wakeup_time = OS_WAIT_NO_TIMEOUT;
+    } else {
+        __tasks[task].wakeup_time = TICK_get() + (uint64_t)ms;
+    }
+    __tasks[task].wait_event = event;
+    (void)atomic_or(event, TASK_NUM_TO_BIT(task));
+
+    /* Switch to the next task, the scheduler wakes this one on signal or timeout */
+    yield_locked();
+    CriticalExit(state);
+
+    return OS_OK;
+}
+
+/**
+ * @brief Finish waiting for an event, once the task runs again after
+ *      @ref event_wait_start
+ * @param[in] event     event waited for
+ *
+ * @return OS_OK when signalled, OS_TIMEOUT on timeout
+ */
+static int event_wait_end(os_event_t *event)
+{
+    uint32_t task;
+    uint32_t taskbit;
+    uint32_t waiting;
+    uint32_t state;
+
+    task = CountLeadingZeros(task_state_list[RUNNING]);
+    taskbit = TASK_NUM_TO_BIT(task);
+
+    /* The signal clears the task bit. If it is still set, the wait timed out. A signal
+        handled after this finds the task no longer waiting, and leaves it alone */
+    state = CriticalEnter();
+    waiting = atomic_clear(event, taskbit);
+    __tasks[task].wait_event = 0;
+    __tasks[task].wakeup_time = OS_NOSLEEP;
+    CriticalExit(state);
+
+    return (waiting & taskbit) ? OS_TIMEOUT : OS_OK;
+}
+
+/**
+ * @brief Wait for an event to be signalled, yielding the current task
+ * @param[in] event     event to wait for
+ * @param[in] ms        timeout in milliseconds, or OS_WAIT_FOREVER
+ *
+ * @return OS_OK when signalled, OS_TIMEOUT on timeout,
+ *      OS_ERROR if the scheduler is not running
+ */
+int event_wait(os_event_t *event, int ms)
+{
+    if(event_wait_start(event, 0, 0, ms) != OS_OK) {
+        return OS_ERROR;
+    }
+
+    return event_wait_end(event);
+}
+
+/**
+ * @brief Wait for an event to be signalled, unless a sequence number has
+ *      changed since the caller last saw it. The number is compared as the
+ *      task starts waiting, so that a change signalled just before is not
+ *      missed. Whoever signals the event must change the number first, e.g.
+ *      count the updates of the condition waited for. Read the number before
+ *      checking the condition, and wait if the condition does not hold
+ * @param[in] event     event to wait for
+ * @param[in] seq       sequence number
+ * @param[in] seen      value read before checking the condition
+ * @param[in] ms        timeout in milliseconds, or OS_WAIT_FOREVER
+ *
+ * @return OS_OK when signalled or if the number has changed, OS_TIMEOUT on
+ *      timeout, OS_ERROR if the scheduler is not running
+ */
+int event_wait_seq(os_event_t *event, const volatile uint32_t *seq, uint32_t seen, int ms)
+{
+    int ret;
+
+    ret = event_wait_start(event, seq, seen, ms);
+    if(ret == EVENT_WAIT_SKIPPED) {
+        return OS_OK;
+    }
+    if(ret != OS_OK) {
+        return OS_ERROR;
+    }
+
+    return event_wait_end(event);
+}
+
+/**
+ * @brief Signal an event, waking all tasks waiting for it. From a task, the
+ *      tasks are made ready on the next system tick. From an interrupt, this
+ *      is @ref event_signal_from_isr, making them ready right away
+ * @param[in] event     event to signal
+ */
+void event_signal(os_event_t *event)
+{
+    uint32_t task;
+    uint32_t waiting;
+    uint32_t state;
+
+    /* Interrupts wake the tasks through PendSV, as a task made ready on the next tick would
+        wait up to a tick for the data an interrupt handed it */
+    if(IRQ_active()) {
+        event_signal_from_isr(event);
+        return;
+    }
+
+    /* Take all waiting tasks at once, tasks starting to wait after this wait for the next
+        signal. In the same critical section as the wakeup times are set, so that a task
+        cannot time out, finish waiting, and sleep or wait again in between */
+    state = CriticalEnter();
+    waiting = atomic_xchg(event, 0);
+
+    /* Set the wakeup time of each task still waiting for this event to the past, for the
+        scheduler to wake them */
+    while(waiting) {
+        task = CountLeadingZeros(waiting);
+        if(__tasks[task].wait_event == event && __tasks[task].wakeup_time != OS_NOSLEEP) {
+            __tasks[task].wakeup_time = 0;
+        }
+        waiting &= ~(TASK_NUM_TO_BIT(task));
+    }
+    CriticalExit(state);
+}
+
+/**
+ * @brief Signal an event from an interrupt, waking all tasks waiting for it.
+ *      Only marks the tasks woken and triggers PendSV, which makes them ready
+ *      and decides whether one preempts, as it is entered. Signals from
+ *      several interrupts before PendSV runs are handled in one pass. Bounded
+ *      in time by the number of tasks. Must be called from interrupts at the
+ *      kernel's priority or lower only
+ * @param[in] event     event to signal
+ */
+void event_signal_from_isr(os_event_t *event)
+{
+    uint32_t task;
+    uint32_t waiting;
+    uint32_t woken = 0;
+    uint32_t state;
+
+    /* Take all waiting tasks at once, tasks starting to wait after this wait for the next
+        signal. Keep only the tasks still waiting for this event, a task that timed out and
+        went back to sleep or waits for another event keeps its bit in the event until then */
+    state = CriticalEnter();
+    waiting = atomic_xchg(event, 0);
+    while(waiting) {
+        task = CountLeadingZeros(waiting);
+        if(__tasks[task].wait_event == event) {
+            woken |= TASK_NUM_TO_BIT(task);
+        }
+        waiting &= ~(TASK_NUM_TO_BIT(task));
+    }
+
+    if(woken) {
+        (void)atomic_or(&task_state_list[WOKEN], woken);
+        (void)PendSV_trigger();
+    }
+    CriticalExit(state);
+}
+
+/** @brief System call of @ref yield */
+static uintptr_t sys_yield_call(uintptr_t a0, uintptr_t a1, uintptr_t a2)
+{
     yield();
+    return OS_OK;
 }
 
+/** @brief System call of @ref sleep */
+static uintptr_t sys_sleep_call(uintptr_t ms, uintptr_t a1, uintptr_t a2)
+{
+    sleep((int)ms);
+    return OS_OK;
+}
+
+/** @brief System call starting @ref event_wait */
+static uintptr_t sys_event_wait_call(uintptr_t event, uintptr_t ms, uintptr_t a2)
+{
+    return (uintptr_t)event_wait_start((os_event_t *)event, 0, 0, (int)ms);
+}
+
+/** @brief System call finishing @ref event_wait */
+static uintptr_t sys_event_wait_end_call(uintptr_t event, uintptr_t a1, uintptr_t a2)
+{
+    return (uintptr_t)event_wait_end((os_event_t *)event);
+}
+
+/** @brief System call of @ref event_signal */
+static uintptr_t sys_event_signal_call(uintptr_t event, uintptr_t a1, uintptr_t a2)
+{
+    event_signal((os_event_t *)event);
+    return OS_OK;
+}
+
+/**
+ * @brief @ref yield through a system call, for unprivileged tasks
+ */
+void sys_yield(void)
+{
+    (void)Syscall(OS_SYS_YIELD, 0, 0, 0);
+}
+
+/**
+ * @brief @ref sleep through a system call, for unprivileged tasks
+ * @param[in] ms    sleep interval in milliseconds
+ */
+void sys_sleep(int ms)
+{
+    (void)Syscall(OS_SYS_SLEEP, (uintptr_t)ms, 0, 0);
+}
+
+/**
+ * @brief @ref event_wait through system calls, for unprivileged tasks. The
+ *      task switches out between starting and finishing the wait
+ * @param[in] event     event to wait for
+ * @param[in] ms        timeout in milliseconds, or OS_WAIT_FOREVER
+ *
+ * @return OS_OK when signalled, OS_TIMEOUT on timeout,
+ *      OS_ERROR if the scheduler is not running
+ */
+int sys_event_wait(os_event_t *event, int ms)
+{
+    if((int)Syscall(OS_SYS_EVENT_WAIT, (uintptr_t)event, (uintptr_t)ms, 0) != OS_OK) {
+        return OS_ERROR;
+    }
+
+    return (int)Syscall(OS_SYS_EVENT_WAIT_END, (uintptr_t)event, 0, 0);
+}
+
+/**
+ * @brief @ref event_signal through a system call, for unprivileged tasks
+ * @param[in] event     event to signal
+ */
+void sys_event_signal(os_event_t *event)
+{
+    (void)Syscall(OS_SYS_EVENT_SIGNAL, (uintptr_t)event, 0, 0);
+}
+
+/**
+ * @brief Enter a critical section, in which no interrupt calling the kernel,
+ *      nor a context switch, can happen. Interrupts of higher priority than
+ *      the kernel's are not masked; they must not call kernel functions.
+ *      Critical sections may nest. Privileged code only: unprivileged tasks
+ *      cannot mask interrupts, and get no critical section from this
+ *
+ * @return state to pass to the matching @ref critical_exit
+ */
+uint32_t critical_enter(void)
+{
+    return CriticalEnter();
+}
+
+/**
+ * @brief Exit a critical section. A context switch requested meanwhile is performed now
+ * @param[in] state     state returned by the matching @ref critical_enter
+ */
+void critical_exit(uint32_t state)
+{
+    CriticalExit(state);
+}
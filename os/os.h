@@ -10,6 +10,7 @@
 
 /* =================== INCLUDES =============================== */
 #include <stdint.h>
+#include "os_config.h"
 
 /* =================== MACRO DEFINITIONS ====================== */
 
@@ -17,19 +18,48 @@
  * actual tasks should define a value OS_LOWEST_PRIO + N */
 #define OS_LOWEST_PRIO  0
 
-/** @brief The size of the stack allocated for each task. Override to adjust */
+/** @brief The size of the stack allocated for each task, CONFIG_TASK_STACK_SIZE.
+ *      The host port overrides it, as its stacks must fit signal frames */
 #ifndef TASK_STACK_SIZE
-#define TASK_STACK_SIZE 0x400UL
+#define TASK_STACK_SIZE CONFIG_TASK_STACK_SIZE
 #endif
 
 #ifndef IDLE_STACK_SIZE
-#define IDLE_STACK_SIZE 0x100UL
+#define IDLE_STACK_SIZE CONFIG_IDLE_STACK_SIZE
 #endif
 
-/** @brief Enable logging */
-// #define OS_DEBUG
+/** @brief Largest number of tasks, including the idle task. The task stack area
+ *      of the linker script is sized for it, and defining more fails to compile */
+#define MAX_NUM_TASKS CONFIG_MAX_TASKS
 
-#define MAX_NUM_TASKS 32
+/** @brief Timeout for @ref event_wait to wait without a timeout */
+#define OS_WAIT_FOREVER -1
+
+/** @brief Number of memory regions a task may declare in @ref OS_TASK_DEFINE,
+ *      besides its stack */
+#define OS_TASK_REGIONS     2
+
+/** @brief Number of memory protection registers kept per task, see task_t */
+#define OS_TASK_MPU_REGS    (2 * (OS_TASK_REGIONS + 2))
+
+/** @brief Access to a task's memory region, see @ref OS_REGION */
+#define OS_REGION_RW        0x0U    /* read and write */
+#define OS_REGION_RO        0x1U    /* read only */
+#define OS_REGION_DEVICE    0x2U    /* peripheral registers, accessed in order and uncached */
+
+/** @brief System call numbers, indexes into syscall_table of the kernel. Plain
+ *      numbers, as they are used in assembly */
+#define OS_SYS_YIELD            0
+#define OS_SYS_SLEEP            1
+#define OS_SYS_EVENT_WAIT       2
+#define OS_SYS_EVENT_WAIT_END   3
+#define OS_SYS_EVENT_SIGNAL     4
+#define OS_SYSCALL_COUNT        5
+
+/** @brief Return values of @ref event_wait */
+#define OS_OK       0
+#define OS_TIMEOUT  1
+#define OS_ERROR    -1
 
 /* =================== TYPE DEFINITIONS ========================== */
 
@@ -37,12 +67,37 @@
 /** @brief Task entrypoint function template */
 typedef void (*TaskEntry_Handler)(void*, void*, void*);
 
+/** @brief A memory region a task may access, declared with @ref OS_REGION */
+typedef struct Os_Region {
+    /** @brief Start of the region */
+    void *start;
+
+    /** @brief Size of the region in bytes, 0 for no region */
+    uint32_t size;
+
+    /** @brief Access to the region, OS_REGION_* flags */
+    uint32_t flags;
+} os_region_t;
+
+/** @brief An event tasks can wait for, and tasks or interrupts can signal.
+ *      Each bit represents a waiting task, as in the task state list. Initialize to 0 */
+typedef volatile uint32_t os_event_t;
+
 /** @brief The task data structure, representing one task and it's context */
 typedef struct Task_t {
     
     /** @brief Stack pointer to allow context switch */
     uint32_t *sp;           
     
+    /** @brief Memory protection registers of the task's stack and regions,
+     *      set up by the system driver and loaded on context switch. Must
+     *      follow the stack pointer, the context switch finds it there */
+    uint32_t mpu_regs[OS_TASK_MPU_REGS];
+
+    /** @brief 1 if the task runs unprivileged, see @ref OS_USER_TASK_DEFINE.
+     *      Must follow the MPU registers, the context switch finds it there */
+    uint32_t unprivileged;
+
 
     /** @brief First argument for task entrypoint */
     void* arg1;
@@ -61,19 +116,60 @@ typedef struct Task_t {
     /** @brief Task priority. Higher number is higher priority */
     const uint32_t prio;
 
+    /** @brief Preemption threshold; while running, the task is only preempted by
+     *      tasks of higher priority than this. 0 for none, preempted by tasks of
+     *      the same or higher priority. See @ref OS_THRESHOLD_TASK_DEFINE */
+    const uint32_t threshold;
+
     /** @brief Task stack size */
     const uint32_t stack_sz;
 
     /** @brief Point in time when task should be awoken */
     uint64_t wakeup_time;
+
+    /** @brief Event the task is waiting for in @ref event_wait, 0 if none.
+     *      Written in critical sections, a signal wakes the task only if set */
+    os_event_t *wait_event;
+
+    /** @brief Memory regions the task may access, besides its stack */
+    const os_region_t regions[OS_TASK_REGIONS];
 } task_t;
 
+/** @brief Kernel function called by a system call, with the arguments of the
+ *      call. See @ref OS_SYSCALL_COUNT */
+typedef uintptr_t (*os_syscall_t)(uintptr_t, uintptr_t, uintptr_t);
+
+/** @brief The TCBs of the running task, and of the task selected to run next.
+ *      Kept by the kernel, so that the context switch can load them directly */
+typedef struct Task_Switch {
+    /** @brief TCB of the running task */
+    task_t * volatile current_tcb;
+
+    /** @brief TCB of the task selected to run next, valid while the NEXT state is set */
+    task_t * volatile next_tcb;
+} task_switch_t;
+
 /* =================== EXTERN DEFINITIONS ======================== */
 
 __attribute__((weak)) void idle_task(void*, void*, void*);
 
 /* =================== HELPER MACROS ============================= */
 
+/**
+ * @brief Declare a memory region a task may access, for @ref OS_TASK_DEFINE.
+ *      The MPU of the Cortex-M33 needs the start and size to be multiples of
+ *      32 bytes; the start is rounded down and the end up otherwise
+ * @param addr      start of the region
+ * @param bytes     size of the region in bytes
+ * @param access    OS_REGION_* flags
+ */
+#define OS_REGION(addr, bytes, access)                          \
+{                                                               \
+    .start = (void *)(addr),                                    \
+    .size = (bytes),                                            \
+    .flags = (access)                                           \
+}
+
 /** 
  * @brief Define a task to be run by the OS. 
  * @param entry     task entry function
@@ -81,15 +177,58 @@ __attribute__((weak)) void idle_task(void*, void*, void*);
  * @param a2        task entry function 2nd argument
  * @param a3        task entry function 3rd argument
  * @param prio      task priority
+ * @param ...       up to @ref OS_TASK_REGIONS memory regions the task may
+ *                  access besides its stack, see @ref OS_REGION
+ */
+#define OS_TASK_DEFINE(entry, a1, a2, a3, priority, ...)        \
+{                                                               \
+    .fn = entry,                                                \
+    .arg1 = a1,                                                 \
+    .arg2 = a2,                                                 \
+    .arg3 = a3,                                                 \
+    .prio = priority,                                           \
+    .stack_sz = TASK_STACK_SIZE,                                \
+    .regions = { __VA_ARGS__ }                                  \
+}
+
+/**
+ * @brief Define a task with a preemption threshold. Tasks of priority up to
+ *      the threshold do not preempt the task once it runs, but wait until it
+ *      yields, sleeps, or waits for an event, saving the context switches of
+ *      tasks preempting each other. Waking tasks above the threshold preempt
+ *      it as usual. Other parameters as in @ref OS_TASK_DEFINE
+ * @param limit     preemption threshold, at least the priority
  */
-#define OS_TASK_DEFINE(entry, a1, a2, a3, priority)             \
+#define OS_THRESHOLD_TASK_DEFINE(entry, a1, a2, a3, priority, limit, ...) \
 {                                                               \
     .fn = entry,                                                \
     .arg1 = a1,                                                 \
     .arg2 = a2,                                                 \
     .arg3 = a3,                                                 \
     .prio = priority,                                           \
-    .stack_sz = TASK_STACK_SIZE                                 \
+    .threshold = limit,                                         \
+    .stack_sz = TASK_STACK_SIZE,                                \
+    .regions = { __VA_ARGS__ }                                  \
+}
+
+/**
+ * @brief Define a task to be run unprivileged. It can only access its stack,
+ *      its regions, and code and constants (without CONFIG_MPU, it still
+ *      cannot mask interrupts, but may access all memory), and calls the
+ *      kernel with the sys_* functions. Parameters as in @ref OS_TASK_DEFINE.
+ *      The first task is always run privileged, as it is started on the boot
+ *      stack
+ */
+#define OS_USER_TASK_DEFINE(entry, a1, a2, a3, priority, ...)   \
+{                                                               \
+    .fn = entry,                                                \
+    .arg1 = a1,                                                 \
+    .arg2 = a2,                                                 \
+    .arg3 = a3,                                                 \
+    .prio = priority,                                           \
+    .stack_sz = TASK_STACK_SIZE,                                \
+    .unprivileged = 1,                                          \
+    .regions = { __VA_ARGS__ }                                  \
 }
 
 /** @brief Define the OS idle task */
@@ -103,19 +242,23 @@ __attribute__((weak)) void idle_task(void*, void*, void*);
     .stack_sz = IDLE_STACK_SIZE,                                \
 }
 
-/** @brief Define the tasks to be run by OS. Initialize with @ref OS_TASK_DEFINE */
+/** @brief Define the tasks to be run by OS. Initialize with @ref OS_TASK_DEFINE.
+ *      The stacks are aligned for the MPU regions covering them */
 #define OS_TASKS_INIT(...)                                      \
 task_t __tasks[] = {                                            \
     __VA_ARGS__                                                 \
     OS_IDLE_TASK_DEFINE                                         \
 };                                                              \
                                                                 \
+_Static_assert(sizeof(__tasks) / sizeof(task_t) <= MAX_NUM_TASKS, \
+    "more tasks than CONFIG_MAX_TASKS");                        \
+                                                                \
 const uint32_t __tasks_count = (                                \
     sizeof(__tasks) /                                           \
     sizeof(task_t)                                              \
 );                                                              \
                                                                 \
-uint8_t __attribute__(( section(".task_stacks") )) task_stacks[ \
+uint8_t __attribute__(( section(".task_stacks"), aligned(32) )) task_stacks[ \
     ((sizeof(__tasks) / sizeof(task_t) - 1) * TASK_STACK_SIZE)  \
     + IDLE_STACK_SIZE                                           \
 ];
@@ -126,6 +269,16 @@ uint8_t __attribute__(( section(".task_stacks") )) task_stacks[ \
 void scheduler_start(void);
 void yield(void);
 void sleep(int ms);
+int event_wait(os_event_t *event, int ms);
+int event_wait_seq(os_event_t *event, const volatile uint32_t *seq, uint32_t seen, int ms);
+void event_signal(os_event_t *event);
+void event_signal_from_isr(os_event_t *event);
+void sys_yield(void);
+void sys_sleep(int ms);
+int sys_event_wait(os_event_t *event, int ms);
+void sys_event_signal(os_event_t *event);
+uint32_t critical_enter(void);
+void critical_exit(uint32_t state);
 
 
 #endif /* __KANTO_OS_H__ */
\ No newline at end of file
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+
+# @file bench.py
+# @brief Script to run the kernel benchmark and collect its results
+#
+# Runs the given command (QEMU, or the host build), reads the benchmark
+# results from its output, and stops it once they are all in. The results
+# can be saved, and compared against earlier saved results to catch
+# regressions, or checked against fixed cycle budgets. Results from hardware
+# can be read from a captured UART log.
+#
+# Copyright (c) 2025 Miikka Lukumies
+
+import argparse
+import json
+import re
+import subprocess
+import sys
+import threading
+
+RESULT_LINE = re.compile(r"^BENCH (\w+) (\w+)=0x([0-9A-Fa-f]+)\s*$")
+
+
+def collect(lines):
+    """Collect results from benchmark output lines, up to 'BENCH end'"""
+    results = {}
+    for line in lines:
+        line = line.strip()
+        if line == "BENCH end":
+            return results
+        match = RESULT_LINE.match(line)
+        if match:
+            name, stat, value = match.groups()
+            results.setdefault(name, {})[stat] = int(value, 16)
+    raise RuntimeError("benchmark output ended before 'BENCH end'")
+
+
+def run(command, timeout):
+    """Run the benchmark command, and collect its results"""
+    proc = subprocess.Popen(command, stdin=subprocess.DEVNULL, stdout=subprocess.PIPE,
+                            text=True, errors="replace")
+    # The benchmark never exits by itself, stop it if the results do not arrive in time
+    watchdog = threading.Timer(timeout, proc.kill)
+    watchdog.start()
+    try:
+        return collect(iter(proc.stdout.readline, ""))
+    finally:
+        watchdog.cancel()
+        proc.kill()
+        proc.wait()
+
+
+def compare(results, baseline, tolerance):
+    """Compare the averages against a baseline, return names of regressed results"""
+    regressions = []
+    for name, stats in sorted(results.items()):
+        old = baseline.get(name, {}).get("avg")
+        new = stats.get("avg")
+        if old is None or new is None:
+            continue
+        change = 100.0 * (new - old) / old if old else 0.0
+        flag = ""
+        if change > tolerance:
+            regressions.append(name)
+            flag = "  REGRESSION"
+        print(f"{name:28} {old:10} -> {new:10} ({change:+.1f}%){flag}")
+    return regressions
+
+
+def check_budgets(results, budgets):
+    """Check the averages against budgets given as name=cycles, return names over budget"""
+    over = []
+    for budget in budgets:
+        name, _, limit = budget.partition("=")
+        avg = results.get(name, {}).get("avg")
+        if avg is None:
+            print(f"{name:28} no result")
+            over.append(name)
+            continue
+        flag = "" if avg <= int(limit, 0) else "  OVER BUDGET"
+        if flag:
+            over.append(name)
+        print(f"{name:28} {avg:10} <= {int(limit, 0):10}{flag}")
+    return over
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run the KantOS kernel benchmark")
+    parser.add_argument("--log", help="read results from a captured log instead of running a command")
+    parser.add_argument("--save", help="save the results as JSON")
+    parser.add_argument("--baseline", help="compare against results saved earlier")
+    parser.add_argument("--tolerance", type=float, default=10.0,
+                        help="allowed increase of averages in percent (default: 10)")
+    parser.add_argument("--budget", action="append", default=[], metavar="NAME=CYCLES",
+                        help="fail if the average of a result exceeds the budget, may be repeated")
+    parser.add_argument("--timeout", type=float, default=60.0)
+    parser.add_argument("command", nargs="*", help="command running the benchmark")
+    args = parser.parse_args()
+
+    if args.log:
+        with open(args.log, errors="replace") as log:
+            results = collect(log)
+    elif args.command:
+        results = run(args.command, args.timeout)
+    else:
+        parser.error("give either a command or --log")
+
+    for name, stats in sorted(results.items()):
+        print(name, " ".join(f"{stat}={value}" for stat, value in stats.items()))
+
+    if args.save:
+        with open(args.save, "w") as out:
+            json.dump(results, out, indent=2, sort_keys=True)
+
+    failed = False
+    if args.baseline:
+        with open(args.baseline) as base:
+            failed |= bool(compare(results, json.load(base), args.tolerance))
+
+    if args.budget:
+        failed |= bool(check_budgets(results, args.budget))
+
+    if failed:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,293 @@
+#!/usr/bin/env python3
+
+# @file genconfig.py
+# @brief Script to generate the kernel configuration
+#
+# Reads the options declared in Kconfig, and their values from a configuration
+# file and the command line, and writes them out as a C header, a linker script
+# fragment, and a makefile fragment. Enabled bool options are defined as 1 in
+# the header and disabled ones are left undefined, so that code behind them
+# compiles out. Numbers are plain constants in all three.
+#
+# Only the part of the Kconfig language the kernel uses is understood: menus,
+# and bool, int and hex options with a prompt, defaults, ranges and help.
+# Defaults and ranges may depend on a bool option with 'if OPTION', the first
+# one whose condition holds applies.
+# Outputs are only rewritten when they change, so that make rebuilds only what
+# a change of configuration affects.
+#
+# Copyright (c) 2025 Miikka Lukumies
+
+import argparse
+import os
+import re
+import sys
+
+PREFIX = "CONFIG_"
+
+CONFIG_LINE = re.compile(r"^(\w+)=(.*)$")
+NOT_SET_LINE = re.compile(r"^# (\w+) is not set$")
+TYPE_LINE = re.compile(r'^(bool|int|hex)(?:\s+"[^"]*")?$')
+DEFAULT_LINE = re.compile(r"^default\s+(\S+)(?:\s+if\s+(\w+))?$")
+RANGE_LINE = re.compile(r"^range\s+(\S+)\s+(\S+)(?:\s+if\s+(\w+))?$")
+
+# Options whose values must be multiples of a size, which Kconfig cannot declare.
+# The task stacks are covered by MPU regions, which start and end on 32 bytes
+ALIGNMENT = {
+    "TASK_STACK_SIZE": 32,
+    "IDLE_STACK_SIZE": 32,
+}
+
+
+class Option:
+    """An option declared in Kconfig"""
+
+    def __init__(self, name, where):
+        self.name = name
+        self.where = where
+        self.type = None
+        self.defaults = []
+        self.ranges = []
+        self.value = None
+        self.set_where = None
+
+
+def fail(where, message):
+    """Report an error in a configuration, and exit"""
+    print(f"{where}: {message}", file=sys.stderr)
+    sys.exit(1)
+
+
+def parse_kconfig(path):
+    """Return the options declared in a Kconfig file, in order"""
+    options = {}
+    option = None
+    in_help = False
+
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            where = f"{path}:{number}"
+            stripped = line.strip()
+
+            # Help text is the indented block after 'help'
+            if in_help:
+                if not stripped or line[0] in " \t":
+                    continue
+                in_help = False
+
+            if not stripped or stripped.startswith("#"):
+                continue
+
+            words = stripped.split(None, 1)
+            if words[0] == "config" and len(words) == 2:
+                if words[1] in options:
+                    fail(where, f"{words[1]} declared twice")
+                option = Option(words[1], where)
+                options[option.name] = option
+            elif words[0] in ("menu", "endmenu"):
+                option = None
+            elif option is None:
+                fail(where, f"unexpected '{stripped}'")
+            elif TYPE_LINE.match(stripped):
+                option.type = words[0]
+            elif DEFAULT_LINE.match(stripped):
+                option.defaults.append(DEFAULT_LINE.match(stripped).groups())
+            elif RANGE_LINE.match(stripped):
+                option.ranges.append(RANGE_LINE.match(stripped).groups())
+            elif words[0] == "help":
+                in_help = True
+            else:
+                fail(where, f"unexpected '{stripped}'")
+
+    for option in options.values():
+        if option.type is None or not option.defaults:
+            fail(option.where, f"{option.name} needs a type and a default")
+        option.defaults = [(parse_value(option, text, option.where), check_condition(options, option, cond))
+                           for text, cond in option.defaults]
+        option.ranges = [(parse_value(option, low, option.where), parse_value(option, high, option.where),
+                          check_condition(options, option, cond)) for low, high, cond in option.ranges]
+
+    return options
+
+
+def check_condition(options, option, cond):
+    """Return the condition of a default or range, which must name a bool option"""
+    if cond is not None and (cond not in options or options[cond].type != "bool"):
+        fail(option.where, f"{option.name} depends on '{cond}', which is not a bool option")
+    return cond
+
+
+def resolve(options, option, seen=()):
+    """Return the value of an option, its first default whose condition holds if not set"""
+    if option.value is None:
+        if option.name in seen:
+            fail(option.where, f"{option.name} depends on itself")
+        for value, cond in option.defaults:
+            if cond is None or resolve(options, options[cond], seen + (option.name,)):
+                option.value = value
+                break
+        else:
+            fail(option.where, f"no default of {option.name} applies")
+    return option.value
+
+
+def check_range(options, option):
+    """Check an option against its first range whose condition holds"""
+    for low, high, cond in option.ranges:
+        if cond is None or options[cond].value:
+            if not low <= option.value <= high:
+                name = PREFIX + option.name
+                text = format_value(option, option.value)
+                where = option.set_where or option.where
+                fail(where, f"{name}={text} is out of range {format_value(option, low)}"
+                            f" - {format_value(option, high)}"
+                            + (f" with {PREFIX}{cond}" if cond else ""))
+            return
+
+
+def check_alignment(option):
+    """Check that an option is a multiple of its size in ALIGNMENT, if it has one"""
+    size = ALIGNMENT.get(option.name)
+    if size and option.value % size:
+        fail(option.set_where or option.where,
+             f"{PREFIX}{option.name}={format_value(option, option.value)} is not a multiple of {size}")
+
+
+def parse_value(option, text, where):
+    """Return the value of an option from text, True or False for bool options"""
+    text = text.strip()
+    if option.type == "bool":
+        if text not in ("y", "n"):
+            fail(where, f"{PREFIX}{option.name} must be y or n, not '{text}'")
+        return text == "y"
+    try:
+        return int(text, 16 if option.type == "hex" else 10)
+    except ValueError:
+        fail(where, f"{PREFIX}{option.name} must be a {option.type} number, not '{text}'")
+
+
+def set_value(options, name, text, where):
+    """Set an option by its name with the CONFIG_ prefix"""
+    if not name.startswith(PREFIX) or name[len(PREFIX):] not in options:
+        fail(where, f"unknown option {name}")
+    option = options[name[len(PREFIX):]]
+    option.value = parse_value(option, text, where)
+    option.set_where = where
+
+
+def read_config(path, options):
+    """Set options from a configuration file of CONFIG_NAME=value lines"""
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            where = f"{path}:{number}"
+            line = line.strip()
+            not_set = NOT_SET_LINE.match(line)
+            if not_set:
+                set_value(options, not_set.group(1), "n", where)
+                continue
+            if not line or line.startswith("#"):
+                continue
+            match = CONFIG_LINE.match(line)
+            if not match:
+                fail(where, f"expected CONFIG_NAME=value, not '{line}'")
+            set_value(options, match.group(1), match.group(2), where)
+
+
+def format_value(option, value):
+    """Return a number as written in Kconfig, in hex for hex options"""
+    if option.type == "hex":
+        return f"0x{value:X}"
+    return str(value)
+
+
+def header(options, sources):
+    """Return the C header, with disabled bool options left undefined"""
+    lines = [
+        f"/* Generated by scripts/genconfig.py from {', '.join(sources)}, do not edit */",
+        "#ifndef __OS_CONFIG_H__",
+        "#define __OS_CONFIG_H__",
+        "",
+    ]
+    for option in options.values():
+        name = PREFIX + option.name
+        if option.type != "bool":
+            lines.append(f"#define {name} {format_value(option, option.value)}")
+        elif option.value:
+            lines.append(f"#define {name} 1")
+        else:
+            lines.append(f"/* {name} is not set */")
+    lines += ["", "#endif /* __OS_CONFIG_H__ */"]
+    return "\n".join(lines) + "\n"
+
+
+def linker(options, sources):
+    """Return the linker script fragment, with bool options as 0 or 1"""
+    lines = [f"/* Generated by scripts/genconfig.py from {', '.join(sources)}, do not edit */"]
+    for option in options.values():
+        value = int(option.value) if option.type == "bool" else format_value(option, option.value)
+        lines.append(f"{PREFIX}{option.name} = {value};")
+    return "\n".join(lines) + "\n"
+
+
+def makefile(options, sources):
+    """Return the makefile fragment, with bool options as y or n"""
+    lines = [f"# Generated by scripts/genconfig.py from {', '.join(sources)}, do not edit"]
+    for option in options.values():
+        if option.type == "bool":
+            value = "y" if option.value else "n"
+        else:
+            value = format_value(option, option.value)
+        lines.append(f"{PREFIX}{option.name} := {value}")
+    return "\n".join(lines) + "\n"
+
+
+def write_if_changed(path, text):
+    """Write a file, keeping its timestamp if it already has this content"""
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                return
+    os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+    with open(path, "w") as f:
+        f.write(text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the KantOS kernel configuration")
+    parser.add_argument("--kconfig", default="Kconfig", help="option declarations (default: Kconfig)")
+    parser.add_argument("--config", help="configuration file of CONFIG_NAME=value lines")
+    parser.add_argument("--header", help="C header to write")
+    parser.add_argument("--linker", help="linker script fragment to write")
+    parser.add_argument("--makefile", help="makefile fragment to write")
+    parser.add_argument("overrides", nargs="*", metavar="CONFIG_NAME=VALUE",
+                        help="options to set over the configuration file")
+    args = parser.parse_args()
+
+    options = parse_kconfig(args.kconfig)
+    sources = [args.kconfig]
+    if args.config:
+        read_config(args.config, options)
+        sources.append(args.config)
+    for override in args.overrides:
+        name, sep, value = override.partition("=")
+        if not sep:
+            parser.error(f"expected CONFIG_NAME=VALUE, not '{override}'")
+        set_value(options, name, value, "command line")
+
+    # Defaults and ranges may depend on options declared after them, so are applied once all are set
+    for option in options.values():
+        resolve(options, option)
+    for option in options.values():
+        check_range(options, option)
+        check_alignment(option)
+
+    if args.header:
+        write_if_changed(args.header, header(options, sources))
+    if args.linker:
+        write_if_changed(args.linker, linker(options, sources))
+    if args.makefile:
+        write_if_changed(args.makefile, makefile(options, sources))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+
+# @file log_decode.py
+# @brief Script to decode binary log records from the kernel output
+#
+# Reads the format strings of LOG calls from the .logstr section of the
+# kernel ELF, and turns the binary records in the output into text. Other
+# output, e.g. from print(), is passed through as is. The output is read
+# from a command (QEMU, or the host build), a captured UART log, or stdin.
+#
+# Copyright (c) 2025 Miikka Lukumies
+
+import argparse
+import re
+import struct
+import subprocess
+import sys
+
+RECORD_TAG = 0x80
+RECORD_ARGS_MASK = 0x0F
+
+FORMAT_SPEC = re.compile(r"%([-+ 0#]*)(\d*)(?:hh|h|ll|l|z)?([diuxXcp%])")
+
+
+def read_logstr(path):
+    """Return the address and contents of the .logstr section of an ELF file"""
+    with open(path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF":
+        raise ValueError(f"{path} is not an ELF file")
+    is64 = elf[4] == 2
+    endian = "<" if elf[5] == 1 else ">"
+
+    if is64:
+        shoff, = struct.unpack_from(endian + "Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", elf, 0x3A)
+        header = endian + "IIQQQQIIQQ"
+    else:
+        shoff, = struct.unpack_from(endian + "I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", elf, 0x2E)
+        header = endian + "IIIIIIIIII"
+
+    sections = [struct.unpack_from(header, elf, shoff + i * shentsize) for i in range(shnum)]
+    strtab = sections[shstrndx]
+    for name, _, _, addr, offset, size, _, _, _, _ in sections:
+        start = strtab[4] + name
+        if elf[start:elf.index(b"\0", start)] == b".logstr":
+            return addr, elf[offset:offset + size]
+    raise ValueError(f"{path} has no .logstr section, is LOG used?")
+
+
+def format_message(fmt, args):
+    """Format a message from a printf-style format string and 32-bit argument words"""
+    args = list(args)
+
+    def convert(match):
+        flags, width, conv = match.groups()
+        if conv == "%":
+            return "%"
+        value = args.pop(0) if args else 0
+        if conv in "di":
+            value = value - (1 << 32) if value & 0x80000000 else value
+            conv = "d"
+        elif conv == "u":
+            conv = "d"
+        elif conv == "c":
+            return chr(value & 0xFF)
+        elif conv == "p":
+            return f"0x{value:08x}"
+        return ("%" + flags + width + conv) % value
+
+    return FORMAT_SPEC.sub(convert, fmt)
+
+
+def read_varint(stream):
+    """Read a LEB128 varint, return None at the end of the stream"""
+    value = 0
+    shift = 0
+    while True:
+        byte = stream.read(1)
+        if not byte:
+            return None
+        value |= (byte[0] & 0x7F) << shift
+        shift += 7
+        if not byte[0] & 0x80:
+            return value
+
+
+def decode(stream, base, strings, out):
+    """Decode the output stream, writing text and decoded records to out"""
+    while True:
+        byte = stream.read(1)
+        if not byte:
+            return
+        if byte[0] & RECORD_TAG != RECORD_TAG:
+            out.write(byte.decode("ascii", errors="replace"))
+            if byte == b"\n":
+                out.flush()
+            continue
+
+        fields = [read_varint(stream) for _ in range(2 + (byte[0] & RECORD_ARGS_MASK))]
+        if None in fields:
+            return
+        fmt_id, ticks, args = fields[0], fields[1], fields[2:]
+
+        offset = fmt_id - base
+        if 0 <= offset < len(strings):
+            fmt = strings[offset:strings.index(b"\0", offset)].decode("ascii", errors="replace")
+            message = format_message(fmt, args)
+        else:
+            message = f"<unknown format 0x{fmt_id:x}> " + " ".join(f"0x{a:08x}" for a in args)
+        out.write(f"[{ticks:10}] {message}\n")
+        out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode KantOS binary log output")
+    parser.add_argument("elf", help="kernel ELF the output is from")
+    parser.add_argument("--log", help="read the output from a captured log instead of stdin")
+    parser.add_argument("command", nargs="*", help="command producing the output")
+    args = parser.parse_args()
+
+    base, strings = read_logstr(args.elf)
+
+    if args.command:
+        proc = subprocess.Popen(args.command, stdin=subprocess.DEVNULL, stdout=subprocess.PIPE)
+        try:
+            decode(proc.stdout, base, strings, sys.stdout)
+        except KeyboardInterrupt:
+            pass
+        finally:
+            proc.kill()
+            proc.wait()
+    elif args.log:
+        with open(args.log, "rb") as f:
+            decode(f, base, strings, sys.stdout)
+    else:
+        decode(sys.stdin.buffer, base, strings, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
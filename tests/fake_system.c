@@ -0,0 +1,290 @@
+/*
+ * @file fake_system.c
+ * @brief Fake system driver for running kernel code in host tests. Ticks are
+ *      advanced by the test, and PendSV and spare interrupts are only recorded
+ *      until the test runs them with @ref fake_pendsv and @ref fake_spare_irq
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* =================== INCLUDES =============================== */
+#include <stdint.h>
+#include "system.h"
+#include "os.h"
+#include "fake_system.h"
+
+/* ========================= FUNCTION DECLARATIONS ========================= */
+
+int FAKE_TICK_init(int ms, Tick_Callback cb);
+int FAKE_PendSV_init(PendSV_Callback cb);
+void FAKE_Task_Stack_init(task_t *task);
+uint32_t FAKE_Count_Leading_Zeros(uint32_t value);
+uint64_t FAKE_TICK_get(void);
+uint64_t FAKE_time_get(void);
+void FAKE_busy_sleep(int us);
+void FAKE_PendSV_trigger(void);
+void FAKE_wait_for_interrupt(void);
+void FAKE_sync_barriers(void);
+uint32_t FAKE_cycles_get(void);
+uint32_t FAKE_critical_enter(void);
+void FAKE_critical_exit(uint32_t state);
+uintptr_t FAKE_syscall(uint32_t num, uintptr_t a0, uintptr_t a1, uintptr_t a2);
+int FAKE_spare_irq_init(uint32_t irqn, uint32_t prio, Irq_Callback cb);
+void FAKE_spare_irq_pend(uint32_t irqn);
+int FAKE_irq_attach(uint32_t irqn, Irq_Handler handler, uint32_t prio);
+uint32_t FAKE_irq_active(void);
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief System driver vtable */
+static const SystemDriver drv = {
+    &FAKE_TICK_init,
+    &FAKE_PendSV_init,
+    &FAKE_Task_Stack_init,
+    &FAKE_Count_Leading_Zeros,
+    &FAKE_TICK_get,
+    &FAKE_time_get,
+    &FAKE_busy_sleep,
+    &FAKE_PendSV_trigger,
+    &FAKE_wait_for_interrupt,
+    &FAKE_sync_barriers,
+    &FAKE_cycles_get,
+    &FAKE_critical_enter,
+    &FAKE_critical_exit,
+    &FAKE_syscall,
+    &FAKE_spare_irq_init,
+    &FAKE_spare_irq_pend,
+    &FAKE_irq_attach,
+    &FAKE_irq_active
+};
+
+/** @brief System driver pointer, matching extern in os driver abstraction */
+const SystemDriver * const Sys_Driver = &drv;
+
+/** @brief Tick callback registered by the kernel */
+static Tick_Callback tick_cb;
+
+/** @brief PendSV callback registered by the kernel */
+static PendSV_Callback pendsv_cb;
+
+/** @brief Callback of the spare interrupts */
+static Irq_Callback spare_irq_cb;
+
+uint64_t fake_ticks;
+uint32_t fake_pendsv_triggers;
+uint32_t fake_pendsv_pending;
+uint32_t fake_critical_nesting;
+uint32_t fake_syscalls;
+uint32_t fake_in_irq;
+uint32_t fake_spare_irq_enabled;
+uint32_t fake_spare_irq_pending;
+uint8_t fake_spare_irq_prio[FAKE_SPARE_IRQS];
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/**
+ * @brief Reset the fake driver and the kernel task states between tests
+ */
+void fake_reset(void)
+{
+    uint32_t i;
+
+    for(i = 0; i <= STATE_WOKEN; i++) {
+        task_state_list[i] = 0;
+    }
+    tick_cb = 0;
+    pendsv_cb = 0;
+    fake_ticks = 0;
+    fake_pendsv_triggers = 0;
+    fake_pendsv_pending = 0;
+    fake_critical_nesting = 0;
+    fake_syscalls = 0;
+    fake_in_irq = 0;
+    spare_irq_cb = 0;
+    fake_spare_irq_enabled = 0;
+    fake_spare_irq_pending = 0;
+    task_switch.current_tcb = 0;
+    task_switch.next_tcb = 0;
+}
+
+/**
+ * @brief Advance time by one tick, calling the kernel tick callback as the SysTick ISR does
+ */
+void fake_tick(void)
+{
+    fake_ticks++;
+    if(tick_cb) {
+        tick_cb();
+    }
+}
+
+/**
+ * @brief Run a triggered PendSV; wake the tasks signalled from interrupts, and
+ *      switch task states if a task is selected, as PendSV_Handler does
+ */
+void fake_pendsv(void)
+{
+    if(!fake_pendsv_pending) {
+        return;
+    }
+    fake_pendsv_pending = 0;
+
+    if(task_state_list[STATE_WOKEN] && pendsv_cb) {
+        pendsv_cb();
+    }
+    if(!task_state_list[STATE_NEXT]) {
+        return;
+    }
+
+    task_state_list[STATE_EJECTED] = task_state_list[STATE_RUNNING];
+    task_state_list[STATE_RUNNING] = task_state_list[STATE_NEXT];
+    task_state_list[STATE_NEXT] = 0;
+    task_switch.current_tcb = task_switch.next_tcb;
+}
+
+/**
+ * @brief Run the pending spare interrupts, highest priority first, as the NVIC
+ *      does once nothing of higher priority runs. Interrupts pended by the
+ *      callbacks are run too
+ */
+void fake_spare_irq(void)
+{
+    uint32_t irqn, best;
+
+    while(fake_spare_irq_pending) {
+        best = FAKE_SPARE_IRQS;
+        for(irqn = 0; irqn < FAKE_SPARE_IRQS; irqn++) {
+            if((fake_spare_irq_pending & (1UL << irqn)) && (best == FAKE_SPARE_IRQS
+                || fake_spare_irq_prio[irqn] < fake_spare_irq_prio[best])) {
+                best = irqn;
+            }
+        }
+        fake_spare_irq_pending &= ~(1UL << best);
+        spare_irq_cb(best);
+    }
+}
+
+int FAKE_TICK_init(int ms, Tick_Callback cb)
+{
+    (void)ms;
+    tick_cb = cb;
+    return 0;
+}
+
+int FAKE_PendSV_init(PendSV_Callback cb)
+{
+    pendsv_cb = cb;
+    return 0;
+}
+
+void FAKE_Task_Stack_init(task_t *task)
+{
+    (void)task;
+}
+
+uint32_t FAKE_Count_Leading_Zeros(uint32_t value)
+{
+    /* Builtin is undefined for zero, unlike the CLZ instruction */
+    if(!value) {
+        return 32;
+    }
+    return (uint32_t)__builtin_clz(value);
+}
+
+uint64_t FAKE_TICK_get(void)
+{
+    return fake_ticks;
+}
+
+uint64_t FAKE_time_get(void)
+{
+    return fake_ticks * 1000000ULL;
+}
+
+void FAKE_busy_sleep(int us)
+{
+    (void)us;
+}
+
+void FAKE_PendSV_trigger(void)
+{
+    fake_pendsv_triggers++;
+    fake_pendsv_pending = 1;
+}
+
+void FAKE_wait_for_interrupt(void)
+{
+}
+
+void FAKE_sync_barriers(void)
+{
+}
+
+uint32_t FAKE_cycles_get(void)
+{
+    return (uint32_t)fake_ticks;
+}
+
+uint32_t FAKE_critical_enter(void)
+{
+    return fake_critical_nesting++;
+}
+
+void FAKE_critical_exit(uint32_t state)
+{
+    fake_critical_nesting = state;
+}
+
+/**
+ * @brief Call the kernel function of a system call directly, counting the calls
+ */
+uintptr_t FAKE_syscall(uint32_t num, uintptr_t a0, uintptr_t a1, uintptr_t a2)
+{
+    fake_syscalls++;
+
+    if(num >= OS_SYSCALL_COUNT) {
+        return (uintptr_t)OS_ERROR;
+    }
+
+    return syscall_table[num](a0, a1, a2);
+}
+
+/**
+ * @brief Enable a spare interrupt; numbers below FAKE_SPARE_IRQS are spare
+ */
+int FAKE_spare_irq_init(uint32_t irqn, uint32_t prio, Irq_Callback cb)
+{
+    if(irqn >= FAKE_SPARE_IRQS) {
+        return -1;
+    }
+
+    spare_irq_cb = cb;
+    fake_spare_irq_prio[irqn] = (uint8_t)prio;
+    fake_spare_irq_enabled |= 1UL << irqn;
+
+    return 0;
+}
+
+/**
+ * @brief Record a spare interrupt as pending, until run by @ref fake_spare_irq
+ */
+void FAKE_spare_irq_pend(uint32_t irqn)
+{
+    fake_spare_irq_pending |= 1UL << irqn;
+}
+
+/** @brief Attaching handlers is not faked, the kernel never does it */
+int FAKE_irq_attach(uint32_t irqn, Irq_Handler handler, uint32_t prio)
+{
+    (void)irqn;
+    (void)handler;
+    (void)prio;
+
+    return -1;
+}
+
+/** @brief In an interrupt while the test sets @ref fake_in_irq */
+uint32_t FAKE_irq_active(void)
+{
+    return fake_in_irq;
+}
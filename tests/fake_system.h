@@ -0,0 +1,74 @@
+/*
+ * @file fake_system.h
+ * @brief Fake system driver for running kernel code in host tests
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+#ifndef __FAKE_SYSTEM_H__
+#define __FAKE_SYSTEM_H__
+
+/* =================== INCLUDES =============================== */
+#include <stdint.h>
+#include "os.h"
+
+/* =================== MACRO DEFINITIONS ====================== */
+
+/** @brief Entries of the task state list, see task_state_e in os.c */
+#define STATE_NEXT          0
+#define STATE_READY         1
+#define STATE_PENDING       2
+#define STATE_RUNNING       3
+#define STATE_EJECTED       4
+#define STATE_WOKEN         5
+
+/** @brief Bit of a task in the task state list */
+#define TASK_BIT(x)         (1UL << (31UL - (x)))
+
+/** @brief Number of spare interrupts of the fake driver */
+#define FAKE_SPARE_IRQS     32
+
+/* =================== EXTERN DEFINITIONS ===================== */
+
+/** @brief Task state list of the kernel under test */
+extern volatile uint32_t task_state_list[];
+
+/** @brief Running and next TCB of the kernel under test */
+extern task_switch_t task_switch;
+
+/** @brief Tick count returned by the driver, may be set freely */
+extern uint64_t fake_ticks;
+
+/** @brief Number of times PendSV has been triggered */
+extern uint32_t fake_pendsv_triggers;
+
+/** @brief Set while a triggered PendSV has not been run by @ref fake_pendsv */
+extern uint32_t fake_pendsv_pending;
+
+/** @brief Depth of nested critical sections entered */
+extern uint32_t fake_critical_nesting;
+
+/** @brief Number of system calls made */
+extern uint32_t fake_syscalls;
+
+/** @brief Set by the test to run kernel calls as from an interrupt */
+extern uint32_t fake_in_irq;
+
+/** @brief Spare interrupts enabled, and pended but not run yet, a bit per interrupt number */
+extern uint32_t fake_spare_irq_enabled;
+extern uint32_t fake_spare_irq_pending;
+
+/** @brief Priority of each spare interrupt enabled */
+extern uint8_t fake_spare_irq_prio[];
+
+/** @brief Kernel functions of the system calls */
+extern const os_syscall_t syscall_table[];
+
+/* =================== FUNCTION DECLARATIONS ================== */
+
+void fake_reset(void);
+void fake_tick(void);
+void fake_pendsv(void);
+void fake_spare_irq(void);
+
+#endif /* __FAKE_SYSTEM_H__ */
@@ -0,0 +1,43 @@
+/*
+ * @file mock_stm32u5.c
+ * @brief Register mocks for running the STM32U5 drivers on host
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* =================== INCLUDES =============================== */
+#include <stdint.h>
+#include "mock_stm32u5.h"
+
+/* ========================= CONSTANTS ========================= */
+
+#define USART_ISR           0x1C                /* USART Interrupt Status Register offset */
+#define USART_ISR_IDLE      (0x3UL << 6)        /* TXE and TC, set while the transmitter is idle */
+
+/* ========================= STATIC DATA ========================= */
+
+volatile uint32_t mock_usart1[MOCK_BLOCK_WORDS];
+volatile uint32_t mock_rcc[MOCK_BLOCK_WORDS];
+volatile uint32_t mock_gpioa[MOCK_BLOCK_WORDS];
+volatile uint32_t mock_gpdma1[MOCK_BLOCK_WORDS];
+volatile uint32_t mock_nvic[MOCK_BLOCK_WORDS];
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/**
+ * @brief Reset all mocked registers to zero, with the USART transmitter idle
+ */
+void mock_stm32u5_reset(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < MOCK_BLOCK_WORDS; i++) {
+        mock_usart1[i] = 0;
+        mock_rcc[i] = 0;
+        mock_gpioa[i] = 0;
+        mock_gpdma1[i] = 0;
+        mock_nvic[i] = 0;
+    }
+
+    MOCK_REG(mock_usart1, USART_ISR) = USART_ISR_IDLE;
+}
@@ -0,0 +1,43 @@
+/*
+ * @file mock_stm32u5.h
+ * @brief Register mocks for running the STM32U5 drivers on host. Included
+ *      before the driver source, this moves the peripherals into memory
+ *      that the tests can inspect and modify
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+#ifndef __MOCK_STM32U5_H__
+#define __MOCK_STM32U5_H__
+
+/* =================== INCLUDES =============================== */
+#include <stdint.h>
+
+/* =================== MACRO DEFINITIONS ====================== */
+
+/** @brief Size of each mocked register block in words */
+#define MOCK_BLOCK_WORDS    (0x400 / 4)
+
+/** @brief Peripheral base addresses used by the drivers */
+#define USART1_REG_BASE_ADDR    ((uintptr_t)mock_usart1)
+#define RCC_REG_BASE_ADDR       ((uintptr_t)mock_rcc)
+#define GPIOA_REG_BASE_ADDR     ((uintptr_t)mock_gpioa)
+#define GPDMA1_REG_BASE_ADDR    ((uintptr_t)mock_gpdma1)
+#define NVIC_REG_BASE_ADDR      ((uintptr_t)mock_nvic)
+
+/** @brief Access a mocked register by its offset from the block base */
+#define MOCK_REG(block, offset) ((block)[(offset) / 4])
+
+/* =================== EXTERN DEFINITIONS ===================== */
+
+extern volatile uint32_t mock_usart1[MOCK_BLOCK_WORDS];
+extern volatile uint32_t mock_rcc[MOCK_BLOCK_WORDS];
+extern volatile uint32_t mock_gpioa[MOCK_BLOCK_WORDS];
+extern volatile uint32_t mock_gpdma1[MOCK_BLOCK_WORDS];
+extern volatile uint32_t mock_nvic[MOCK_BLOCK_WORDS];
+
+/* =================== FUNCTION DECLARATIONS ================== */
+
+void mock_stm32u5_reset(void);
+
+#endif /* __MOCK_STM32U5_H__ */
@@ -0,0 +1,89 @@
+/*
+ * @file test.h
+ * @brief Minimal unit test runner for host tests
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+#ifndef __TEST_H__
+#define __TEST_H__
+
+/* =================== INCLUDES =============================== */
+#include <stdio.h>
+
+/* =================== MACRO DEFINITIONS ====================== */
+
+/** @brief Fail the running test, and return from it, if the condition is false */
+#define TEST_ASSERT(cond)                                                   \
+do {                                                                        \
+    if(!(cond)) {                                                           \
+        test_fail(__FILE__, __LINE__, #cond);                               \
+        return;                                                             \
+    }                                                                       \
+} while(0)
+
+/** @brief Fail the running test, and return from it, if the values differ */
+#define TEST_ASSERT_EQ(actual, expected)                                    \
+do {                                                                        \
+    unsigned long long __a = (unsigned long long)(actual);                  \
+    unsigned long long __e = (unsigned long long)(expected);                \
+    if(__a != __e) {                                                        \
+        printf("    %s = 0x%llX, expected 0x%llX\n", #actual, __a, __e);    \
+        test_fail(__FILE__, __LINE__, #actual " == " #expected);            \
+        return;                                                             \
+    }                                                                       \
+} while(0)
+
+/** @brief Run one test function */
+#define RUN_TEST(fn) test_run(#fn, &fn)
+
+/* =================== STATIC DATA ============================ */
+
+/** @brief Number of tests run and failed */
+static int tests_run;
+static int tests_failed;
+
+/** @brief Set when the running test has failed */
+static int test_failed;
+
+/* =================== FUNCTION DEFINITIONS =================== */
+
+/**
+ * @brief Mark the running test failed
+ * @param file  file of the failed assertion
+ * @param line  line of the failed assertion
+ * @param what  the failed assertion
+ */
+static inline void test_fail(const char *file, int line, const char *what)
+{
+    printf("    %s:%d: assertion failed: %s\n", file, line, what);
+    test_failed = 1;
+}
+
+/**
+ * @brief Run one test function, and record the result
+ * @param name  name of the test
+ * @param fn    test function
+ */
+static inline void test_run(const char *name, void (*fn)(void))
+{
+    test_failed = 0;
+    fn();
+    tests_run++;
+    if(test_failed) {
+        tests_failed++;
+    }
+    printf("%s %s\n", test_failed ? "FAIL" : "PASS", name);
+}
+
+/**
+ * @brief Print a summary of the tests run
+ * @return 0 if all tests passed, 1 otherwise, to be returned from main
+ */
+static inline int test_summary(void)
+{
+    printf("%d tests, %d failed\n", tests_run, tests_failed);
+    return tests_failed ? 1 : 0;
+}
+
+#endif /* __TEST_H__ */
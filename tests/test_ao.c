@@ -0,0 +1,334 @@
+/*
+ * @file test_ao.c
+ * @brief Host unit tests of the active objects in libs/ao
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include <string.h>
+
+#include "os.h"
+#include "pool/pool.h"
+#include "ao/ao.h"
+#include "test.h"
+#include "fake_system.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Signals of the state machine under test */
+enum {
+    SIG_A = AO_SIG_USER,    /* s1 -> s2 */
+    SIG_B,                  /* s11 -> s11, a self-transition */
+    SIG_C,                  /* s2 -> s, a transition to the superstate */
+    SIG_D,                  /* handled in s without a transition */
+    SIG_PUB,                /* published, counted by the counters */
+};
+
+/* ========================= TYPE DEFINITIONS ========================= */
+
+/** @brief An event with a value */
+typedef struct Value_Event {
+    ao_event_t super;
+    uint32_t value;
+} value_event_t;
+
+/** @brief An actor counting the values of its events */
+typedef struct Counter {
+    ao_actor_t super;
+    uint32_t count;
+    uint32_t sum;
+} counter_t;
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief Entries and exits of the state machine under test, in order */
+static char trace[128];
+
+/** @brief Events of SIG_D handled */
+static uint32_t d_count;
+
+static uint32_t hsm_initial(ao_actor_t *me, const ao_event_t *e);
+static uint32_t counter_initial(ao_actor_t *me, const ao_event_t *e);
+
+/** @brief State machine under test:
+ *      top
+ *       +- s
+ *           +- s1 (initial)
+ *           |   +- s11 (initial)
+ *           +- s2
+ */
+OS_ACTOR_DEFINE(hsm, hsm_initial, 4);
+
+/** @brief Actors counting published events, each test starts them with empty queues */
+static const ao_event_t *counter_a_queue[2];
+static const ao_event_t *counter_b_queue[4];
+static counter_t counter_a = { .super = AO_ACTOR_INIT(counter_initial, counter_a_queue) };
+static counter_t counter_b = { .super = AO_ACTOR_INIT(counter_initial, counter_b_queue) };
+
+/** @brief Group running the actors under test */
+static OS_ACTOR_GROUP_DEFINE(group);
+
+/** @brief Pool of events */
+OS_POOL_DEFINE(events, sizeof(value_event_t), 4);
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/** @brief Task required by the kernel, the scheduler is not started in these tests */
+void unused_task(void* arg1, void* arg2, void* arg3)
+{
+}
+
+OS_TASKS_INIT(
+    OS_TASK_DEFINE(unused_task, 0, 0, 0, OS_LOWEST_PRIO + 1),
+);
+
+static uint32_t s(ao_actor_t *me, const ao_event_t *e);
+static uint32_t s1(ao_actor_t *me, const ao_event_t *e);
+static uint32_t s11(ao_actor_t *me, const ao_event_t *e);
+static uint32_t s2(ao_actor_t *me, const ao_event_t *e);
+
+/** @brief Record entries and exits of a state */
+static void trace_state(const char *name, const ao_event_t *e)
+{
+    if(e->sig == AO_SIG_ENTRY || e->sig == AO_SIG_EXIT) {
+        strcat(trace, e->sig == AO_SIG_ENTRY ? "+" : "-");
+        strcat(trace, name);
+        strcat(trace, " ");
+    }
+}
+
+static uint32_t hsm_initial(ao_actor_t *me, const ao_event_t *e)
+{
+    return AO_TRAN(me, &s);
+}
+
+static uint32_t s(ao_actor_t *me, const ao_event_t *e)
+{
+    trace_state("s", e);
+    switch(e->sig) {
+    case AO_SIG_ENTRY:
+    case AO_SIG_EXIT:
+        return AO_HANDLED();
+    case AO_SIG_INIT:
+        return AO_TRAN(me, &s1);
+    case SIG_D:
+        d_count++;
+        return AO_HANDLED();
+    }
+    return AO_SUPER(me, &ao_top);
+}
+
+static uint32_t s1(ao_actor_t *me, const ao_event_t *e)
+{
+    trace_state("s1", e);
+    switch(e->sig) {
+    case AO_SIG_ENTRY:
+    case AO_SIG_EXIT:
+        return AO_HANDLED();
+    case AO_SIG_INIT:
+        return AO_TRAN(me, &s11);
+    case SIG_A:
+        return AO_TRAN(me, &s2);
+    }
+    return AO_SUPER(me, &s);
+}
+
+static uint32_t s11(ao_actor_t *me, const ao_event_t *e)
+{
+    trace_state("s11", e);
+    switch(e->sig) {
+    case AO_SIG_ENTRY:
+    case AO_SIG_EXIT:
+        return AO_HANDLED();
+    case SIG_B:
+        return AO_TRAN(me, &s11);
+    }
+    return AO_SUPER(me, &s1);
+}
+
+static uint32_t s2(ao_actor_t *me, const ao_event_t *e)
+{
+    trace_state("s2", e);
+    switch(e->sig) {
+    case AO_SIG_ENTRY:
+    case AO_SIG_EXIT:
+        return AO_HANDLED();
+    case SIG_C:
+        return AO_TRAN(me, &s);
+    }
+    return AO_SUPER(me, &s);
+}
+
+/** @brief Only state of the counters */
+static uint32_t counting(ao_actor_t *me, const ao_event_t *e)
+{
+    counter_t *counter = (counter_t *)me;
+
+    if(e->sig == SIG_PUB) {
+        counter->count++;
+        counter->sum += ((const value_event_t *)e)->value;
+        return AO_HANDLED();
+    }
+    return AO_SUPER(me, &ao_top);
+}
+
+static uint32_t counter_initial(ao_actor_t *me, const ao_event_t *e)
+{
+    return AO_TRAN(me, &counting);
+}
+
+/** @brief Send an event with a signal straight to the state machine under test */
+static void hsm_send(uint32_t sig)
+{
+    ao_event_t e = { .sig = sig };
+
+    trace[0] = '\0';
+    ao_dispatch(&hsm, &e);
+}
+
+/** @brief Starting takes the initial transitions down to the innermost state */
+static void test_start(void)
+{
+    fake_reset();
+
+    trace[0] = '\0';
+    TEST_ASSERT_EQ(ao_start(&hsm, &group), OS_OK);
+    TEST_ASSERT(strcmp(trace, "+s +s1 +s11 ") == 0);
+    TEST_ASSERT(hsm.state == &s11);
+    TEST_ASSERT(ao_is_in(&hsm, &s1));
+    TEST_ASSERT(!ao_is_in(&hsm, &s2));
+
+    TEST_ASSERT_EQ(ao_start(&hsm, &group), OS_ERROR);
+
+    TEST_ASSERT_EQ(ao_start(&counter_a.super, &group), OS_OK);
+    TEST_ASSERT_EQ(ao_start(&counter_b.super, &group), OS_OK);
+}
+
+/** @brief Transitions exit up to the innermost state containing the target, and enter down to it */
+static void test_transitions(void)
+{
+    /* Handled by a superstate, without a transition */
+    hsm_send(SIG_D);
+    TEST_ASSERT(strcmp(trace, "") == 0);
+    TEST_ASSERT_EQ(d_count, 1);
+
+    /* Self-transition exits and enters the state again */
+    hsm_send(SIG_B);
+    TEST_ASSERT(strcmp(trace, "-s11 +s11 ") == 0);
+
+    /* Taken by a superstate of the current state, exits the current state first */
+    hsm_send(SIG_A);
+    TEST_ASSERT(strcmp(trace, "-s11 -s1 +s2 ") == 0);
+    TEST_ASSERT(hsm.state == &s2);
+
+    /* Not handled in this state */
+    hsm_send(SIG_B);
+    TEST_ASSERT(strcmp(trace, "") == 0);
+    TEST_ASSERT(hsm.state == &s2);
+
+    /* Transition to the superstate does not exit it, and takes its initial transition */
+    hsm_send(SIG_C);
+    TEST_ASSERT(strcmp(trace, "-s2 +s1 +s11 ") == 0);
+    TEST_ASSERT(hsm.state == &s11);
+}
+
+/** @brief Posted events are handled by the group in order, one actor at a time */
+static void test_post(void)
+{
+    ao_event_t a = { .sig = SIG_A };
+    ao_event_t c = { .sig = SIG_C };
+    ao_event_t d = { .sig = SIG_D };
+
+    d_count = 0;
+
+    TEST_ASSERT_EQ(ao_post(&hsm, &a), OS_OK);
+    TEST_ASSERT_EQ(ao_post(&hsm, &d), OS_OK);
+    TEST_ASSERT_EQ(ao_post(&hsm, &c), OS_OK);
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+    TEST_ASSERT(hsm.state == &s11);
+
+    TEST_ASSERT_EQ(ao_group_dispatch(&group), 1);
+    TEST_ASSERT(hsm.state == &s2);
+    TEST_ASSERT_EQ(ao_group_dispatch(&group), 1);
+    TEST_ASSERT_EQ(d_count, 1);
+    TEST_ASSERT_EQ(ao_group_dispatch(&group), 1);
+    TEST_ASSERT(hsm.state == &s11);
+    TEST_ASSERT_EQ(ao_group_dispatch(&group), 0);
+    TEST_ASSERT(group.ready_head == 0 && group.ready_tail == 0);
+}
+
+/** @brief Published events reach the subscribers only, and go back to the pool once handled */
+static void test_publish(void)
+{
+    pool_stats_t stats;
+    value_event_t *e;
+
+    TEST_ASSERT_EQ(ao_subscribe(&counter_a.super, SIG_PUB), OS_OK);
+    TEST_ASSERT_EQ(ao_subscribe(&counter_b.super, SIG_PUB), OS_OK);
+    TEST_ASSERT_EQ(ao_subscribe(&counter_b.super, AO_PUB_SIGNALS), OS_ERROR);
+
+    e = AO_EVENT_NEW(value_event_t, &events, SIG_PUB);
+    TEST_ASSERT(e != 0);
+    e->value = 5;
+    TEST_ASSERT_EQ(ao_publish(&e->super), OS_OK);
+    TEST_ASSERT_EQ(e->super.refs, 2);
+
+    while(ao_group_dispatch(&group)) {;}
+    TEST_ASSERT_EQ(counter_a.count, 1);
+    TEST_ASSERT_EQ(counter_b.sum, 5);
+    pool_get_stats(&events, &stats);
+    TEST_ASSERT_EQ(stats.used, 0);
+
+    /* Unsubscribed actors no longer get them */
+    TEST_ASSERT_EQ(ao_unsubscribe(&counter_a.super, SIG_PUB), OS_OK);
+    e = AO_EVENT_NEW(value_event_t, &events, SIG_PUB);
+    e->value = 7;
+    TEST_ASSERT_EQ(ao_publish(&e->super), OS_OK);
+    while(ao_group_dispatch(&group)) {;}
+    TEST_ASSERT_EQ(counter_a.count, 1);
+    TEST_ASSERT_EQ(counter_b.sum, 12);
+
+    /* Events published to nobody are freed right away */
+    e = AO_EVENT_NEW(value_event_t, &events, SIG_PUB + 1);
+    TEST_ASSERT_EQ(ao_publish(&e->super), OS_OK);
+    pool_get_stats(&events, &stats);
+    TEST_ASSERT_EQ(stats.used, 0);
+
+    /* Events larger than the blocks of the pool are refused */
+    TEST_ASSERT(ao_event_new(&events, sizeof(value_event_t) + 4, SIG_PUB) == 0);
+}
+
+/** @brief Events are refused and freed once the queue is full */
+static void test_full(void)
+{
+    pool_stats_t stats;
+    value_event_t *e;
+    uint32_t i;
+
+    for(i = 0; i < 3; i++) {
+        e = AO_EVENT_NEW(value_event_t, &events, SIG_PUB);
+        e->value = i;
+        TEST_ASSERT_EQ(ao_post(&counter_a.super, &e->super), i < 2 ? OS_OK : OS_ERROR);
+    }
+    TEST_ASSERT_EQ(counter_a.super.lost, 1);
+    pool_get_stats(&events, &stats);
+    TEST_ASSERT_EQ(stats.used, 2);
+
+    while(ao_group_dispatch(&group)) {;}
+    TEST_ASSERT_EQ(counter_a.count, 3);
+    pool_get_stats(&events, &stats);
+    TEST_ASSERT_EQ(stats.used, 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_start);
+    RUN_TEST(test_transitions);
+    RUN_TEST(test_post);
+    RUN_TEST(test_publish);
+    RUN_TEST(test_full);
+
+    return test_summary();
+}
@@ -0,0 +1,250 @@
+/*
+ * @file test_coro.c
+ * @brief Host unit tests of the stackless coroutines in libs/coro
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+
+#include "os.h"
+#include "coro/coro.h"
+#include "test.h"
+#include "fake_system.h"
+
+/* ========================= TYPE DEFINITIONS ========================= */
+
+/** @brief A coroutine counting its steps */
+typedef struct Counter {
+    co_t super;
+    uint32_t id;
+    uint32_t i;
+} counter_t;
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief Steps taken by the coroutines, in order, tagged with the coroutine */
+static uint32_t steps[32];
+static uint32_t step_count;
+
+/** @brief Scheduler under test, run by the tests instead of a task */
+static OS_CO_SCHED_DEFINE(sched);
+
+/** @brief Semaphore under test */
+static OS_CO_SEM_DEFINE(sem, 0);
+
+/** @brief Coroutines under test */
+static counter_t a = { .id = 0xA };
+static counter_t b = { .id = 0xB };
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/** @brief Task required by the kernel, the scheduler is not started in these tests */
+void unused_task(void* arg1, void* arg2, void* arg3)
+{
+}
+
+OS_TASKS_INIT(
+    OS_TASK_DEFINE(unused_task, 0, 0, 0, OS_LOWEST_PRIO + 1),
+);
+
+/** @brief Record a step of a coroutine */
+static void step(counter_t *me)
+{
+    steps[step_count++] = (me->id << 8) | me->i;
+}
+
+/** @brief Takes three steps, yielding after each */
+static uint32_t yielder(co_t *co)
+{
+    counter_t *me = (counter_t *)co;
+
+    CO_BEGIN(co);
+    for(me->i = 0; me->i < 3; me->i++) {
+        step(me);
+        CO_YIELD(co);
+    }
+    CO_END(co);
+}
+
+/** @brief Takes a step, sleeps 5 ms, and takes another */
+static uint32_t sleeper(co_t *co)
+{
+    counter_t *me = (counter_t *)co;
+
+    CO_BEGIN(co);
+    me->i = 0;
+    step(me);
+    CO_SLEEP(co, 5);
+    me->i = 1;
+    step(me);
+    CO_END(co);
+}
+
+/** @brief Takes a step each time the semaphore is taken, forever */
+static uint32_t taker(co_t *co)
+{
+    counter_t *me = (counter_t *)co;
+
+    CO_BEGIN(co);
+    for(me->i = 0; ; me->i++) {
+        CO_SEM_TAKE(co, &sem);
+        step(me);
+    }
+    CO_END(co);
+}
+
+/** @brief Set to let the awaiter through */
+static volatile uint32_t flag;
+
+/** @brief Takes a step once the flag is set */
+static uint32_t awaiter(co_t *co)
+{
+    counter_t *me = (counter_t *)co;
+
+    CO_BEGIN(co);
+    me->i = 0;
+    CO_AWAIT(co, flag);
+    step(me);
+    CO_END(co);
+}
+
+/** @brief Empty the scheduler and the steps */
+static void coro_reset(void)
+{
+    while(sched.head) {
+        sched.head->spawned = 0;
+        sched.head = sched.head->next;
+    }
+    step_count = 0;
+}
+
+/** @brief Coroutines take turns at each yield, and are removed once ended */
+static void test_yield(void)
+{
+    fake_reset();
+    coro_reset();
+
+    TEST_ASSERT_EQ(co_spawn(&sched, &a.super, &yielder), OS_OK);
+    TEST_ASSERT_EQ(co_spawn(&sched, &b.super, &yielder), OS_OK);
+    TEST_ASSERT_EQ(co_spawn(&sched, &a.super, &yielder), OS_ERROR);
+
+    /* The latest spawned runs first */
+    TEST_ASSERT_EQ(co_sched_run(&sched), 2);
+    TEST_ASSERT_EQ(step_count, 2);
+    TEST_ASSERT_EQ(steps[0], 0xB00);
+    TEST_ASSERT_EQ(steps[1], 0xA00);
+
+    TEST_ASSERT_EQ(co_sched_run(&sched), 2);
+    TEST_ASSERT_EQ(co_sched_run(&sched), 2);
+    TEST_ASSERT_EQ(steps[4], 0xB02);
+    TEST_ASSERT_EQ(steps[5], 0xA02);
+
+    /* Both end on the next pass */
+    TEST_ASSERT_EQ(co_sched_run(&sched), 0);
+    TEST_ASSERT(sched.head == 0);
+    TEST_ASSERT_EQ(sched.resumes, 8);
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+
+    /* An ended coroutine starts over when spawned again */
+    TEST_ASSERT_EQ(co_spawn(&sched, &a.super, &yielder), OS_OK);
+    (void)co_sched_run(&sched);
+    TEST_ASSERT_EQ(steps[6], 0xA00);
+}
+
+/** @brief Sleeping coroutines wake up on the tick, and the earliest is noted */
+static void test_sleep(void)
+{
+    coro_reset();
+    fake_ticks = 100;
+
+    TEST_ASSERT_EQ(co_spawn(&sched, &a.super, &sleeper), OS_OK);
+    TEST_ASSERT_EQ(co_sched_run(&sched), 0);
+    TEST_ASSERT_EQ(step_count, 1);
+    TEST_ASSERT(sched.sleeping);
+    TEST_ASSERT_EQ(sched.wake, 105);
+
+    fake_ticks = 103;
+    TEST_ASSERT_EQ(co_spawn(&sched, &b.super, &sleeper), OS_OK);
+    (void)co_sched_run(&sched);
+    TEST_ASSERT_EQ(step_count, 2);
+    TEST_ASSERT_EQ(sched.wake, 105);
+
+    fake_ticks = 105;
+    (void)co_sched_run(&sched);
+    TEST_ASSERT_EQ(step_count, 3);
+    TEST_ASSERT_EQ(steps[2], 0xA01);
+    TEST_ASSERT_EQ(sched.wake, 108);
+
+    fake_ticks = 108;
+    (void)co_sched_run(&sched);
+    TEST_ASSERT_EQ(steps[3], 0xB01);
+    TEST_ASSERT(!sched.sleeping);
+    TEST_ASSERT(!sched.polling);
+    TEST_ASSERT(sched.head == 0);
+}
+
+/** @brief A semaphore is taken once per give, a coroutine taking it as long as available */
+static void test_sem(void)
+{
+    coro_reset();
+
+    TEST_ASSERT_EQ(co_spawn(&sched, &a.super, &taker), OS_OK);
+    TEST_ASSERT_EQ(co_spawn(&sched, &b.super, &taker), OS_OK);
+    TEST_ASSERT_EQ(co_sched_run(&sched), 0);
+    TEST_ASSERT_EQ(step_count, 0);
+
+    co_sem_give(&sem);
+    co_sem_give(&sem);
+    co_sem_give(&sem);
+    TEST_ASSERT_EQ(co_sched_run(&sched), 0);
+    TEST_ASSERT_EQ(step_count, 3);
+    TEST_ASSERT_EQ(steps[0], 0xB00);
+    TEST_ASSERT_EQ(steps[1], 0xB01);
+    TEST_ASSERT_EQ(steps[2], 0xB02);
+    TEST_ASSERT_EQ(sem.count, 0);
+
+    (void)co_sched_run(&sched);
+    TEST_ASSERT_EQ(step_count, 3);
+
+    co_sem_give(&sem);
+    (void)co_sched_run(&sched);
+    TEST_ASSERT_EQ(step_count, 4);
+    TEST_ASSERT_EQ(steps[3], 0xB03);
+
+    TEST_ASSERT(!co_sem_try(&sem));
+    co_sem_give(&sem);
+    TEST_ASSERT(co_sem_try(&sem));
+    TEST_ASSERT(!sched.polling);
+}
+
+/** @brief Only conditions nothing signals are polled, while waited for */
+static void test_await(void)
+{
+    coro_reset();
+    flag = 0;
+
+    TEST_ASSERT_EQ(co_spawn(&sched, &a.super, &awaiter), OS_OK);
+    TEST_ASSERT_EQ(co_spawn(&sched, &b.super, &taker), OS_OK);
+    TEST_ASSERT_EQ(co_sched_run(&sched), 0);
+    TEST_ASSERT_EQ(step_count, 0);
+    TEST_ASSERT(sched.polling);
+
+    flag = 1;
+    (void)co_sched_run(&sched);
+    TEST_ASSERT_EQ(step_count, 1);
+    TEST_ASSERT_EQ(steps[0], 0xA00);
+    TEST_ASSERT(!sched.polling);
+    TEST_ASSERT(sched.head == &b.super);
+}
+
+int main(void)
+{
+    RUN_TEST(test_yield);
+    RUN_TEST(test_sleep);
+    RUN_TEST(test_sem);
+    RUN_TEST(test_await);
+
+    return test_summary();
+}
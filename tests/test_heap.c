@@ -0,0 +1,250 @@
+/*
+ * @file test_heap.c
+ * @brief Host unit tests of the TLSF heap in libs/heap
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include <string.h>
+
+#include "os.h"
+#include "heap/heap.h"
+#include "test.h"
+#include "fake_system.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Size of the heap regions of the tests */
+#define REGION_SIZE     2048
+
+/** @brief Number of allocations in the stress test */
+#define STRESS_SLOTS    32
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief Region of the heaps created by the tests */
+static uint8_t __attribute__((aligned(8))) region[REGION_SIZE];
+
+/** @brief Heap under test */
+static heap_t heap;
+
+/** @brief System heap region, in place of the linker script's */
+uint8_t __attribute__((aligned(8))) __HeapStart[REGION_SIZE];
+asm(".globl __HeapLimit\n.set __HeapLimit, __HeapStart + 2048");
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/** @brief Task required by the kernel, the scheduler is not started in these tests */
+void unused_task(void* arg1, void* arg2, void* arg3)
+{
+}
+
+OS_TASKS_INIT(
+    OS_TASK_DEFINE(unused_task, 0, 0, 0, OS_LOWEST_PRIO + 1),
+);
+
+/** @brief Check that the heap is back to one free block over the whole region */
+static int heap_is_empty(void)
+{
+    heap_stats_t stats;
+
+    heap_get_stats(&heap, &stats);
+    return stats.allocated == 0 && stats.free_bytes == stats.size
+        && stats.largest_free == stats.size && stats.fragmentation == 0;
+}
+
+/** @brief A new heap is one free block, and regions too small are refused */
+static void test_init(void)
+{
+    heap_stats_t stats;
+
+    TEST_ASSERT_EQ(heap_init(&heap, region, REGION_SIZE), OS_OK);
+    heap_get_stats(&heap, &stats);
+    TEST_ASSERT(stats.size > REGION_SIZE - 64 && stats.size < REGION_SIZE);
+    TEST_ASSERT_EQ(stats.free_bytes, stats.size);
+    TEST_ASSERT_EQ(stats.free_min, stats.size);
+    TEST_ASSERT_EQ(stats.largest_free, stats.size);
+    TEST_ASSERT_EQ(stats.fragmentation, 0);
+    TEST_ASSERT_EQ(stats.allocated, 0);
+
+    /* An unaligned region is aligned */
+    TEST_ASSERT_EQ(heap_init(&heap, &region[3], REGION_SIZE - 3), OS_OK);
+    TEST_ASSERT_EQ((uintptr_t)heap_alloc(&heap, 1) % HEAP_ALIGN, 0);
+
+    TEST_ASSERT_EQ(heap_init(&heap, region, 16), OS_ERROR);
+    TEST_ASSERT_EQ(heap_init(&heap, 0, REGION_SIZE), OS_ERROR);
+    TEST_ASSERT(heap_alloc(&heap, 1) == 0);
+}
+
+/** @brief Allocations are aligned and do not overlap, and freeing them all
+ *      merges the heap back into one block */
+static void test_alloc_free(void)
+{
+    static const uint32_t sizes[] = { 1, 7, 8, 24, 100, 64, 300, 5 };
+    uint8_t *ptrs[sizeof(sizes) / sizeof(sizes[0])];
+    uint32_t i, j;
+
+    TEST_ASSERT_EQ(heap_init(&heap, region, REGION_SIZE), OS_OK);
+
+    for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        ptrs[i] = heap_alloc(&heap, sizes[i]);
+        TEST_ASSERT(ptrs[i] != 0);
+        TEST_ASSERT_EQ((uintptr_t)ptrs[i] % HEAP_ALIGN, 0);
+        TEST_ASSERT(ptrs[i] >= region && ptrs[i] + sizes[i] <= region + REGION_SIZE);
+        memset(ptrs[i], (int)i + 1, sizes[i]);
+    }
+
+    for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        for(j = 0; j < sizes[i]; j++) {
+            TEST_ASSERT_EQ(ptrs[i][j], i + 1);
+        }
+    }
+
+    /* Free in an order that merges with both neighbours */
+    for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i += 2) {
+        heap_free(&heap, ptrs[i]);
+    }
+    for(i = 1; i < sizeof(sizes) / sizeof(sizes[0]); i += 2) {
+        heap_free(&heap, ptrs[i]);
+    }
+    TEST_ASSERT(heap_is_empty());
+}
+
+/** @brief Free blocks between allocations show as fragmentation, and the
+ *      low-water mark of free bytes is kept */
+static void test_stats(void)
+{
+    heap_stats_t stats, full;
+    void *a, *b, *c, *d;
+
+    TEST_ASSERT_EQ(heap_init(&heap, region, REGION_SIZE), OS_OK);
+    heap_get_stats(&heap, &full);
+
+    a = heap_alloc(&heap, 256);
+    b = heap_alloc(&heap, 256);
+    c = heap_alloc(&heap, 256);
+    d = heap_alloc(&heap, 256);
+    heap_get_stats(&heap, &stats);
+    TEST_ASSERT_EQ(stats.allocated, 4);
+    TEST_ASSERT(stats.free_bytes <= full.size - 4 * 256);
+    TEST_ASSERT_EQ(stats.largest_free, stats.free_bytes);
+
+    heap_free(&heap, a);
+    heap_free(&heap, c);
+    heap_get_stats(&heap, &stats);
+    TEST_ASSERT_EQ(stats.allocated, 2);
+    TEST_ASSERT(stats.largest_free < stats.free_bytes);
+    TEST_ASSERT(stats.fragmentation > 0);
+    TEST_ASSERT(stats.free_min < stats.free_bytes);
+
+    heap_free(&heap, b);
+    heap_free(&heap, d);
+    TEST_ASSERT(heap_is_empty());
+}
+
+/** @brief Allocation fails when out of memory, and bad frees are ignored */
+static void test_exhaustion(void)
+{
+    heap_stats_t stats;
+    void *ptrs[REGION_SIZE / 8];
+    uint32_t n, i;
+
+    TEST_ASSERT_EQ(heap_init(&heap, region, REGION_SIZE), OS_OK);
+
+    TEST_ASSERT(heap_alloc(&heap, 0) == 0);
+    TEST_ASSERT(heap_alloc(&heap, REGION_SIZE) == 0);
+    TEST_ASSERT(heap_alloc(&heap, 0xFFFFFFFFUL) == 0);
+
+    for(n = 0; (ptrs[n] = heap_alloc(&heap, 40)) != 0; n++) { ; }
+    TEST_ASSERT(n > 20);
+    heap_get_stats(&heap, &stats);
+    TEST_ASSERT(stats.largest_free < 40);
+    TEST_ASSERT_EQ(stats.allocated, n);
+
+    /* A freed block is found again for the same size */
+    heap_free(&heap, ptrs[0]);
+    TEST_ASSERT(heap_alloc(&heap, 40) == ptrs[0]);
+
+    heap_free(&heap, 0);
+    heap_free(&heap, ptrs[0]);
+    heap_free(&heap, ptrs[0]);
+    heap_get_stats(&heap, &stats);
+    TEST_ASSERT_EQ(stats.allocated, n - 1);
+
+    for(i = 1; i < n; i++) {
+        heap_free(&heap, ptrs[i]);
+    }
+    TEST_ASSERT(heap_is_empty());
+}
+
+/** @brief Random allocations and frees keep the data intact, and leave no leaks */
+static void test_stress(void)
+{
+    uint8_t *ptrs[STRESS_SLOTS] = { 0 };
+    uint32_t sizes[STRESS_SLOTS];
+    uint32_t seed = 12345;
+    uint32_t round, slot, i;
+
+    TEST_ASSERT_EQ(heap_init(&heap, region, REGION_SIZE), OS_OK);
+
+    for(round = 0; round < 5000; round++) {
+        seed = seed * 1103515245UL + 12345UL;
+        slot = (seed >> 16) % STRESS_SLOTS;
+
+        if(ptrs[slot]) {
+            for(i = 0; i < sizes[slot]; i++) {
+                TEST_ASSERT_EQ(ptrs[slot][i], (uint8_t)slot);
+            }
+            heap_free(&heap, ptrs[slot]);
+            ptrs[slot] = 0;
+        } else {
+            sizes[slot] = 1 + (seed >> 8) % 200;
+            ptrs[slot] = heap_alloc(&heap, sizes[slot]);
+            if(ptrs[slot]) {
+                memset(ptrs[slot], (int)slot, sizes[slot]);
+            }
+        }
+    }
+
+    for(slot = 0; slot < STRESS_SLOTS; slot++) {
+        heap_free(&heap, ptrs[slot]);
+    }
+    TEST_ASSERT(heap_is_empty());
+}
+
+/** @brief The system heap is laid over the heap region, and used in critical sections */
+static void test_system_heap(void)
+{
+    heap_stats_t stats;
+    uint8_t *ptr;
+
+    fake_reset();
+
+    ptr = mem_alloc(100);
+    TEST_ASSERT(ptr >= __HeapStart && ptr + 100 <= __HeapStart + REGION_SIZE);
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+
+    mem_get_stats(&stats);
+    TEST_ASSERT_EQ(stats.allocated, 1);
+    TEST_ASSERT(stats.size > REGION_SIZE - 64);
+
+    mem_free(ptr);
+    mem_get_stats(&stats);
+    TEST_ASSERT_EQ(stats.allocated, 0);
+    TEST_ASSERT_EQ(stats.free_bytes, stats.size);
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_init);
+    RUN_TEST(test_alloc_free);
+    RUN_TEST(test_stats);
+    RUN_TEST(test_exhaustion);
+    RUN_TEST(test_stress);
+    RUN_TEST(test_system_heap);
+
+    return test_summary();
+}
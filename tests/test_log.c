@@ -0,0 +1,384 @@
+/*
+ * @file test_log.c
+ * @brief Host unit tests of libs/log; the binary log record encoding, and the
+ *      log buffer drained by the logger task. The output is captured by a UART
+ *      driver of the test, and records decoded as scripts/log_decode.py does
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include <string.h>
+
+#include "uart.h"
+#include "os.h"
+#include "log/log.h"
+#include "print/print.h"
+#include "test.h"
+#include "fake_system.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Size of the capture buffer */
+#define CAPTURE_SIZE    2048
+
+/** @brief Size of the log buffer */
+#define LOG_BUFFER_SIZE 1024
+
+/* ========================= TYPE DEFINITIONS ========================= */
+
+/** @brief A decoded record */
+typedef struct Decoded_Record {
+    uint32_t nargs;
+    uintptr_t id;
+    uint32_t ticks;
+    uint32_t args[LOG_MAX_ARGS];
+} decoded_record_t;
+
+/* ========================= FUNCTION DECLARATIONS ========================= */
+
+const int CAPTURE_UART_init(void);
+const int CAPTURE_UART_printchar(const char *c);
+const int CAPTURE_UART_printstr(const char *str);
+const int CAPTURE_UART_flush(void);
+const int CAPTURE_UART_write(const char *buf, uint32_t len, Uart_Write_Callback cb);
+const int CAPTURE_UART_read(char *buf, uint32_t len, int ms);
+const int CAPTURE_UART_read_line(char *buf, uint32_t len, int ms);
+const int CAPTURE_UART_rx_notify(Uart_Rx_Callback cb);
+
+/* ========================= EXTERN DEFINITIONS ========================= */
+
+/** @brief Set when the logger task has started, and output is buffered */
+extern volatile uint32_t log_task_started;
+
+/** @brief Indices of the log buffer reserved by producers, and sent by the logger */
+extern volatile uint32_t log_reserved;
+extern volatile uint32_t log_consumed;
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief UART driver capturing the output */
+static UartDriver drv = {
+    &CAPTURE_UART_init,
+    &CAPTURE_UART_printchar,
+    &CAPTURE_UART_printstr,
+    &CAPTURE_UART_flush,
+    &CAPTURE_UART_write,
+    &CAPTURE_UART_read,
+    &CAPTURE_UART_read_line,
+    &CAPTURE_UART_rx_notify
+};
+
+/** @brief UART driver pointer, matching extern in uart driver abstraction */
+const UartDriver *Uart_Driver = &drv;
+
+/** @brief Captured output */
+static uint8_t capture[CAPTURE_SIZE];
+static uint32_t capture_len;
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/** @brief Task required by the kernel, the scheduler is not started in these tests */
+void unused_task(void* arg1, void* arg2, void* arg3)
+{
+}
+
+OS_TASKS_INIT(
+    OS_TASK_DEFINE(unused_task, 0, 0, 0, OS_LOWEST_PRIO + 1),
+);
+
+const int CAPTURE_UART_init(void)
+{
+    return 0;
+}
+
+const int CAPTURE_UART_printchar(const char *c)
+{
+    if(capture_len < CAPTURE_SIZE) {
+        capture[capture_len++] = (uint8_t)*c;
+    }
+    return 0;
+}
+
+const int CAPTURE_UART_printstr(const char *str)
+{
+    while(*str) {
+        (void)CAPTURE_UART_printchar(str++);
+    }
+    return 0;
+}
+
+const int CAPTURE_UART_flush(void)
+{
+    return 0;
+}
+
+const int CAPTURE_UART_write(const char *buf, uint32_t len, Uart_Write_Callback cb)
+{
+    return -1;
+}
+
+const int CAPTURE_UART_read(char *buf, uint32_t len, int ms)
+{
+    return -1;
+}
+
+const int CAPTURE_UART_read_line(char *buf, uint32_t len, int ms)
+{
+    return -1;
+}
+
+const int CAPTURE_UART_rx_notify(Uart_Rx_Callback cb)
+{
+    return -1;
+}
+
+/**
+ * @brief Reset the capture and the time, and empty the log buffer. Output is
+ *      sent directly, as before the logger task has started
+ */
+static void setup(void)
+{
+    fake_reset();
+    log_drain();
+    log_task_started = 0;
+    capture_len = 0;
+}
+
+/** @brief Decode a varint from the capture */
+static uintptr_t decode_varint(uint32_t *pos)
+{
+    uintptr_t value = 0;
+    uint32_t shift = 0;
+    uint8_t byte;
+
+    do {
+        byte = capture[(*pos)++];
+        value |= (uintptr_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while(byte & 0x80);
+
+    return value;
+}
+
+/** @brief Length of a value encoded as a varint */
+static uint32_t varint_len(uintptr_t value)
+{
+    uint32_t len = 1;
+
+    while(value >= 0x80) {
+        value >>= 7;
+        len++;
+    }
+    return len;
+}
+
+/**
+ * @brief Decode the record at a position of the capture
+ * @param pos   position of the record, moved past it
+ * @param rec   decoded record
+ *
+ * @return 1 if a record was found, 0 otherwise
+ */
+static int decode_record(uint32_t *pos, decoded_record_t *rec)
+{
+    uint32_t i;
+
+    if((capture[*pos] & 0xF0) != LOG_RECORD_TAG) {
+        return 0;
+    }
+    rec->nargs = capture[(*pos)++] & 0x0F;
+    rec->id = decode_varint(pos);
+    rec->ticks = (uint32_t)decode_varint(pos);
+    for(i = 0; i < rec->nargs && i < LOG_MAX_ARGS; i++) {
+        rec->args[i] = (uint32_t)decode_varint(pos);
+    }
+    return 1;
+}
+
+/** @brief A record without arguments has the format ID and the timestamp */
+static void test_no_args(void)
+{
+    decoded_record_t rec;
+    uint32_t pos = 0;
+
+    setup();
+    fake_ticks = 300;
+
+    LOG("hello");
+
+    TEST_ASSERT(decode_record(&pos, &rec));
+    TEST_ASSERT_EQ(pos, capture_len);
+    TEST_ASSERT_EQ(rec.nargs, 0);
+    TEST_ASSERT_EQ(rec.ticks, 300);
+    TEST_ASSERT(strcmp((const char *)rec.id, "hello") == 0);
+}
+
+/** @brief Arguments are sent as full words, and small values take one byte */
+static void test_args(void)
+{
+    decoded_record_t rec;
+    uint32_t pos = 0;
+
+    setup();
+
+    LOG("%d %u %x", -1, 5, 0x12345678);
+
+    TEST_ASSERT(decode_record(&pos, &rec));
+    TEST_ASSERT_EQ(pos, capture_len);
+    TEST_ASSERT_EQ(rec.nargs, 3);
+    TEST_ASSERT(strcmp((const char *)rec.id, "%d %u %x") == 0);
+    TEST_ASSERT_EQ(rec.args[0], 0xFFFFFFFFUL);
+    TEST_ASSERT_EQ(rec.args[1], 5);
+    TEST_ASSERT_EQ(rec.args[2], 0x12345678UL);
+
+    /* The timestamp and the small argument are single bytes */
+    TEST_ASSERT_EQ(capture_len, 1 + varint_len(rec.id) + 1 + 5 + 1 + 5);
+}
+
+/** @brief The same call site always sends the same ID, and records can be
+ *      told apart from text */
+static void test_same_site(void)
+{
+    decoded_record_t first, second;
+    uint32_t pos = 0;
+    uint32_t i;
+
+    setup();
+
+    for(i = 0; i < 2; i++) {
+        LOG("loop %u", i);
+        (void)UART_print_str("text");
+    }
+
+    TEST_ASSERT(decode_record(&pos, &first));
+    TEST_ASSERT(!decode_record(&pos, &second));
+    TEST_ASSERT(memcmp(&capture[pos], "text", 4) == 0);
+    pos += 4;
+    TEST_ASSERT(decode_record(&pos, &second));
+    TEST_ASSERT_EQ(first.id, second.id);
+    TEST_ASSERT_EQ(first.args[0], 0);
+    TEST_ASSERT_EQ(second.args[0], 1);
+}
+
+/** @brief Buffered output is only sent when the logger drains it, in order */
+static void test_buffered(void)
+{
+    decoded_record_t rec;
+    uint32_t pos;
+
+    setup();
+    log_task_started = 1;
+
+    print("first");
+    LOG("second %u", 2);
+    print_hex("third ", 3);
+    TEST_ASSERT_EQ(capture_len, 0);
+
+    log_drain();
+    TEST_ASSERT(memcmp(capture, "first\r\n", 7) == 0);
+    pos = 7;
+    TEST_ASSERT(decode_record(&pos, &rec));
+    TEST_ASSERT_EQ(rec.args[0], 2);
+    TEST_ASSERT_EQ(capture_len - pos, 18);
+    TEST_ASSERT(memcmp(&capture[pos], "third 0x00000003\r\n", 18) == 0);
+
+    /* Nothing more to send */
+    log_drain();
+    TEST_ASSERT_EQ(capture_len, pos + 18);
+}
+
+/** @brief Lines longer than one piece of output are sent whole */
+static void test_buffered_long_line(void)
+{
+    char line[LOG_CHUNK_MAX * 2 + 11];
+    uint32_t i;
+
+    setup();
+    log_task_started = 1;
+
+    for(i = 0; i < sizeof(line) - 1; i++) {
+        line[i] = 'a' + (char)(i % 26);
+    }
+    line[sizeof(line) - 1] = 0;
+
+    print(line);
+    log_drain();
+    TEST_ASSERT_EQ(capture_len, sizeof(line) - 1 + 2);
+    TEST_ASSERT(memcmp(capture, line, sizeof(line) - 1) == 0);
+}
+
+/** @brief Output that does not fit is dropped whole, and counted */
+static void test_buffered_overflow(void)
+{
+    uint32_t dropped;
+    uint32_t i;
+
+    setup();
+    log_task_started = 1;
+    dropped = log_dropped_count();
+
+    /* 17 bytes and a header each */
+    for(i = 0; i < LOG_BUFFER_SIZE / 18 + 1; i++) {
+        print_hex("line ", i);
+    }
+    TEST_ASSERT_EQ(log_dropped_count(), dropped + 1);
+
+    log_drain();
+    TEST_ASSERT_EQ(capture_len, (LOG_BUFFER_SIZE / 18) * 17);
+
+    /* Room again after draining */
+    capture_len = 0;
+    print_hex("line ", i);
+    log_drain();
+    TEST_ASSERT_EQ(capture_len, 17);
+    TEST_ASSERT_EQ(log_dropped_count(), dropped + 1);
+}
+
+/** @brief A reservation over output sent on an earlier lap of the buffer is
+ *      not taken for committed output, while its producer is preempted before
+ *      committing. Output with the top bit set, as in varints, looks like a
+ *      committed header if left behind */
+static void test_stale_header(void)
+{
+    char data[100];
+    uint32_t i;
+
+    setup();
+    log_task_started = 1;
+    memset(data, 0xFF, sizeof(data));
+
+    /* Over a lap of pieces, the next one starts inside the output of the first */
+    for(i = 0; i < LOG_BUFFER_SIZE / (1 + sizeof(data)) + 1; i++) {
+        TEST_ASSERT_EQ(log_put(data, sizeof(data)), 0);
+        log_drain();
+    }
+    capture_len = 0;
+
+    /* A producer reserves a piece, and is preempted before writing it */
+    log_reserved += 1 + 5;
+    log_drain();
+    TEST_ASSERT_EQ(capture_len, 0);
+    TEST_ASSERT_EQ(log_consumed, log_reserved - (1 + 5));
+
+    /* Without the preempted producer, output goes through again */
+    log_reserved -= 1 + 5;
+    print_hex("line ", 1);
+    log_drain();
+    TEST_ASSERT_EQ(capture_len, 17);
+    TEST_ASSERT_EQ(log_consumed, log_reserved);
+}
+
+int main(void)
+{
+    RUN_TEST(test_no_args);
+    RUN_TEST(test_args);
+    RUN_TEST(test_same_site);
+    RUN_TEST(test_buffered);
+    RUN_TEST(test_buffered_long_line);
+    RUN_TEST(test_buffered_overflow);
+    RUN_TEST(test_stale_header);
+
+    return test_summary();
+}
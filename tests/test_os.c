@@ -0,0 +1,535 @@
+/*
+ * @file test_os.c
+ * @brief Host unit tests of the scheduler state machine in os/os.c
+ *
+ * The tests play the role of the tasks: calling yield() or sleep() acts
+ * on behalf of the task marked RUNNING. Time is advanced with fake_tick(),
+ * and context switches requested by the kernel are run with fake_pendsv().
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+
+#include "os.h"
+#include "system.h"
+#include "test.h"
+#include "fake_system.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Task numbers, in the order of @ref OS_TASKS_INIT below */
+#define HIGH_A  0
+#define HIGH_B  1
+#define LOW     2
+#define IDLE    3
+
+/* ========================= FUNCTION DECLARATIONS ========================= */
+
+void schedule(void);
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief Number of times the first task entry has been called */
+static int first_task_calls;
+
+/** @brief Memory regions declared for a task */
+static uint8_t region_a[64];
+static const uint8_t region_b[32];
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/** @brief Entry of the first task, called directly by scheduler_start */
+void first_task(void* arg1, void* arg2, void* arg3)
+{
+    first_task_calls++;
+}
+
+/** @brief Entry of the other tasks, never called in the tests */
+void other_task(void* arg1, void* arg2, void* arg3)
+{
+}
+
+/** @brief Tasks under test */
+OS_TASKS_INIT(
+    OS_TASK_DEFINE(first_task, 0, 0, 0, OS_LOWEST_PRIO + 2),
+    OS_TASK_DEFINE(other_task, 0, 0, 0, OS_LOWEST_PRIO + 2,
+        OS_REGION(region_a, sizeof(region_a), OS_REGION_RW),
+        OS_REGION(region_b, sizeof(region_b), OS_REGION_RO | OS_REGION_DEVICE)),
+    OS_USER_TASK_DEFINE(other_task, 0, 0, 0, OS_LOWEST_PRIO + 1),
+);
+
+/**
+ * @brief Start the scheduler from a clean state
+ */
+static void setup(void)
+{
+    fake_reset();
+    first_task_calls = 0;
+    scheduler_start();
+}
+
+/**
+ * @brief Yield from the running task, and run the context switch if one was requested
+ */
+static void yield_and_switch(void)
+{
+    yield();
+    fake_pendsv();
+}
+
+/** @brief Starting the scheduler runs the first task, and readies the rest */
+static void test_start_states(void)
+{
+    setup();
+
+    TEST_ASSERT_EQ(first_task_calls, 1);
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_A));
+    TEST_ASSERT_EQ(task_state_list[STATE_READY], TASK_BIT(HIGH_B) | TASK_BIT(LOW) | TASK_BIT(IDLE));
+    TEST_ASSERT_EQ(task_state_list[STATE_PENDING], 0);
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], 0);
+    TEST_ASSERT_EQ(fake_pendsv_triggers, 0);
+    TEST_ASSERT(task_switch.current_tcb == &__tasks[HIGH_A]);
+}
+
+/** @brief Yielding picks the ready task of the same priority, and the
+ *      yielding task becomes ready again on the next scheduler pass */
+static void test_yield_same_priority(void)
+{
+    setup();
+
+    yield();
+    TEST_ASSERT_EQ(fake_pendsv_triggers, 1);
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], TASK_BIT(HIGH_B));
+    TEST_ASSERT_EQ(task_state_list[STATE_READY], TASK_BIT(LOW) | TASK_BIT(IDLE));
+    TEST_ASSERT(task_switch.next_tcb == &__tasks[HIGH_B]);
+
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_B));
+    TEST_ASSERT_EQ(task_state_list[STATE_EJECTED], TASK_BIT(HIGH_A));
+    TEST_ASSERT(task_switch.current_tcb == &__tasks[HIGH_B]);
+
+    /* Yielding back cleans up the ejected task first */
+    yield();
+    TEST_ASSERT_EQ(fake_pendsv_triggers, 2);
+    TEST_ASSERT_EQ(task_state_list[STATE_EJECTED], 0);
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], TASK_BIT(HIGH_A));
+    TEST_ASSERT_EQ(task_state_list[STATE_READY], TASK_BIT(LOW) | TASK_BIT(IDLE));
+}
+
+/** @brief Yielding when only lower priority tasks are ready keeps running */
+static void test_yield_lower_priority_ready(void)
+{
+    setup();
+
+    /* Put HIGH_B to sleep */
+    yield_and_switch();
+    sleep(10);
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_A));
+
+    yield();
+    TEST_ASSERT_EQ(fake_pendsv_triggers, 2);
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], 0);
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_A));
+    TEST_ASSERT_EQ(task_state_list[STATE_PENDING], TASK_BIT(HIGH_B));
+    TEST_ASSERT_EQ(task_state_list[STATE_READY], TASK_BIT(LOW) | TASK_BIT(IDLE));
+}
+
+/** @brief Sleeping switches to the highest priority ready task, even if it
+ *      is of lower priority, and the sleeper is marked pending */
+static void test_sleep_picks_lower_priority(void)
+{
+    setup();
+
+    yield_and_switch();
+    sleep(10);
+    fake_pendsv();
+
+    /* HIGH_A sleeps too, only LOW and IDLE are left */
+    sleep(10);
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], TASK_BIT(LOW));
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(LOW));
+
+    /* Scheduler pass marks the sleeper pending */
+    fake_tick();
+    TEST_ASSERT_EQ(task_state_list[STATE_PENDING], TASK_BIT(HIGH_A) | TASK_BIT(HIGH_B));
+    TEST_ASSERT_EQ(task_state_list[STATE_EJECTED], 0);
+    TEST_ASSERT_EQ(fake_pendsv_triggers, 3);
+}
+
+/** @brief Sleeping with no other task ready picks the idle task */
+static void test_sleep_picks_idle(void)
+{
+    setup();
+
+    yield_and_switch();
+    sleep(10);
+    fake_pendsv();
+    sleep(10);
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(LOW));
+
+    sleep(10);
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], TASK_BIT(IDLE));
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(IDLE));
+}
+
+/** @brief A sleeping task wakes on the first tick past its wakeup time,
+ *      and preempts a task of the same priority */
+static void test_wakeup_timing(void)
+{
+    uint32_t i;
+
+    setup();
+    fake_ticks = 100;
+
+    sleep(5);
+    TEST_ASSERT_EQ(__tasks[HIGH_A].wakeup_time, 105);
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_B));
+
+    /* Still sleeping at the wakeup time */
+    for(i = 101; i <= 105; i++) {
+        fake_tick();
+        TEST_ASSERT_EQ(task_state_list[STATE_PENDING], TASK_BIT(HIGH_A));
+        TEST_ASSERT_EQ(fake_pendsv_triggers, 1);
+    }
+
+    fake_tick();
+    TEST_ASSERT_EQ(task_state_list[STATE_PENDING], 0);
+    TEST_ASSERT_EQ(__tasks[HIGH_A].wakeup_time, 0xFFFFFFFFFFFFFFFFULL);
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], TASK_BIT(HIGH_A));
+    TEST_ASSERT_EQ(fake_pendsv_triggers, 2);
+
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_A));
+}
+
+/** @brief Waking a higher priority task preempts a lower priority one */
+static void test_wakeup_preempts_lower_priority(void)
+{
+    setup();
+
+    yield_and_switch();
+    sleep(1);
+    fake_pendsv();
+    sleep(1);
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(LOW));
+
+    fake_tick();
+    fake_tick();
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], TASK_BIT(HIGH_A));
+    TEST_ASSERT_EQ(task_state_list[STATE_READY], TASK_BIT(HIGH_B) | TASK_BIT(IDLE));
+    TEST_ASSERT(task_switch.next_tcb == &__tasks[HIGH_A]);
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_A));
+    TEST_ASSERT(task_switch.current_tcb == &__tasks[HIGH_A]);
+}
+
+/** @brief Waking a lower priority task only marks it ready */
+static void test_wakeup_keeps_higher_priority(void)
+{
+    setup();
+
+    /* HIGH_A wakes up first, HIGH_B stays asleep */
+    sleep(1);
+    fake_pendsv();
+    sleep(1000);
+    fake_pendsv();
+    sleep(5);
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(IDLE));
+
+    fake_tick();
+    fake_tick();
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_A));
+    TEST_ASSERT_EQ(fake_pendsv_triggers, 4);
+
+    /* LOW wakes up while HIGH_A is running */
+    fake_ticks = 10;
+    fake_tick();
+    TEST_ASSERT_EQ(fake_pendsv_triggers, 4);
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], 0);
+    TEST_ASSERT_EQ(task_state_list[STATE_PENDING], TASK_BIT(HIGH_B));
+    TEST_ASSERT_EQ(task_state_list[STATE_READY], TASK_BIT(LOW) | TASK_BIT(IDLE));
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_A));
+}
+
+/** @brief Yielding and sleeping select the next task in a critical section,
+ *      and leave it before returning */
+static void test_critical_sections(void)
+{
+    uint32_t state;
+
+    setup();
+
+    yield();
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+    fake_pendsv();
+    sleep(10);
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+    TEST_ASSERT_EQ(fake_pendsv_triggers, 2);
+
+    /* Nested sections restore the outer one */
+    state = critical_enter();
+    yield();
+    TEST_ASSERT_EQ(fake_critical_nesting, 1);
+    critical_exit(state);
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+}
+
+/** @brief Memory regions declared with a task are kept in its TCB, and
+ *      tasks without any have empty regions */
+static void test_task_regions(void)
+{
+    TEST_ASSERT(__tasks[HIGH_B].regions[0].start == region_a);
+    TEST_ASSERT_EQ(__tasks[HIGH_B].regions[0].size, sizeof(region_a));
+    TEST_ASSERT_EQ(__tasks[HIGH_B].regions[0].flags, OS_REGION_RW);
+    TEST_ASSERT(__tasks[HIGH_B].regions[1].start == region_b);
+    TEST_ASSERT_EQ(__tasks[HIGH_B].regions[1].size, sizeof(region_b));
+    TEST_ASSERT_EQ(__tasks[HIGH_B].regions[1].flags, OS_REGION_RO | OS_REGION_DEVICE);
+
+    TEST_ASSERT_EQ(__tasks[HIGH_A].regions[0].size, 0);
+    TEST_ASSERT_EQ(__tasks[IDLE].regions[1].size, 0);
+}
+
+/** @brief System calls run the kernel functions, and waiting for an event
+ *      takes a call to start and another to finish once switched back */
+static void test_syscalls(void)
+{
+    os_event_t event = 0;
+
+    setup();
+
+    TEST_ASSERT_EQ(__tasks[LOW].unprivileged, 1);
+    TEST_ASSERT_EQ(__tasks[HIGH_A].unprivileged, 0);
+    TEST_ASSERT_EQ(__tasks[IDLE].unprivileged, 0);
+
+    sys_yield();
+    TEST_ASSERT_EQ(fake_syscalls, 1);
+    TEST_ASSERT_EQ(fake_pendsv_triggers, 1);
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], TASK_BIT(HIGH_B));
+    fake_pendsv();
+
+    sys_sleep(10);
+    TEST_ASSERT_EQ(fake_syscalls, 2);
+    TEST_ASSERT_EQ(__tasks[HIGH_B].wakeup_time, 10);
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_A));
+
+    /* Not signalled while switched out, the wait times out */
+    TEST_ASSERT_EQ(sys_event_wait(&event, 5), OS_TIMEOUT);
+    TEST_ASSERT_EQ(fake_syscalls, 4);
+    TEST_ASSERT_EQ(event, 0);
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+
+    sys_event_signal(&event);
+    TEST_ASSERT_EQ(fake_syscalls, 5);
+
+    TEST_ASSERT_EQ(Syscall(OS_SYSCALL_COUNT, 0, 0, 0), (uintptr_t)OS_ERROR);
+}
+
+/** @brief Waiting on a sequence number returns right away if it has changed,
+ *      and waits for the signal as usual if not */
+static void test_wait_seq(void)
+{
+    os_event_t event = 0;
+    volatile uint32_t seq = 1;
+    uint32_t triggers;
+
+    setup();
+    triggers = fake_pendsv_triggers;
+
+    /* Changed before the task started waiting, the signal has been missed */
+    TEST_ASSERT_EQ(event_wait_seq(&event, &seq, 0, OS_WAIT_FOREVER), OS_OK);
+    TEST_ASSERT_EQ(event, 0);
+    TEST_ASSERT(__tasks[HIGH_A].wait_event == 0);
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], 0);
+    TEST_ASSERT_EQ(fake_pendsv_triggers, triggers);
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+
+    /* Unchanged, the task waits, and not signalled while switched out, it times out */
+    TEST_ASSERT_EQ(event_wait_seq(&event, &seq, 1, 5), OS_TIMEOUT);
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], TASK_BIT(HIGH_B));
+    TEST_ASSERT_EQ(fake_pendsv_triggers, triggers + 1);
+    TEST_ASSERT_EQ(event, 0);
+    TEST_ASSERT(__tasks[HIGH_A].wait_event == 0);
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+}
+
+/** @brief Signals from interrupts only mark the tasks woken; the next PendSV
+ *      makes them ready and selects one to run, once for all the signals */
+static void test_signal_from_isr(void)
+{
+    os_event_t event_a = 0;
+    os_event_t event_b = 0;
+    uint32_t triggers;
+
+    setup();
+
+    /* Both high priority tasks wait with a timeout, as event_wait leaves them, and LOW runs */
+    sleep(100);
+    fake_pendsv();
+    sleep(100);
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(LOW));
+    event_a = TASK_BIT(HIGH_A);
+    event_b = TASK_BIT(HIGH_B);
+    __tasks[HIGH_A].wait_event = &event_a;
+    __tasks[HIGH_B].wait_event = &event_b;
+    triggers = fake_pendsv_triggers;
+
+    /* Two interrupts signal back to back, nothing is scheduled yet */
+    event_signal_from_isr(&event_a);
+    event_signal_from_isr(&event_b);
+    TEST_ASSERT_EQ(event_a, 0);
+    TEST_ASSERT_EQ(task_state_list[STATE_WOKEN], TASK_BIT(HIGH_A) | TASK_BIT(HIGH_B));
+    TEST_ASSERT_EQ(task_state_list[STATE_PENDING], TASK_BIT(HIGH_A));
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], 0);
+    TEST_ASSERT_EQ(fake_pendsv_triggers, triggers + 2);
+
+    /* One PendSV wakes both, including HIGH_B not yet retired from EJECTED, and switches */
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_WOKEN], 0);
+    TEST_ASSERT_EQ(task_state_list[STATE_PENDING], 0);
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_A));
+    TEST_ASSERT_EQ(task_state_list[STATE_READY], TASK_BIT(HIGH_B) | TASK_BIT(IDLE));
+    TEST_ASSERT_EQ(task_state_list[STATE_EJECTED], TASK_BIT(LOW));
+    TEST_ASSERT(__tasks[HIGH_B].wakeup_time == ~0ULL);
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+
+    /* A signal without waiters triggers nothing */
+    event_signal_from_isr(&event_a);
+    TEST_ASSERT_EQ(fake_pendsv_triggers, triggers + 2);
+
+    /* A task no longer waiting is not woken, and PendSV switches to nothing */
+    __tasks[HIGH_A].wait_event = 0;
+    __tasks[HIGH_B].wait_event = 0;
+    event_a = TASK_BIT(HIGH_B);
+    event_signal_from_isr(&event_a);
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_A));
+    TEST_ASSERT(task_switch.current_tcb == &__tasks[HIGH_A]);
+}
+
+/** @brief event_signal from an interrupt takes the PendSV path, as
+ *      event_signal_from_isr, instead of waiting for the tick */
+static void test_signal_in_irq(void)
+{
+    os_event_t event = 0;
+    uint32_t triggers;
+
+    setup();
+
+    /* HIGH_A waits for the event with a timeout, HIGH_B runs */
+    sleep(100);
+    fake_pendsv();
+    event = TASK_BIT(HIGH_A);
+    __tasks[HIGH_A].wait_event = &event;
+    triggers = fake_pendsv_triggers;
+
+    fake_in_irq = 1;
+    event_signal(&event);
+    fake_in_irq = 0;
+    TEST_ASSERT_EQ(event, 0);
+    TEST_ASSERT_EQ(task_state_list[STATE_WOKEN], TASK_BIT(HIGH_A));
+    TEST_ASSERT_EQ(__tasks[HIGH_A].wakeup_time, 100);
+    TEST_ASSERT_EQ(fake_pendsv_triggers, triggers + 1);
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+
+    /* PendSV makes it ready and switches to it, no tick needed */
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_A));
+    TEST_ASSERT_EQ(task_state_list[STATE_WOKEN], 0);
+    __tasks[HIGH_A].wait_event = 0;
+}
+
+/** @brief A signal wakes only tasks still waiting for the event. A task that
+ *      timed out, and went back to sleep before the signal was handled, keeps
+ *      sleeping */
+static void test_signal_after_timeout(void)
+{
+    os_event_t event = 0;
+
+    setup();
+
+    /* HIGH_A sleeps with its bit still in the event, as a signal racing its timeout finds it */
+    sleep(100);
+    fake_pendsv();
+    event = TASK_BIT(HIGH_A);
+    event_signal(&event);
+    TEST_ASSERT_EQ(event, 0);
+    TEST_ASSERT_EQ(__tasks[HIGH_A].wakeup_time, 100);
+    fake_tick();
+    fake_tick();
+    TEST_ASSERT_EQ(task_state_list[STATE_PENDING], TASK_BIT(HIGH_A));
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+
+    /* Waiting for the event, the same signal wakes it on the next tick */
+    __tasks[HIGH_A].wait_event = &event;
+    event = TASK_BIT(HIGH_A);
+    event_signal(&event);
+    TEST_ASSERT_EQ(__tasks[HIGH_A].wakeup_time, 0);
+    fake_tick();
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], TASK_BIT(HIGH_A));
+    __tasks[HIGH_A].wait_event = 0;
+}
+
+/** @brief An interrupt signal wakes only tasks still waiting for the event, as
+ *      PendSV handles them. A task that timed out, and went back to sleep
+ *      before the signal, keeps sleeping and nothing is triggered */
+static void test_signal_from_isr_after_timeout(void)
+{
+    os_event_t event = 0;
+    uint32_t triggers;
+
+    setup();
+
+    /* HIGH_A sleeps with its bit still in the event */
+    sleep(100);
+    fake_pendsv();
+    event = TASK_BIT(HIGH_A);
+    triggers = fake_pendsv_triggers;
+    event_signal_from_isr(&event);
+    TEST_ASSERT_EQ(event, 0);
+    TEST_ASSERT_EQ(task_state_list[STATE_WOKEN], 0);
+    TEST_ASSERT_EQ(fake_pendsv_triggers, triggers);
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+
+    /* A bit left in WOKEN once the task went back to sleep does not wake it either */
+    task_state_list[STATE_WOKEN] = TASK_BIT(HIGH_A);
+    (void)PendSV_trigger();
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_WOKEN], 0);
+    TEST_ASSERT_EQ(task_state_list[STATE_PENDING], TASK_BIT(HIGH_A));
+    TEST_ASSERT_EQ(__tasks[HIGH_A].wakeup_time, 100);
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_B));
+}
+
+int main(void)
+{
+    RUN_TEST(test_start_states);
+    RUN_TEST(test_yield_same_priority);
+    RUN_TEST(test_yield_lower_priority_ready);
+    RUN_TEST(test_sleep_picks_lower_priority);
+    RUN_TEST(test_sleep_picks_idle);
+    RUN_TEST(test_wakeup_timing);
+    RUN_TEST(test_wakeup_preempts_lower_priority);
+    RUN_TEST(test_wakeup_keeps_higher_priority);
+    RUN_TEST(test_critical_sections);
+    RUN_TEST(test_task_regions);
+    RUN_TEST(test_syscalls);
+    RUN_TEST(test_wait_seq);
+    RUN_TEST(test_signal_after_timeout);
+    RUN_TEST(test_signal_from_isr);
+    RUN_TEST(test_signal_in_irq);
+    RUN_TEST(test_signal_from_isr_after_timeout);
+
+    return test_summary();
+}
@@ -0,0 +1,210 @@
+/*
+ * @file test_pool.c
+ * @brief Host unit tests of the fixed-size block pools in libs/pool
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include <string.h>
+
+#include "os.h"
+#include "pool/pool.h"
+#include "test.h"
+#include "fake_system.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Number of blocks of the pool under test */
+#define BLOCKS          8
+
+/** @brief Requested block size, rounded up by the pool */
+#define BLOCK_SIZE      13
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief Pool under test, each test starts from an empty one */
+OS_POOL_DEFINE(pool, BLOCK_SIZE, BLOCKS);
+
+/** @brief Pool of blocks smaller than the list link */
+OS_POOL_DEFINE(tiny_pool, 1, 2);
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/** @brief Task required by the kernel, the scheduler is not started in these tests */
+void unused_task(void* arg1, void* arg2, void* arg3)
+{
+}
+
+OS_TASKS_INIT(
+    OS_TASK_DEFINE(unused_task, 0, 0, 0, OS_LOWEST_PRIO + 1),
+);
+
+/** @brief Empty the pool under test, as if just defined */
+static void pool_reset(void)
+{
+    pool.free_head = 0;
+    pool.carved = 0;
+    pool.used = 0;
+    pool.used_max = 0;
+    pool.available = 0;
+}
+
+/** @brief Block sizes are rounded up to keep blocks aligned and fit the list link */
+static void test_define(void)
+{
+    pool_stats_t stats;
+
+    TEST_ASSERT_EQ(POOL_BLOCK_SIZE(13), 16);
+    TEST_ASSERT_EQ(POOL_BLOCK_SIZE(16), 16);
+    TEST_ASSERT_EQ(POOL_BLOCK_SIZE(1), POOL_ALIGN);
+
+    pool_get_stats(&tiny_pool, &stats);
+    TEST_ASSERT_EQ(stats.block_size, POOL_ALIGN);
+    TEST_ASSERT_EQ(stats.count, 2);
+    TEST_ASSERT_EQ(stats.free, 2);
+    TEST_ASSERT_EQ(stats.free_min, 2);
+}
+
+/** @brief All blocks can be allocated, are aligned and do not overlap, and
+ *      allocation fails once the pool is empty */
+static void test_alloc_all(void)
+{
+    uint8_t *blocks[BLOCKS];
+    uint32_t i, j;
+
+    pool_reset();
+
+    for(i = 0; i < BLOCKS; i++) {
+        blocks[i] = pool_alloc(&pool);
+        TEST_ASSERT(blocks[i] != 0);
+        TEST_ASSERT_EQ((uintptr_t)blocks[i] % POOL_ALIGN, 0);
+        memset(blocks[i], (int)i + 1, BLOCK_SIZE);
+    }
+    TEST_ASSERT(pool_alloc(&pool) == 0);
+
+    for(i = 0; i < BLOCKS; i++) {
+        for(j = 0; j < BLOCK_SIZE; j++) {
+            TEST_ASSERT_EQ(blocks[i][j], i + 1);
+        }
+    }
+
+    for(i = 0; i < BLOCKS; i++) {
+        TEST_ASSERT_EQ(pool_free(&pool, blocks[i]), OS_OK);
+    }
+}
+
+/** @brief Freed blocks are allocated again, last freed first */
+static void test_reuse(void)
+{
+    void *a, *b, *c;
+    uint32_t i;
+
+    pool_reset();
+
+    a = pool_alloc(&pool);
+    b = pool_alloc(&pool);
+    TEST_ASSERT_EQ(pool_free(&pool, a), OS_OK);
+    TEST_ASSERT_EQ(pool_free(&pool, b), OS_OK);
+    TEST_ASSERT(pool_alloc(&pool) == b);
+    TEST_ASSERT(pool_alloc(&pool) == a);
+
+    /* The free list is used up before blocks never allocated */
+    c = pool_alloc(&pool);
+    TEST_ASSERT(c != a && c != b);
+
+    /* Heads differ after a pop and push of the same block */
+    i = pool.free_head;
+    TEST_ASSERT_EQ(pool_free(&pool, c), OS_OK);
+    TEST_ASSERT(pool_alloc(&pool) == c);
+    TEST_ASSERT(pool.free_head != i);
+    TEST_ASSERT_EQ(pool.free_head & 0xFFFFU, i & 0xFFFFU);
+}
+
+/** @brief Usage and the low-water mark of free blocks are reported */
+static void test_stats(void)
+{
+    pool_stats_t stats;
+    void *blocks[5];
+    uint32_t i;
+
+    pool_reset();
+
+    for(i = 0; i < 5; i++) {
+        blocks[i] = pool_alloc(&pool);
+    }
+    for(i = 0; i < 3; i++) {
+        pool_free(&pool, blocks[i]);
+    }
+    (void)pool_alloc(&pool);
+
+    pool_get_stats(&pool, &stats);
+    TEST_ASSERT_EQ(stats.block_size, 16);
+    TEST_ASSERT_EQ(stats.count, BLOCKS);
+    TEST_ASSERT_EQ(stats.used, 3);
+    TEST_ASSERT_EQ(stats.free, BLOCKS - 3);
+    TEST_ASSERT_EQ(stats.free_min, BLOCKS - 5);
+}
+
+/** @brief Pointers not to a block of the pool are refused */
+static void test_bad_free(void)
+{
+    pool_stats_t stats;
+    uint8_t *block;
+    uint32_t other;
+
+    pool_reset();
+
+    block = pool_alloc(&pool);
+    TEST_ASSERT_EQ(pool_free(&pool, 0), OS_OK);
+    TEST_ASSERT_EQ(pool_free(&pool, block + 1), OS_ERROR);
+    TEST_ASSERT_EQ(pool_free(&pool, block - 16), OS_ERROR);
+    TEST_ASSERT_EQ(pool_free(&pool, block + BLOCKS * 16), OS_ERROR);
+    TEST_ASSERT_EQ(pool_free(&pool, &other), OS_ERROR);
+
+    pool_get_stats(&pool, &stats);
+    TEST_ASSERT_EQ(stats.used, 1);
+    TEST_ASSERT_EQ(pool_free(&pool, block), OS_OK);
+}
+
+/** @brief Waiting fails without the scheduler or on timeout, and freeing a
+ *      block wakes the waiting tasks */
+static void test_wait(void)
+{
+    void *blocks[BLOCKS];
+    uint32_t i;
+
+    fake_reset();
+    pool_reset();
+
+    for(i = 0; i < BLOCKS; i++) {
+        blocks[i] = pool_alloc(&pool);
+    }
+    TEST_ASSERT(pool_alloc_wait(&pool, OS_WAIT_FOREVER) == 0);
+    TEST_ASSERT(pool_alloc_wait(&pool, 0) == 0);
+
+    /* A task waiting for a block is woken on the next tick */
+    __tasks[0].wakeup_time = 1000;
+    __tasks[0].wait_event = &pool.available;
+    pool.available = TASK_BIT(0);
+    TEST_ASSERT_EQ(pool_free(&pool, blocks[0]), OS_OK);
+    TEST_ASSERT_EQ(pool.available, 0);
+    TEST_ASSERT_EQ(__tasks[0].wakeup_time, 0);
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+
+    TEST_ASSERT(pool_alloc_wait(&pool, 0) == blocks[0]);
+    __tasks[0].wait_event = 0;
+}
+
+int main(void)
+{
+    RUN_TEST(test_define);
+    RUN_TEST(test_alloc_all);
+    RUN_TEST(test_reuse);
+    RUN_TEST(test_stats);
+    RUN_TEST(test_bad_free);
+    RUN_TEST(test_wait);
+
+    return test_summary();
+}
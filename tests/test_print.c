@@ -0,0 +1,161 @@
+/*
+ * @file test_print.c
+ * @brief Host unit tests of the printf-style formatter in libs/print
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include <string.h>
+
+#include "os.h"
+#include "print/print.h"
+#include "test.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Size of the output buffer */
+#define OUT_SIZE    64
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief Output of the sink */
+static char sink_out[OUT_SIZE * 4];
+static uint32_t sink_len;
+static uint32_t sink_calls;
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/** @brief Task required by the kernel, the scheduler is not started in these tests */
+void unused_task(void* arg1, void* arg2, void* arg3)
+{
+}
+
+OS_TASKS_INIT(
+    OS_TASK_DEFINE(unused_task, 0, 0, 0, OS_LOWEST_PRIO + 1),
+);
+
+/** @brief Sink collecting the output */
+static void sink(void *ctx, const char *data, uint32_t len)
+{
+    memcpy(&sink_out[sink_len], data, len);
+    sink_len += len;
+    sink_calls++;
+}
+
+/** @brief Format through the sink */
+static int format_to_sink(const char *fmt, ...)
+{
+    va_list args;
+    int ret;
+
+    sink_len = 0;
+    sink_calls = 0;
+    va_start(args, fmt);
+    ret = print_vformat(&sink, 0, fmt, args);
+    va_end(args);
+    sink_out[sink_len] = 0;
+
+    return ret;
+}
+
+/** @brief Format and compare against the expected output */
+#define CHECK_FORMAT(expected, ...)                                             \
+do {                                                                            \
+    char __out[OUT_SIZE];                                                       \
+    TEST_ASSERT_EQ(print_format(__out, sizeof(__out), __VA_ARGS__), strlen(expected)); \
+    if(strcmp(__out, expected) != 0) {                                          \
+        printf("    got \"%s\", expected \"%s\"\n", __out, expected);           \
+        TEST_ASSERT(strcmp(__out, expected) == 0);                              \
+    }                                                                           \
+} while(0)
+
+/** @brief Integers in decimal and hex */
+static void test_integers(void)
+{
+    CHECK_FORMAT("0 1 -1 42", "%d %i %d %u", 0, 1, -1, 42);
+    CHECK_FORMAT("-2147483648 4294967295", "%d %u", (int)0x80000000, 0xFFFFFFFFU);
+    CHECK_FORMAT("0 ff DEADBEEF", "%x %x %X", 0, 0xFF, 0xDEADBEEFU);
+}
+
+/** @brief 64-bit integers, converted without 64-bit division */
+static void test_integers_64(void)
+{
+    CHECK_FORMAT("4294967296", "%llu", 0x100000000ULL);
+    CHECK_FORMAT("18446744073709551615", "%llu", 0xFFFFFFFFFFFFFFFFULL);
+    CHECK_FORMAT("-9223372036854775808", "%lld", (long long)0x8000000000000000ULL);
+    CHECK_FORMAT("10000000000000000000", "%llu", 10000000000000000000ULL);
+    CHECK_FORMAT("1234567890123", "%lld", 1234567890123LL);
+    CHECK_FORMAT("123456789abcdef0", "%llx", 0x123456789ABCDEF0ULL);
+    CHECK_FORMAT("-5", "%ld", -5L);
+}
+
+/** @brief Width, zero padding, and left alignment */
+static void test_width(void)
+{
+    CHECK_FORMAT("   42|42   |00042", "%5d|%-5d|%05d", 42, 42, 42);
+    CHECK_FORMAT("-0042|  -42", "%05d|%5d", -42, -42);
+    CHECK_FORMAT("0x0000ABCD", "0x%08X", 0xABCD);
+    CHECK_FORMAT("  ab|ab  ", "%*s|%-*s", 4, "ab", 4, "ab");
+    CHECK_FORMAT("123456", "%3d", 123456);
+}
+
+/** @brief Strings, characters, pointers, and literal percent signs */
+static void test_other(void)
+{
+    char * volatile null_str = 0;
+    char expected[OUT_SIZE];
+    uint32_t i;
+
+    CHECK_FORMAT("hi x 100%", "%s %c 100%%", "hi", 'x');
+    CHECK_FORMAT("(null)", "%s", null_str);
+
+    /* Pointers have all their digits */
+    strcpy(expected, "0x");
+    for(i = 0; i < sizeof(void *) * 2 - 2; i++) {
+        strcat(expected, "0");
+    }
+    strcat(expected, "1f");
+    CHECK_FORMAT(expected, "%p", (void *)0x1F);
+}
+
+/** @brief Output that does not fit the buffer is truncated */
+static void test_truncate(void)
+{
+    char out[6];
+
+    TEST_ASSERT_EQ(print_format(out, sizeof(out), "%s", "abcdefgh"), 5);
+    TEST_ASSERT(strcmp(out, "abcde") == 0);
+    TEST_ASSERT_EQ(print_format(out, 1, "%s", "abc"), 0);
+    TEST_ASSERT_EQ(out[0], 0);
+}
+
+/** @brief The sink gets all of the output in pieces */
+static void test_sink(void)
+{
+    char expected[OUT_SIZE * 2];
+
+    TEST_ASSERT_EQ(format_to_sink("x=%d", 7), 3);
+    TEST_ASSERT(strcmp(sink_out, "x=7") == 0);
+    TEST_ASSERT_EQ(sink_calls, 1);
+
+    memset(expected, ' ', 99);
+    expected[99] = 'a';
+    expected[100] = 0;
+    TEST_ASSERT_EQ(format_to_sink("%100s", "a"), 100);
+    TEST_ASSERT(strcmp(sink_out, expected) == 0);
+    TEST_ASSERT(sink_calls > 1);
+}
+
+int main(void)
+{
+    RUN_TEST(test_integers);
+    RUN_TEST(test_integers_64);
+    RUN_TEST(test_width);
+    RUN_TEST(test_other);
+    RUN_TEST(test_truncate);
+    RUN_TEST(test_sink);
+
+    return test_summary();
+}
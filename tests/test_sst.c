@@ -0,0 +1,173 @@
+/*
+ * @file test_sst.c
+ * @brief Host unit tests of the run-to-completion tasks in libs/sst
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+
+#include "os.h"
+#include "sst/sst.h"
+#include "test.h"
+#include "fake_system.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Events the tasks under test have room for */
+#define QUEUE_LEN       4
+
+/** @brief Spare interrupts of the tasks under test */
+#define LOW_IRQ         3
+#define HIGH_IRQ        7
+
+/** @brief Interrupt priorities of the tasks under test */
+#define LOW_PRIO        0xB0
+#define HIGH_PRIO       0x90
+
+/** @brief Event making the low priority task post to the high priority one */
+#define EVENT_FORWARD   0x100
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief Events handled by the tasks, in order, tagged with the task */
+static uint32_t handled[16];
+static uint32_t handled_count;
+
+static void low_handler(uint32_t event);
+static void high_handler(uint32_t event);
+
+/** @brief Tasks under test, each test starts from empty queues */
+OS_SST_TASK_DEFINE(low, low_handler, LOW_IRQ, LOW_PRIO, QUEUE_LEN);
+OS_SST_TASK_DEFINE(high, high_handler, HIGH_IRQ, HIGH_PRIO, QUEUE_LEN);
+
+/** @brief Task started on an interrupt the driver has no such spare for */
+OS_SST_TASK_DEFINE(bad_irq, low_handler, FAKE_SPARE_IRQS, LOW_PRIO, 1);
+
+/** @brief Task started on the interrupt of another one */
+OS_SST_TASK_DEFINE(same_irq, high_handler, LOW_IRQ, HIGH_PRIO, 1);
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/** @brief Task required by the kernel, the scheduler is not started in these tests */
+void unused_task(void* arg1, void* arg2, void* arg3)
+{
+}
+
+OS_TASKS_INIT(
+    OS_TASK_DEFINE(unused_task, 0, 0, 0, OS_LOWEST_PRIO + 1),
+);
+
+/** @brief Record an event of the low priority task, forwarding some */
+static void low_handler(uint32_t event)
+{
+    handled[handled_count++] = event;
+    if(event & EVENT_FORWARD) {
+        sst_post(&high, event & ~EVENT_FORWARD);
+    }
+}
+
+/** @brief Record an event of the high priority task */
+static void high_handler(uint32_t event)
+{
+    handled[handled_count++] = 0x1000 | event;
+}
+
+/** @brief Empty the queues of the tasks under test, and the handled events */
+static void sst_reset(void)
+{
+    low.head = low.tail = low.lost = 0;
+    high.head = high.tail = high.lost = 0;
+    handled_count = 0;
+}
+
+/** @brief Starting enables the spare interrupt at the priority of the task, once */
+static void test_start(void)
+{
+    fake_reset();
+    sst_reset();
+
+    TEST_ASSERT_EQ(sst_start(&low), OS_OK);
+    TEST_ASSERT_EQ(sst_start(&high), OS_OK);
+    TEST_ASSERT_EQ(fake_spare_irq_enabled, (1UL << LOW_IRQ) | (1UL << HIGH_IRQ));
+    TEST_ASSERT_EQ(fake_spare_irq_prio[LOW_IRQ], LOW_PRIO);
+    TEST_ASSERT_EQ(fake_spare_irq_prio[HIGH_IRQ], HIGH_PRIO);
+
+    TEST_ASSERT_EQ(sst_start(&low), OS_ERROR);
+    TEST_ASSERT_EQ(sst_start(&same_irq), OS_ERROR);
+    TEST_ASSERT_EQ(sst_start(&bad_irq), OS_ERROR);
+    TEST_ASSERT_EQ(fake_spare_irq_pending, 0);
+}
+
+/** @brief Posting pends the interrupt, which runs the handler once per event, in order */
+static void test_post(void)
+{
+    sst_reset();
+
+    TEST_ASSERT_EQ(sst_post(&low, 1), OS_OK);
+    TEST_ASSERT_EQ(sst_post(&low, 2), OS_OK);
+    TEST_ASSERT_EQ(fake_spare_irq_pending, 1UL << LOW_IRQ);
+    TEST_ASSERT_EQ(fake_critical_nesting, 0);
+    TEST_ASSERT_EQ(handled_count, 0);
+
+    fake_spare_irq();
+    TEST_ASSERT_EQ(handled_count, 2);
+    TEST_ASSERT_EQ(handled[0], 1);
+    TEST_ASSERT_EQ(handled[1], 2);
+    TEST_ASSERT_EQ(low.head, low.tail);
+}
+
+/** @brief Events are refused and counted once the queue is full, and the ring wraps around */
+static void test_full(void)
+{
+    uint32_t i;
+
+    sst_reset();
+
+    for(i = 0; i < QUEUE_LEN; i++) {
+        TEST_ASSERT_EQ(sst_post(&low, i), OS_OK);
+    }
+    TEST_ASSERT_EQ(sst_post(&low, QUEUE_LEN), OS_ERROR);
+    TEST_ASSERT_EQ(low.lost, 1);
+
+    fake_spare_irq();
+    TEST_ASSERT_EQ(handled_count, QUEUE_LEN);
+
+    for(i = 0; i < QUEUE_LEN; i++) {
+        TEST_ASSERT_EQ(sst_post(&low, 10 + i), OS_OK);
+    }
+    fake_spare_irq();
+    TEST_ASSERT_EQ(handled_count, 2 * QUEUE_LEN);
+    for(i = 0; i < QUEUE_LEN; i++) {
+        TEST_ASSERT_EQ(handled[QUEUE_LEN + i], 10 + i);
+    }
+}
+
+/** @brief The higher priority task runs first, and tasks post to each other */
+static void test_priority(void)
+{
+    sst_reset();
+
+    TEST_ASSERT_EQ(sst_post(&low, 1), OS_OK);
+    TEST_ASSERT_EQ(sst_post(&high, 2), OS_OK);
+    TEST_ASSERT_EQ(sst_post(&low, EVENT_FORWARD | 3), OS_OK);
+
+    fake_spare_irq();
+    TEST_ASSERT_EQ(handled_count, 4);
+    TEST_ASSERT_EQ(handled[0], 0x1000 | 2);
+    TEST_ASSERT_EQ(handled[1], 1);
+    TEST_ASSERT_EQ(handled[2], EVENT_FORWARD | 3);
+    TEST_ASSERT_EQ(handled[3], 0x1000 | 3);
+    TEST_ASSERT_EQ(fake_spare_irq_pending, 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_start);
+    RUN_TEST(test_post);
+    RUN_TEST(test_full);
+    RUN_TEST(test_priority);
+
+    return test_summary();
+}
@@ -0,0 +1,125 @@
+/*
+ * @file test_threshold.c
+ * @brief Host unit tests of the preemption threshold in os/os.c
+ *
+ * The tasks under test are defined with OS_THRESHOLD_TASK_DEFINE, in a task
+ * list of their own, as the threshold is fixed when the task is defined. As
+ * in test_os.c, the tests play the role of the running task.
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+
+#include "os.h"
+#include "system.h"
+#include "test.h"
+#include "fake_system.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Task numbers, in the order of @ref OS_TASKS_INIT below */
+#define HIGH_A  0
+#define HIGH_B  1
+#define LOW     2
+#define IDLE    3
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/** @brief Entry of the first task, called directly by scheduler_start */
+void first_task(void* arg1, void* arg2, void* arg3)
+{
+}
+
+/** @brief Entry of the other tasks, never called in the tests */
+void other_task(void* arg1, void* arg2, void* arg3)
+{
+}
+
+/** @brief Tasks under test. HIGH_B is not preempted by HIGH_A of the same
+ *      priority, and LOW has a threshold at its own priority */
+OS_TASKS_INIT(
+    OS_TASK_DEFINE(first_task, 0, 0, 0, OS_LOWEST_PRIO + 2),
+    OS_THRESHOLD_TASK_DEFINE(other_task, 0, 0, 0, OS_LOWEST_PRIO + 2, OS_LOWEST_PRIO + 2),
+    OS_THRESHOLD_TASK_DEFINE(other_task, 0, 0, 0, OS_LOWEST_PRIO + 1, OS_LOWEST_PRIO + 1),
+);
+
+/**
+ * @brief Start the scheduler from a clean state
+ */
+static void setup(void)
+{
+    fake_reset();
+    scheduler_start();
+}
+
+/** @brief The thresholds are set by the task definitions */
+static void test_define(void)
+{
+    TEST_ASSERT_EQ(__tasks[HIGH_A].threshold, 0);
+    TEST_ASSERT_EQ(__tasks[HIGH_B].prio, OS_LOWEST_PRIO + 2);
+    TEST_ASSERT_EQ(__tasks[HIGH_B].threshold, OS_LOWEST_PRIO + 2);
+    TEST_ASSERT_EQ(__tasks[LOW].threshold, OS_LOWEST_PRIO + 1);
+    TEST_ASSERT_EQ(__tasks[IDLE].threshold, 0);
+}
+
+/** @brief A task with a preemption threshold is only preempted by waking
+ *      tasks above it, the others run once it yields */
+static void test_preemption(void)
+{
+    setup();
+
+    sleep(1);
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_B));
+
+    /* HIGH_A wakes up, but is not above the threshold of HIGH_B */
+    fake_tick();
+    fake_tick();
+    TEST_ASSERT_EQ(fake_pendsv_triggers, 1);
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], 0);
+    TEST_ASSERT_EQ(task_state_list[STATE_READY], TASK_BIT(HIGH_A) | TASK_BIT(LOW) | TASK_BIT(IDLE));
+
+    /* It runs once HIGH_B yields */
+    yield();
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], TASK_BIT(HIGH_A));
+    fake_pendsv();
+
+    /* A threshold at the priority of LOW still lets the higher HIGH_A preempt it */
+    sleep(1);
+    fake_pendsv();
+    sleep(1);
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(LOW));
+    fake_tick();
+    fake_tick();
+    fake_tick();
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], TASK_BIT(HIGH_A));
+}
+
+/** @brief A task without a threshold is preempted by a waking task of the
+ *      same priority, once per wakeup */
+static void test_no_threshold(void)
+{
+    setup();
+
+    /* HIGH_A runs, HIGH_B sleeps and wakes */
+    yield();
+    fake_pendsv();
+    sleep(1);
+    fake_pendsv();
+    TEST_ASSERT_EQ(task_state_list[STATE_RUNNING], TASK_BIT(HIGH_A));
+    fake_tick();
+    fake_tick();
+    TEST_ASSERT_EQ(task_state_list[STATE_NEXT], TASK_BIT(HIGH_B));
+}
+
+int main(void)
+{
+    RUN_TEST(test_define);
+    RUN_TEST(test_preemption);
+    RUN_TEST(test_no_threshold);
+
+    return test_summary();
+}
@@ -0,0 +1,333 @@
+/*
+ * @file test_uart_dma.c
+ * @brief Host unit tests of the STM32U5 UART driver DMA write path, run
+ *      against register mocks. The tests play the hardware: they run the
+ *      interrupt handlers, and complete DMA transfers
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+
+#include "uart.h"
+#include "os.h"
+#include "test.h"
+#include "mock_stm32u5.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Register offsets */
+#define USART_CR1       0x00
+#define USART_CR3       0x08
+#define USART_TDR       0x28
+#define DMA_CH0_FCR     0x05C
+#define DMA_CH0_SR      0x060
+#define DMA_CH0_CR      0x064
+#define DMA_CH0_TR2     0x094
+#define DMA_CH0_BR1     0x098
+#define DMA_CH0_SAR     0x09C
+#define DMA_CH0_DAR     0x0A0
+#define RCC_AHB1ENR     0x088
+#define NVIC_ISER0      0x000
+#define NVIC_ISER1      0x004
+#define NVIC_ISPR1      0x104
+
+/** @brief Register bits */
+#define USART_CR1_TXEIE (1UL << 7)
+#define USART_CR3_DMAT  (1UL << 7)
+#define DMA_CR_EN       (1UL << 0)
+#define DMA_SR_TCF      (1UL << 8)
+#define DMA_SR_DTEF     (1UL << 10)
+#define USART1_IRQ_BIT  (1UL << (61 - 32))
+#define GPDMA_IRQ_BIT   (1UL << 29)
+
+/** @brief Size of a buffer that needs several DMA transfers */
+#define LARGE_LEN       0x18000UL
+
+/* ========================= FUNCTION DECLARATIONS ========================= */
+
+void USART1_IRQHandler(void);
+void GPDMA1_Channel0_IRQHandler(void);
+
+/* ========================= STATIC DATA ========================= */
+
+/** @brief Buffers to write */
+static const char buf_a[] = "first buffer";
+static const char buf_b[] = "second";
+static const char buf_c[] = "third";
+static char large_buf[LARGE_LEN];
+
+/** @brief Calls of the write callback, and the arguments of the last call */
+static int cb_calls;
+static const char *cb_buf;
+static uint32_t cb_len;
+static int cb_status;
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/** @brief Task required by the kernel, the scheduler is not started in these tests */
+void unused_task(void* arg1, void* arg2, void* arg3)
+{
+}
+
+OS_TASKS_INIT(
+    OS_TASK_DEFINE(unused_task, 0, 0, 0, OS_LOWEST_PRIO + 1),
+);
+
+/** @brief Write callback recording its calls */
+static void write_done(const char *buf, uint32_t len, int status)
+{
+    cb_calls++;
+    cb_buf = buf;
+    cb_len = len;
+    cb_status = status;
+}
+
+/**
+ * @brief Reset the registers and initialize the driver
+ */
+static void setup(void)
+{
+    mock_stm32u5_reset();
+    (void)UART_init();
+    cb_calls = 0;
+    cb_buf = 0;
+    cb_len = 0;
+    cb_status = -1;
+}
+
+/** @brief Run the USART1 interrupt handler if the interrupt was pended */
+static void usart1_pending_irq(void)
+{
+    if(MOCK_REG(mock_nvic, NVIC_ISPR1) & USART1_IRQ_BIT) {
+        MOCK_REG(mock_nvic, NVIC_ISPR1) &= ~USART1_IRQ_BIT;
+        USART1_IRQHandler();
+    }
+}
+
+/** @brief End the running DMA transfer with the given status flags, as the hardware does */
+static void dma_end(uint32_t flags)
+{
+    MOCK_REG(mock_gpdma1, DMA_CH0_CR) &= ~DMA_CR_EN;
+    MOCK_REG(mock_gpdma1, DMA_CH0_SR) |= flags;
+    GPDMA1_Channel0_IRQHandler();
+
+    /* Flags are cleared by the driver through FCR */
+    MOCK_REG(mock_gpdma1, DMA_CH0_SR) &= ~(MOCK_REG(mock_gpdma1, DMA_CH0_FCR));
+    MOCK_REG(mock_gpdma1, DMA_CH0_FCR) = 0;
+}
+
+/** @brief Address as seen by the DMA */
+static uint32_t dma_addr(const volatile void *p)
+{
+    return (uint32_t)(uintptr_t)p;
+}
+
+/** @brief Initialization enables DMA requests, and the DMA clock and interrupt */
+static void test_init(void)
+{
+    setup();
+
+    TEST_ASSERT(MOCK_REG(mock_rcc, RCC_AHB1ENR) & 1UL);
+    TEST_ASSERT(MOCK_REG(mock_usart1, USART_CR3) & USART_CR3_DMAT);
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_TR2), 25);
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_DAR), dma_addr(&MOCK_REG(mock_usart1, USART_TDR)));
+    TEST_ASSERT(MOCK_REG(mock_nvic, NVIC_ISER0) & GPDMA_IRQ_BIT);
+    TEST_ASSERT(MOCK_REG(mock_nvic, NVIC_ISER1) & USART1_IRQ_BIT);
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_CR) & DMA_CR_EN, 0);
+}
+
+/** @brief A write is started from the USART1 interrupt, and completes with one DMA interrupt */
+static void test_write(void)
+{
+    setup();
+
+    TEST_ASSERT_EQ(UART_write(buf_a, sizeof(buf_a), &write_done), UART_OK);
+    TEST_ASSERT(MOCK_REG(mock_nvic, NVIC_ISPR1) & USART1_IRQ_BIT);
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_CR) & DMA_CR_EN, 0);
+
+    usart1_pending_irq();
+    TEST_ASSERT(MOCK_REG(mock_gpdma1, DMA_CH0_CR) & DMA_CR_EN);
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_SAR), dma_addr(buf_a));
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_BR1), sizeof(buf_a));
+
+    dma_end(DMA_SR_TCF);
+    TEST_ASSERT_EQ(cb_calls, 1);
+    TEST_ASSERT(cb_buf == buf_a);
+    TEST_ASSERT_EQ(cb_len, sizeof(buf_a));
+    TEST_ASSERT_EQ(cb_status, UART_OK);
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_CR) & DMA_CR_EN, 0);
+}
+
+/** @brief Queued writes are sent in order, each started from the previous one's completion */
+static void test_queued_writes(void)
+{
+    setup();
+
+    TEST_ASSERT_EQ(UART_write(buf_a, sizeof(buf_a), &write_done), UART_OK);
+    TEST_ASSERT_EQ(UART_write(buf_b, sizeof(buf_b), &write_done), UART_OK);
+    TEST_ASSERT_EQ(UART_write(buf_c, sizeof(buf_c), &write_done), UART_OK);
+    usart1_pending_irq();
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_SAR), dma_addr(buf_a));
+
+    dma_end(DMA_SR_TCF);
+    TEST_ASSERT(cb_buf == buf_a);
+    TEST_ASSERT(MOCK_REG(mock_gpdma1, DMA_CH0_CR) & DMA_CR_EN);
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_SAR), dma_addr(buf_b));
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_BR1), sizeof(buf_b));
+
+    dma_end(DMA_SR_TCF);
+    TEST_ASSERT(cb_buf == buf_b);
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_SAR), dma_addr(buf_c));
+
+    dma_end(DMA_SR_TCF);
+    TEST_ASSERT(cb_buf == buf_c);
+    TEST_ASSERT_EQ(cb_calls, 3);
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_CR) & DMA_CR_EN, 0);
+}
+
+/** @brief A buffer larger than a DMA block is sent in several transfers, with one callback */
+static void test_large_write(void)
+{
+    setup();
+
+    TEST_ASSERT_EQ(UART_write(large_buf, LARGE_LEN, &write_done), UART_OK);
+    usart1_pending_irq();
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_SAR), dma_addr(large_buf));
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_BR1), 0xFFFF);
+
+    dma_end(DMA_SR_TCF);
+    TEST_ASSERT_EQ(cb_calls, 0);
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_SAR), dma_addr(&large_buf[0xFFFF]));
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_BR1), LARGE_LEN - 0xFFFF);
+
+    dma_end(DMA_SR_TCF);
+    TEST_ASSERT_EQ(cb_calls, 1);
+    TEST_ASSERT_EQ(cb_len, LARGE_LEN);
+}
+
+/** @brief Writes are rejected when the queue is full, or the arguments are invalid */
+static void test_write_errors(void)
+{
+    int i;
+
+    setup();
+
+    TEST_ASSERT_EQ(UART_write(0, 1, &write_done), UART_ERROR);
+    TEST_ASSERT_EQ(UART_write(buf_a, 0, &write_done), UART_ERROR);
+
+    for(i = 0; i < 8; i++) {
+        TEST_ASSERT_EQ(UART_write(buf_a, sizeof(buf_a), &write_done), UART_OK);
+    }
+    TEST_ASSERT_EQ(UART_write(buf_a, sizeof(buf_a), &write_done), UART_ERROR);
+
+    usart1_pending_irq();
+    for(i = 0; i < 8; i++) {
+        dma_end(DMA_SR_TCF);
+    }
+    TEST_ASSERT_EQ(cb_calls, 8);
+    TEST_ASSERT_EQ(UART_write(buf_a, sizeof(buf_a), &write_done), UART_OK);
+    usart1_pending_irq();
+    dma_end(DMA_SR_TCF);
+}
+
+/** @brief A DMA error completes the write with an error status */
+static void test_dma_error(void)
+{
+    setup();
+
+    TEST_ASSERT_EQ(UART_write(large_buf, LARGE_LEN, &write_done), UART_OK);
+    usart1_pending_irq();
+    dma_end(DMA_SR_DTEF);
+    TEST_ASSERT_EQ(cb_calls, 1);
+    TEST_ASSERT_EQ(cb_status, UART_ERROR);
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_CR) & DMA_CR_EN, 0);
+}
+
+/** @brief Printed output already buffered is sent before a DMA write starts */
+static void test_write_after_print(void)
+{
+    setup();
+
+    TEST_ASSERT_EQ(UART_print_str("ab"), UART_OK);
+    TEST_ASSERT(MOCK_REG(mock_usart1, USART_CR1) & USART_CR1_TXEIE);
+    TEST_ASSERT_EQ(UART_write(buf_a, sizeof(buf_a), &write_done), UART_OK);
+
+    usart1_pending_irq();
+    TEST_ASSERT_EQ(MOCK_REG(mock_usart1, USART_TDR), 'a');
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_CR) & DMA_CR_EN, 0);
+
+    /* DMA takes over once the last byte is in the data register */
+    USART1_IRQHandler();
+    TEST_ASSERT_EQ(MOCK_REG(mock_usart1, USART_TDR), 'b');
+    TEST_ASSERT_EQ(MOCK_REG(mock_usart1, USART_CR1) & USART_CR1_TXEIE, 0);
+    TEST_ASSERT(MOCK_REG(mock_gpdma1, DMA_CH0_CR) & DMA_CR_EN);
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_SAR), dma_addr(buf_a));
+
+    dma_end(DMA_SR_TCF);
+    TEST_ASSERT_EQ(cb_calls, 1);
+}
+
+/** @brief Output printed during a DMA write is sent after it */
+static void test_print_during_write(void)
+{
+    setup();
+
+    TEST_ASSERT_EQ(UART_write(buf_a, sizeof(buf_a), &write_done), UART_OK);
+    usart1_pending_irq();
+    MOCK_REG(mock_usart1, USART_TDR) = 0;
+
+    TEST_ASSERT_EQ(UART_print_chr("x"), UART_OK);
+    USART1_IRQHandler();
+    TEST_ASSERT_EQ(MOCK_REG(mock_usart1, USART_TDR), 0);
+    TEST_ASSERT_EQ(MOCK_REG(mock_usart1, USART_CR1) & USART_CR1_TXEIE, 0);
+
+    dma_end(DMA_SR_TCF);
+    TEST_ASSERT(MOCK_REG(mock_usart1, USART_CR1) & USART_CR1_TXEIE);
+    USART1_IRQHandler();
+    TEST_ASSERT_EQ(MOCK_REG(mock_usart1, USART_TDR), 'x');
+    USART1_IRQHandler();
+    TEST_ASSERT_EQ(MOCK_REG(mock_usart1, USART_CR1) & USART_CR1_TXEIE, 0);
+}
+
+/** @brief Flush sends buffered output and queued DMA writes by busy-waiting */
+static void test_flush(void)
+{
+    setup();
+
+    TEST_ASSERT_EQ(UART_print_str("yz"), UART_OK);
+    TEST_ASSERT_EQ(UART_write(buf_a, sizeof(buf_a), &write_done), UART_OK);
+    TEST_ASSERT_EQ(UART_write(buf_b, sizeof(buf_b), &write_done), UART_OK);
+
+    /* Transfers complete right away */
+    MOCK_REG(mock_gpdma1, DMA_CH0_SR) = DMA_SR_TCF;
+
+    TEST_ASSERT_EQ(UART_flush(), UART_OK);
+    TEST_ASSERT_EQ(MOCK_REG(mock_usart1, USART_TDR), 'z');
+    TEST_ASSERT_EQ(cb_calls, 2);
+    TEST_ASSERT(cb_buf == buf_b);
+    TEST_ASSERT_EQ(MOCK_REG(mock_usart1, USART_CR1) & USART_CR1_TXEIE, 0);
+    TEST_ASSERT(MOCK_REG(mock_nvic, NVIC_ISER1) & USART1_IRQ_BIT);
+    TEST_ASSERT(MOCK_REG(mock_nvic, NVIC_ISER0) & GPDMA_IRQ_BIT);
+
+    /* Nothing left for the pended interrupt */
+    MOCK_REG(mock_gpdma1, DMA_CH0_CR) = 0;
+    usart1_pending_irq();
+    TEST_ASSERT_EQ(MOCK_REG(mock_gpdma1, DMA_CH0_CR) & DMA_CR_EN, 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_init);
+    RUN_TEST(test_write);
+    RUN_TEST(test_queued_writes);
+    RUN_TEST(test_large_write);
+    RUN_TEST(test_write_errors);
+    RUN_TEST(test_dma_error);
+    RUN_TEST(test_write_after_print);
+    RUN_TEST(test_print_during_write);
+    RUN_TEST(test_flush);
+
+    return test_summary();
+}
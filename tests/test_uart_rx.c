@@ -0,0 +1,226 @@
+/*
+ * @file test_uart_rx.c
+ * @brief Host unit tests of the STM32U5 UART driver receive path, run
+ *      against register mocks. The tests play the hardware, receiving
+ *      bytes by running the interrupt handler
+ *
+ *      Copyright (c) 2025 Miikka Lukumies
+ */
+
+/* ========================= INCLUDES ========================= */
+#include <stdint.h>
+#include <string.h>
+
+#include "uart.h"
+#include "os.h"
+#include "test.h"
+#include "mock_stm32u5.h"
+
+/* ========================= CONSTANTS ========================= */
+
+/** @brief Register offsets */
+#define USART_CR1       0x00
+#define USART_ISR       0x1C
+#define USART_ICR       0x20
+#define USART_RDR       0x24
+
+/** @brief Register bits */
+#define USART_CR1_RE    (1UL << 2)
+#define USART_CR1_RXNEIE (1UL << 5)
+#define USART_ISR_RXNE  (1UL << 5)
+#define USART_ISR_ORE   (1UL << 3)
+#define USART_ICR_ORECF (1UL << 3)
+
+/** @brief Size of the driver's RX buffer */
+#define RX_BUFFER_SIZE  256
+
+/* ========================= FUNCTION DECLARATIONS ========================= */
+
+void USART1_IRQHandler(void);
+
+/* ========================= FUNCTION DEFINITIONS ========================= */
+
+/** @brief Task required by the kernel, the scheduler is not started in these tests */
+void unused_task(void* arg1, void* arg2, void* arg3)
+{
+}
+
+OS_TASKS_INIT(
+    OS_TASK_DEFINE(unused_task, 0, 0, 0, OS_LOWEST_PRIO + 1),
+);
+
+/**
+ * @brief Reset the registers, initialize the driver, and empty the RX buffer
+ */
+static void setup(void)
+{
+    char buf[RX_BUFFER_SIZE];
+
+    mock_stm32u5_reset();
+    (void)UART_init();
+    while(UART_read(buf, sizeof(buf), 0) > 0) { ; }
+}
+
+/** @brief Receive bytes, running the interrupt handler for each as the hardware would */
+static void receive(const char *data)
+{
+    while(*data) {
+        MOCK_REG(mock_usart1, USART_RDR) = (uint8_t)*data++;
+        MOCK_REG(mock_usart1, USART_ISR) |= USART_ISR_RXNE;
+        USART1_IRQHandler();
+        MOCK_REG(mock_usart1, USART_ISR) &= ~USART_ISR_RXNE;
+    }
+}
+
+/** @brief Initialization enables the receiver and its interrupt */
+static void test_init(void)
+{
+    setup();
+
+    TEST_ASSERT(MOCK_REG(mock_usart1, USART_CR1) & USART_CR1_RE);
+    TEST_ASSERT(MOCK_REG(mock_usart1, USART_CR1) & USART_CR1_RXNEIE);
+}
+
+/** @brief Received bytes are read in order, and reading with no data times out */
+static void test_read(void)
+{
+    char buf[8];
+
+    setup();
+
+    TEST_ASSERT_EQ(UART_read(buf, sizeof(buf), 0), 0);
+
+    receive("hello");
+    TEST_ASSERT_EQ(UART_read(buf, 3, 0), 3);
+    TEST_ASSERT(memcmp(buf, "hel", 3) == 0);
+    TEST_ASSERT_EQ(UART_read(buf, sizeof(buf), 0), 2);
+    TEST_ASSERT(memcmp(buf, "lo", 2) == 0);
+    TEST_ASSERT_EQ(UART_read(buf, sizeof(buf), 0), 0);
+
+    TEST_ASSERT_EQ(UART_read(0, sizeof(buf), 0), -1);
+}
+
+/** @brief Number of calls of @ref rx_callback */
+static uint32_t rx_callbacks;
+
+/** @brief Receive callback counting its calls, checking the byte is readable already */
+static void rx_callback(void)
+{
+    char c;
+
+    rx_callbacks++;
+    TEST_ASSERT_EQ(UART_read(&c, 1, 0), 1);
+}
+
+/** @brief The receive callback is called for each byte received, until removed */
+static void test_rx_notify(void)
+{
+    setup();
+    rx_callbacks = 0;
+
+    TEST_ASSERT_EQ(UART_rx_notify(&rx_callback), UART_OK);
+    receive("ab");
+    TEST_ASSERT_EQ(rx_callbacks, 2);
+
+    TEST_ASSERT_EQ(UART_rx_notify(0), UART_OK);
+    receive("c");
+    TEST_ASSERT_EQ(rx_callbacks, 2);
+}
+
+/** @brief Lines are only returned once complete, and CR, LF, and CRLF each end one line */
+static void test_read_line(void)
+{
+    char buf[16];
+
+    setup();
+
+    receive("ab");
+    TEST_ASSERT_EQ(UART_read_line(buf, sizeof(buf), 0), -1);
+
+    receive("\r\ncd\nef\r");
+    TEST_ASSERT_EQ(UART_read_line(buf, sizeof(buf), 0), 2);
+    TEST_ASSERT(strcmp(buf, "ab") == 0);
+    TEST_ASSERT_EQ(UART_read_line(buf, sizeof(buf), 0), 2);
+    TEST_ASSERT(strcmp(buf, "cd") == 0);
+    TEST_ASSERT_EQ(UART_read_line(buf, sizeof(buf), 0), 2);
+    TEST_ASSERT(strcmp(buf, "ef") == 0);
+    TEST_ASSERT_EQ(UART_read_line(buf, sizeof(buf), 0), -1);
+
+    /* LF completing the CRLF after the line was read is not an empty line */
+    receive("\ngh\n\n");
+    TEST_ASSERT_EQ(UART_read_line(buf, sizeof(buf), 0), 2);
+    TEST_ASSERT(strcmp(buf, "gh") == 0);
+    TEST_ASSERT_EQ(UART_read_line(buf, sizeof(buf), 0), 0);
+    TEST_ASSERT_EQ(UART_read_line(buf, sizeof(buf), 0), -1);
+}
+
+/** @brief Lines too long for the buffer are truncated */
+static void test_read_line_truncated(void)
+{
+    char buf[4];
+
+    setup();
+
+    receive("abcdef\nxy\n");
+    TEST_ASSERT_EQ(UART_read_line(buf, sizeof(buf), 0), 3);
+    TEST_ASSERT(strcmp(buf, "abc") == 0);
+    TEST_ASSERT_EQ(UART_read_line(buf, sizeof(buf), 0), 2);
+    TEST_ASSERT(strcmp(buf, "xy") == 0);
+}
+
+/** @brief Raw reads consuming line ends keep line reads in sync */
+static void test_read_mixed(void)
+{
+    char buf[8];
+
+    setup();
+
+    receive("x\ny\n");
+    TEST_ASSERT_EQ(UART_read(buf, 2, 0), 2);
+    TEST_ASSERT_EQ(UART_read_line(buf, sizeof(buf), 0), 1);
+    TEST_ASSERT(strcmp(buf, "y") == 0);
+    TEST_ASSERT_EQ(UART_read_line(buf, sizeof(buf), 0), -1);
+}
+
+/** @brief Bytes received while the buffer is full are dropped, and a full buffer
+ *      without a line end is returned as a line */
+static void test_overflow(void)
+{
+    char buf[RX_BUFFER_SIZE + 1];
+    int i;
+
+    setup();
+
+    for(i = 0; i < RX_BUFFER_SIZE; i++) {
+        receive("a");
+    }
+    receive("b\n");
+
+    TEST_ASSERT_EQ(UART_read_line(buf, sizeof(buf), 0), RX_BUFFER_SIZE);
+    TEST_ASSERT_EQ(buf[RX_BUFFER_SIZE - 1], 'a');
+    TEST_ASSERT_EQ(UART_read(buf, sizeof(buf), 0), 0);
+}
+
+/** @brief Overrun errors are cleared */
+static void test_overrun(void)
+{
+    setup();
+
+    MOCK_REG(mock_usart1, USART_ISR) |= USART_ISR_ORE;
+    USART1_IRQHandler();
+    TEST_ASSERT_EQ(MOCK_REG(mock_usart1, USART_ICR), USART_ICR_ORECF);
+}
+
+int main(void)
+{
+    RUN_TEST(test_init);
+    RUN_TEST(test_read);
+    RUN_TEST(test_rx_notify);
+    RUN_TEST(test_read_line);
+    RUN_TEST(test_read_line_truncated);
+    RUN_TEST(test_read_mixed);
+    RUN_TEST(test_overflow);
+    RUN_TEST(test_overrun);
+
+    return test_summary();
+}